@@ -237,6 +237,44 @@ static inline void tr_load(__u16 sel)
 	__asm__ volatile ("ltr %0" : : "r" (sel));
 }
 
+/** Invalidate TLB entries tagged with Process-Context Identifier.
+ *
+ * @param type INVPCID invalidation type.
+ * @param pcid Process-Context Identifier.
+ * @param addr Linear address (used only by individual-address invalidation).
+ */
+static inline void invpcid(__native type, __u64 pcid, __address addr)
+{
+	struct {
+		__u64 pcid;
+		__u64 addr;
+	} desc = { pcid, addr };
+
+	__asm__ volatile ("invpcid %0, %1\n" : : "m" (desc), "r" (type) : "memory");
+}
+
+/** Write extended control register.
+ *
+ * @param reg Number of the extended control register.
+ * @param val Value to be written.
+ */
+static inline void xsetbv(__u32 reg, __u64 val)
+{
+	__asm__ volatile ("xsetbv\n" : : "c" (reg), "a" ((__u32) val), "d" ((__u32) (val >> 32)));
+}
+
+/** Read the time stamp counter.
+ *
+ * @return Number of cycles since processor reset.
+ */
+static inline __u64 get_cycle(void)
+{
+	__u32 ax, dx;
+
+	__asm__ volatile ("rdtsc\n" : "=a" (ax), "=d" (dx));
+	return ((__u64) dx << 32) | ax;
+}
+
 #define GEN_READ_REG(reg) static inline __native read_ ##reg (void) \
     { \
 	__native res; \
@@ -253,6 +291,8 @@ GEN_READ_REG(cr0);
 GEN_READ_REG(cr2);
 GEN_READ_REG(cr3);
 GEN_WRITE_REG(cr3);
+GEN_READ_REG(cr4);
+GEN_WRITE_REG(cr4);
 
 GEN_READ_REG(dr0);
 GEN_READ_REG(dr1);
@@ -76,6 +76,27 @@ static inline long atomic_postdec(atomic_t *val)
 	return r;
 }
 
+/** Compare and swap
+ *
+ * Atomically replace the value of val by nv if it equals ov.
+ *
+ * @return Non-zero if the value was replaced, zero otherwise.
+ */
+static inline int atomic_cas(atomic_t *val, long ov, long nv)
+{
+	__u8 rc;
+
+	__asm__ volatile (
+		"lock cmpxchgq %3, %1\n"
+		"setz %0\n"
+		: "=q" (rc), "+m" (val->count), "+a" (ov)
+		: "r" (nv)
+		: "memory"
+	);
+
+	return rc;
+}
+
 #define atomic_preinc(val) (atomic_postinc(val)+1)
 #define atomic_predec(val) (atomic_postdec(val)-1)
 
@@ -32,6 +32,8 @@
 #define RFLAGS_IF       (1 << 9)
 #define RFLAGS_RF       (1 << 16)
 
+#define CR4_OSXSAVE     (1 << 18)
+
 #define EFER_MSR_NUM    0xc0000080
 #define AMD_SCE_FLAG    0
 #define AMD_LME_FLAG    8
@@ -45,11 +47,13 @@
 #define AMD_MSR_SFMASK  0xc0000084
 #define AMD_MSR_FS      0xc0000100
 #define AMD_MSR_GS      0xc0000101
+#define AMD_MSR_KERNEL_GS	0xc0000102
 
 #ifndef __ASM__
 
 #include <typedefs.h>
 #include <arch/pm.h>
+#include <arch/mm/asid.h>
 
 struct cpu_arch {
 	int vendor;
@@ -59,6 +63,12 @@ struct cpu_arch {
 	struct tss *tss;
 	
 	count_t iomapver_copy;	/** Copy of TASK's I/O Permission bitmap generation count. */
+
+	count_t cr3_flush;	/**< Number of CR3 loads that flushed TLB. */
+	count_t cr3_noflush;	/**< Number of CR3 loads that preserved TLB. */
+
+	/** Bitmap of PCIDs whose TLB entries must be flushed when they are loaded next time. */
+	__u64 pcid_stale[(ASID_MAX_ARCH + 1) / 64];
 };
 
 struct star_msr {
@@ -31,10 +31,20 @@
 
 #define AMD_CPUID_EXTENDED   0x80000001
 #define AMD_EXT_NOEXECUTE    20
+#define AMD_EXT_PAGE1GB      26
 
 #define INTEL_CPUID_STANDARD 0x1
 #define INTEL_SSE2           26
 #define INTEL_FXSAVE         24
+#define INTEL_PCID           17
+#define INTEL_XSAVE          26
+
+#define INTEL_CPUID_XSAVE    0xd
+#define INTEL_XSAVEOPT       0
+
+#define INTEL_CPUID_LEVEL    0x0
+#define INTEL_CPUID_EXTENDED_FEATURES 0x7
+#define INTEL_INVPCID        10
 
 #ifndef __ASM__
 
@@ -50,6 +60,7 @@ struct cpu_info {
 extern int has_cpuid(void);
 
 extern void cpuid(__u32 cmd, cpu_info_t *info);
+extern void cpuid_subleaf(__u32 cmd, __u32 subleaf, cpu_info_t *info);
 
 
 extern __u64 rdtsc(void);
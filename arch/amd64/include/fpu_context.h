@@ -30,14 +30,31 @@
 #define __ia32_FPU_CONTEXT_H__
 
 #include <arch/types.h>
+#include <typedefs.h>
 
 #define ARCH_HAS_FPU
-#define FPU_CONTEXT_ALIGN 16
+#define FPU_CONTEXT_ALIGN 64	/* XSAVE area must be 64-byte aligned */
+
+/** Size of the FPU context, determined from CPUID by cpu_setup_fpu(). */
+#define FPU_CONTEXT_SIZE	fpu_context_size
+
+/** XSAVE state components the kernel enables: x87, SSE, AVX and AVX-512. */
+#define XSTATE_SUPPORTED	0xe7
+
+#define XCR0			0
 
 void fpu_fxsr(void);
 void fpu_fsr(void);
 
+extern size_t fpu_context_size;
+extern __u64 fpu_xsave_mask;
+extern bool fpu_xsaveopt;
 
+/*
+ * Only the legacy FXSAVE area is declared. With XSAVE, the XSAVE header
+ * and the extended state components follow it and the context is
+ * fpu_context_size bytes long.
+ */
 struct fpu_context {
 	__u8 fpu[512]; 		/* FXSAVE & FXRSTOR storage area */
 };
@@ -29,6 +29,8 @@
 #ifndef __amd64_AS_H__
 #define __amd64_AS_H__
 
+#include <typedefs.h>
+
 #define KERNEL_ADDRESS_SPACE_SHADOWED_ARCH	0
 
 #define KERNEL_ADDRESS_SPACE_START_ARCH		(unsigned long) 0xffff800000000000
@@ -38,8 +40,7 @@
 
 #define USTACK_ADDRESS_ARCH	(USER_ADDRESS_SPACE_END_ARCH-(PAGE_SIZE-1))
 
-#define as_install_arch(as)
-
 extern void as_arch_init(void);
+extern void as_install_arch(as_t *as);
 
 #endif
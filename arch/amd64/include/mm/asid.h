@@ -27,19 +27,17 @@
  */
 
 /*
- * ia32 has no hardware support for address space identifiers.
- * This file is provided to do nop-implementation of mm/asid.h
- * interface.
+ * amd64 uses the 12-bit Process-Context Identifier (PCID)
+ * as the address space identifier when the processor supports it.
+ * Otherwise, ASIDs are still allocated but TLB is flushed on
+ * every address space switch.
  */
 
-#ifndef __ia32_ASID_H__
-#define __ia32_ASID_H__
+#ifndef __amd64_ASID_H__
+#define __amd64_ASID_H__
 
 typedef int asid_t;
 
-#define ASID_MAX_ARCH		3
-
-#define asid_get()		(ASID_START+1)
-#define asid_put(asid)
+#define ASID_MAX_ARCH		4095
 
 #endif
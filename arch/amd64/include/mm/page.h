@@ -46,6 +46,9 @@
 #define PAGE_WIDTH	FRAME_WIDTH
 #define PAGE_SIZE	FRAME_SIZE
 
+#define LARGE_PAGE_SIZE	(1 << 21)	/**< Size of page mapped by PTL2 entry. */
+#define HUGE_PAGE_SIZE	(1 << 30)	/**< Size of page mapped by PTL1 entry. */
+
 #ifdef KERNEL
 
 #ifndef __ASM__
@@ -84,7 +87,8 @@ static inline __address ka2pa(__address x)
 #define GET_PTL3_ADDRESS_ARCH(ptl2, i)		((pte_t *) ((((__u64) ((pte_t *)(ptl2))[(i)].addr_12_31)<<12) | (((__u64) ((pte_t *)(ptl2))[(i)].addr_32_51)<<32 )))
 #define GET_FRAME_ADDRESS_ARCH(ptl3, i)		((__address *) ((((__u64) ((pte_t *)(ptl3))[(i)].addr_12_31)<<12) | (((__u64) ((pte_t *)(ptl3))[(i)].addr_32_51)<<32 )))
 
-#define SET_PTL0_ADDRESS_ARCH(ptl0)		(write_cr3((__address) (ptl0)))
+/* CR3 is loaded by as_install_arch() once the ASID of the address space is known. */
+#define SET_PTL0_ADDRESS_ARCH(ptl0)
 #define SET_PTL1_ADDRESS_ARCH(ptl0, i, a)	set_pt_addr((pte_t *)(ptl0), (index_t)(i), a)
 #define SET_PTL2_ADDRESS_ARCH(ptl1, i, a)       set_pt_addr((pte_t *)(ptl1), (index_t)(i), a)
 #define SET_PTL3_ADDRESS_ARCH(ptl2, i, a)       set_pt_addr((pte_t *)(ptl2), (index_t)(i), a)
@@ -134,7 +138,7 @@ struct page_specifier {
 	unsigned page_cache_disable : 1;
 	unsigned accessed : 1;
 	unsigned dirty : 1;
-	unsigned unused: 1;
+	unsigned size : 1;			/**< Large page in PTL1 and PTL2 entries. */
 	unsigned global : 1;
 	unsigned soft_valid : 1;		/**< Valid content even if present bit is cleared. */
 	unsigned avl : 2;
@@ -154,7 +158,8 @@ static inline int get_pt_flags(pte_t *pt, index_t i)
 		1<<PAGE_READ_SHIFT |
 		p->writeable<<PAGE_WRITE_SHIFT |
 		(!p->no_execute)<<PAGE_EXEC_SHIFT |
-		p->global<<PAGE_GLOBAL_SHIFT
+		p->global<<PAGE_GLOBAL_SHIFT |
+		p->size<<PAGE_LARGE_SHIFT
 	);
 }
 
@@ -176,6 +181,7 @@ static inline void set_pt_flags(pte_t *pt, index_t i, int flags)
 	p->writeable = (flags & PAGE_WRITE) != 0;
 	p->no_execute = (flags & PAGE_EXEC) == 0;
 	p->global = (flags & PAGE_GLOBAL) != 0;
+	p->size = (flags & PAGE_LARGE) != 0;
 	
 	/*
 	 * Ensure that there is at least one bit set even if the present bit is cleared.
@@ -183,6 +189,8 @@ static inline void set_pt_flags(pte_t *pt, index_t i, int flags)
 	p->soft_valid = 1;
 }
 
+extern bool huge_pages_supported;
+
 extern void page_arch_init(void);
 
 #endif /* __ASM__ */
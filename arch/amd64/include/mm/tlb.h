@@ -29,7 +29,31 @@
 #ifndef __amd64_TLB_H__
 #define __amd64_TLB_H__
 
-#define tlb_arch_init()
+#include <arch/types.h>
+#include <typedefs.h>
+#include <arch/mm/asid.h>
+
+/** CR3 bits holding the current PCID. */
+#define CR3_PCID_MASK		0xfff
+/** Do not flush TLB entries of the PCID being loaded into CR3. */
+#define CR3_NOFLUSH		(1ULL << 63)
+
+#define CR4_PGE			(1 << 7)
+#define CR4_PCIDE		(1 << 17)
+
+/* INVPCID invalidation types. */
+#define INVPCID_ADDRESS		0
+#define INVPCID_CONTEXT		1
+#define INVPCID_ALL_GLOBAL	2
+#define INVPCID_ALL		3
+
 #define tlb_print()
 
+extern bool pcid_supported;
+extern bool invpcid_supported;
+
+extern void tlb_arch_init(void);
+extern void cr3_load(__address cr3);
+extern bool pcid_stale_clear(asid_t asid);
+
 #endif
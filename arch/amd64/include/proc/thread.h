@@ -29,10 +29,23 @@
 #ifndef __amd64_THREAD_H__
 #define __amd64_THREAD_H__
 
+/*
+ * Offsets of syscall_rsp and user_rsp in thread_arch_t,
+ * used by syscall_entry through the hidden GS base.
+ */
+#define SYSCALL_OFFSET_KSTACK	0x8
+#define SYSCALL_OFFSET_USTACK	0x10
+
+#ifndef __ASM__
+
 #include <arch/types.h>
 
 typedef struct {
 	__native tls;
+	__address syscall_rsp;	/**< Top of the kernel stack for SYSCALL. */
+	__address user_rsp;	/**< Userspace stack pointer saved by SYSCALL. */
 } thread_arch_t;
 
+#endif /* __ASM__ */
+
 #endif
@@ -29,6 +29,14 @@
 #ifndef __AP_H__
 #define __AP_H__
 
+#include <arch/types.h>
+#include <atomic.h>
+
+/** Number of boot stack slots, one for each possible local APIC ID. */
+#define AP_BOOT_STACKS	256
+
 extern void ap_boot(void);
 
+extern atomic_t ap_boot_stacks[AP_BOOT_STACKS];
+
 #endif
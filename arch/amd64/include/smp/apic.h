@@ -349,6 +349,7 @@ extern void l_apic_init(void);
 extern void l_apic_eoi(void);
 extern int l_apic_broadcast_custom_ipi(__u8 vector);
 extern int l_apic_send_init_ipi(__u8 apicid);
+extern int l_apic_send_startup_ipi(__u8 apicid);
 extern void l_apic_debug(void);
 extern __u8 l_apic_id(void);
 
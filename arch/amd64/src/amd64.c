@@ -42,6 +42,7 @@
 #include <arch/bios/bios.h>
 #include <arch/mm/memory_init.h>
 #include <arch/cpu.h>
+#include <cpu.h>
 #include <print.h>
 #include <arch/cpuid.h>
 #include <genarch/acpi/acpi.h>
@@ -168,6 +169,17 @@ void arch_post_smp_init(void)
 
 void calibrate_delay_loop(void)
 {
+	/*
+	 * Application processors come up in parallel and cannot
+	 * share i8254. They take over the values measured by the
+	 * bootstrap processor instead.
+	 */
+	if (CPU != &cpus[0]) {
+		CPU->delay_loop_const = cpus[0].delay_loop_const;
+		CPU->frequency_mhz = cpus[0].frequency_mhz;
+		return;
+	}
+
 	i8254_calibrate_delay_loop();
 	i8254_normal_operation();
 }
@@ -35,6 +35,8 @@
 #include <print.h>
 #include <typedefs.h>
 #include <fpu_context.h>
+#include <arch/asm.h>
+#include <config.h>
 
 /*
  * Identification of CPUs.
@@ -67,9 +69,16 @@ static char *vendor_str[] = {
  * cr0.osfxsr = 1 -> we do support fxstor/fxrestor
  * cr0.em = 0 -> we do not emulate coprocessor
  * cr0.mp = 1 -> we do want lazy context switch
+ * cr4.osxsave = 1 -> we do support xsave/xrstor (if present)
+ *
+ * On the bootstrap processor, the size of the FPU
+ * context is determined from CPUID.
  */
 void cpu_setup_fpu(void)
 {
+	cpu_info_t info;
+	__u64 mask;
+
 	__asm__ volatile (
 		"movq %%cr0, %%rax;"
 		"btsq $1, %%rax;" /* cr0.mp */
@@ -83,6 +92,25 @@ void cpu_setup_fpu(void)
 		:
 		:"%rax"
 		);
+
+	cpuid(INTEL_CPUID_STANDARD, &info);
+	if (!(info.cpuid_ecx & (1 << INTEL_XSAVE)))
+		return;
+
+	write_cr4(read_cr4() | CR4_OSXSAVE);
+	cpuid_subleaf(INTEL_CPUID_XSAVE, 0, &info);
+	mask = info.cpuid_eax & XSTATE_SUPPORTED;
+	xsetbv(XCR0, mask);
+
+	if (config.cpu_active == 1) {
+		/* EBX now reports the size for the components enabled in XCR0. */
+		cpuid_subleaf(INTEL_CPUID_XSAVE, 0, &info);
+		fpu_context_size = info.cpuid_ebx;
+		fpu_xsave_mask = mask;
+
+		cpuid_subleaf(INTEL_CPUID_XSAVE, 1, &info);
+		fpu_xsaveopt = (info.cpuid_eax & (1 << INTEL_XSAVEOPT)) != 0;
+	}
 }
 
 /** Set the TS flag to 1. 
@@ -117,7 +145,11 @@ void fpu_enable(void)
 
 void cpu_arch_init(void)
 {
-	CPU->arch.tss = tss_p;
+	/*
+	 * Application processors have set up their TSS in pm_init().
+	 */
+	if (!CPU->arch.tss)
+		CPU->arch.tss = tss_p;
 	CPU->arch.tss->iomap_base = &CPU->arch.tss->iomap[0] - ((__u8 *) CPU->arch.tss);
 	CPU->fpu_owner = NULL;
 }
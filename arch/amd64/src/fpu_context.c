@@ -31,26 +31,79 @@
 #include <arch.h>
 #include <cpu.h>
 
-/** Save FPU (mmx, sse) context using fxsave instruction */
+/** Size of the FPU context. Larger than the FXSAVE area with XSAVE. */
+size_t fpu_context_size = sizeof(fpu_context_t);
+
+/** State components saved by XSAVE or zero if XSAVE is not used. */
+__u64 fpu_xsave_mask = 0;
+
+/** XSAVEOPT can be used to skip saving unmodified state components. */
+bool fpu_xsaveopt = false;
+
+/**
+ * XSAVE area with all state components in their initial
+ * configuration. Only MXCSR is read from the legacy area.
+ */
+static __u8 fpu_init_state[576] __attribute__ ((aligned(FPU_CONTEXT_ALIGN))) = {
+	[24] = 0x80, [25] = 0x1f	/* MXCSR = 0x1f80 */
+};
+
+/** Save FPU (mmx, sse, avx) context
+ *
+ * Use xsaveopt or xsave if available, fxsave otherwise.
+ * Xsaveopt does not store state components that have not
+ * been modified since they were restored from this area.
+ */
 void fpu_context_save(fpu_context_t *fctx)
 {
-	__asm__ volatile (
-		"fxsave %0"
-		: "=m"(*fctx)
-		);
+	if (fpu_xsaveopt) {
+		__asm__ volatile (
+			"xsaveopt %0"
+			: "+m"(*fctx)
+			: "a"((__u32) fpu_xsave_mask), "d"((__u32) (fpu_xsave_mask >> 32))
+			: "memory"
+			);
+	} else if (fpu_xsave_mask) {
+		__asm__ volatile (
+			"xsave %0"
+			: "+m"(*fctx)
+			: "a"((__u32) fpu_xsave_mask), "d"((__u32) (fpu_xsave_mask >> 32))
+			: "memory"
+			);
+	} else {
+		__asm__ volatile (
+			"fxsave %0"
+			: "=m"(*fctx)
+			);
+	}
 }
 
-/** Restore FPU (mmx,sse) context using fxrstor instruction */
+/** Restore FPU (mmx, sse, avx) context using xrstor or fxrstor instruction */
 void fpu_context_restore(fpu_context_t *fctx)
 {
-	__asm__ volatile (
-		"fxrstor %0"
-		: "=m"(*fctx)
-		);
+	if (fpu_xsave_mask) {
+		__asm__ volatile (
+			"xrstor %0"
+			:
+			: "m"(*fctx), "a"((__u32) fpu_xsave_mask), "d"((__u32) (fpu_xsave_mask >> 32))
+			: "memory"
+			);
+	} else {
+		__asm__ volatile (
+			"fxrstor %0"
+			: "=m"(*fctx)
+			);
+	}
 }
 
 void fpu_init()
 {
+	if (fpu_xsave_mask) {
+		/* Put all state components, including AVX registers, into initial state. */
+		fpu_context_restore((fpu_context_t *) fpu_init_state);
+		return;
+	}
+
 	/* TODO: Zero all SSE, MMX etc. registers */
 	__asm__ volatile (
 		"fninit;"
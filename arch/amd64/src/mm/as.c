@@ -27,10 +27,56 @@
  */
 
 #include <arch/mm/as.h>
+#include <mm/as.h>
+#include <mm/tlb.h>
+#include <arch/mm/tlb.h>
 #include <genarch/mm/as_pt.h>
+#include <genarch/mm/asid_fifo.h>
+#include <cpu.h>
+#include <config.h>
+#include <sysinfo/sysinfo.h>
+
+static __native cr3_sysinfo(sysinfo_item_t *item);
 
 /** Architecture dependent address space init. */
 void as_arch_init(void)
 {
 	as_operations = &as_pt_operations;
+	asid_fifo_init();
+
+	sysinfo_set_item_function("mm.cr3.flush", NULL, cr3_sysinfo);
+	sysinfo_set_item_function("mm.cr3.noflush", NULL, cr3_sysinfo);
+}
+
+/** Install address space on CPU.
+ *
+ * Load CR3 with the address space's page table. When PCID is
+ * available, the load is tagged with the address space's ASID
+ * and TLB entries belonging to it are preserved unless they
+ * were invalidated while the address space was not current.
+ *
+ * @param as Address space.
+ */
+void as_install_arch(as_t *as)
+{
+	__address cr3 = (__address) as->page_table;
+
+	if (pcid_supported) {
+		cr3 |= as->asid & CR3_PCID_MASK;
+		if (!pcid_stale_clear(as->asid & CR3_PCID_MASK))
+			cr3 |= CR3_NOFLUSH;
+	}
+	cr3_load(cr3);
+}
+
+/** Sum CR3 load counters over all processors. */
+__native cr3_sysinfo(sysinfo_item_t *item)
+{
+	__native sum = 0;
+	bool flush = (item->name[0] == 'f');
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++)
+		sum += flush ? cpus[i].arch.cr3_flush : cpus[i].arch.cr3_noflush;
+	return sum;
 }
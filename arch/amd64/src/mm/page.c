@@ -40,6 +40,8 @@
 #include <print.h>
 #include <panic.h>
 #include <align.h>
+#include <arch/cpuid.h>
+#include <arch/boot/memmap.h>
 
 /* Definitions for identity page mapper */
 pte_t helper_ptl1[512] __attribute__((aligned (PAGE_SIZE)));
@@ -47,6 +49,11 @@ pte_t helper_ptl2[512] __attribute__((aligned (PAGE_SIZE)));
 pte_t helper_ptl3[512] __attribute__((aligned (PAGE_SIZE)));
 extern pte_t ptl_0; /* From boot.S */
 
+/** True if the processor supports 1 GiB pages. */
+bool huge_pages_supported = false;
+
+static bool identity_ram(__address base, size_t size);
+
 #define PTL1_PRESENT(ptl0, page) (!(GET_PTL1_FLAGS_ARCH(ptl0, PTL0_INDEX_ARCH(page)) & PAGE_NOT_PRESENT))
 #define PTL2_PRESENT(ptl1, page) (!(GET_PTL2_FLAGS_ARCH(ptl1, PTL1_INDEX_ARCH(page)) & PAGE_NOT_PRESENT))
 #define PTL3_PRESENT(ptl2, page) (!(GET_PTL3_FLAGS_ARCH(ptl2, PTL2_INDEX_ARCH(page)) & PAGE_NOT_PRESENT))
@@ -73,21 +80,70 @@ extern pte_t ptl_0; /* From boot.S */
     }
 
 
+/** Check whether physical memory range consists of RAM only.
+ *
+ * Large identity mappings must not cover memory mapped devices
+ * or firmware areas, whose memory types set by the MTRRs differ
+ * from the cacheable type of the large page.
+ *
+ * @param base Physical address of the range.
+ * @param size Size of the range.
+ *
+ * @return True if the range is covered by available e820 memory.
+ */
+bool identity_ram(__address base, size_t size)
+{
+	__address cur = base;
+	int i;
+
+	while (cur < base + size) {
+		for (i = 0; i < e820counter; i++) {
+			if (e820table[i].type != MEMMAP_MEMORY_AVAILABLE)
+				continue;
+			if ((e820table[i].base_address <= cur) &&
+			    (cur < e820table[i].base_address + e820table[i].size))
+				break;
+		}
+		if (i == e820counter)
+			return false;
+		cur = e820table[i].base_address + e820table[i].size;
+	}
+	return true;
+}
+
 void page_arch_init(void)
 {
 	__address cur;
 	int i;
 	int identity_flags = PAGE_CACHEABLE | PAGE_EXEC | PAGE_GLOBAL;
+	struct cpu_info cpuid_s;
 
 	if (config.cpu_active == 1) {
 		page_mapping_operations = &pt_mapping_operations;
+
+		cpuid(AMD_CPUID_EXTENDED, &cpuid_s);
+		huge_pages_supported = (cpuid_s.cpuid_edx & (1 << AMD_EXT_PAGE1GB)) != 0;
 		
 		/*
 		 * PA2KA(identity) mapping for all frames.
+		 * Use the largest pages that fit. The first 2 MiB, which
+		 * contain the VGA memory and the BIOS areas, and all ranges
+		 * that are not entirely RAM are mapped by ordinary pages.
 		 */
-		for (cur = 0; cur < last_frame; cur += FRAME_SIZE) {
-			/* Standard identity mapping */
-			page_mapping_insert(AS_KERNEL, PA2KA(cur), cur, identity_flags);
+		for (cur = 0; cur < last_frame; ) {
+			if (huge_pages_supported && cur && !(cur % HUGE_PAGE_SIZE) && (cur + HUGE_PAGE_SIZE <= last_frame) &&
+			    identity_ram(cur, HUGE_PAGE_SIZE)) {
+				page_mapping_insert_large(AS_KERNEL, PA2KA(cur), cur, identity_flags, HUGE_PAGE_SIZE);
+				cur += HUGE_PAGE_SIZE;
+			} else if (cur && !(cur % LARGE_PAGE_SIZE) && (cur + LARGE_PAGE_SIZE <= last_frame) &&
+			    identity_ram(cur, LARGE_PAGE_SIZE)) {
+				page_mapping_insert_large(AS_KERNEL, PA2KA(cur), cur, identity_flags, LARGE_PAGE_SIZE);
+				cur += LARGE_PAGE_SIZE;
+			} else {
+				/* Standard identity mapping */
+				page_mapping_insert(AS_KERNEL, PA2KA(cur), cur, identity_flags);
+				cur += FRAME_SIZE;
+			}
 		}
 		/* Upper kernel mapping
 		 * - from zero to top of kernel (include bottom addresses
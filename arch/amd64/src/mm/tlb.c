@@ -27,28 +27,139 @@
  */
 
 #include <mm/tlb.h>
+#include <arch/mm/tlb.h>
 #include <arch/mm/asid.h>
+#include <mm/asid.h>
 #include <arch/asm.h>
 #include <arch/types.h>
+#include <arch/cpuid.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+
+/** Processor supports Process-Context Identifiers and CR4.PCIDE is set. */
+bool pcid_supported = false;
+/** Processor supports the INVPCID instruction. */
+bool invpcid_supported = false;
+
+/** Detect PCID support and enable it on the current processor.
+ *
+ * Feature detection is done only on the bootstrap processor.
+ * CR4.PCIDE can be set only while the PCID in CR3 is zero, which
+ * holds here because CR3 contains the plain kernel page table.
+ */
+void tlb_arch_init(void)
+{
+	cpu_info_t info;
+
+	if (config.cpu_active == 1) {
+		cpuid(INTEL_CPUID_STANDARD, &info);
+		pcid_supported = (info.cpuid_ecx & (1 << INTEL_PCID)) != 0;
+
+		cpuid(INTEL_CPUID_LEVEL, &info);
+		if (pcid_supported && info.cpuid_eax >= INTEL_CPUID_EXTENDED_FEATURES) {
+			cpuid(INTEL_CPUID_EXTENDED_FEATURES, &info);
+			invpcid_supported = (info.cpuid_ebx & (1 << INTEL_INVPCID)) != 0;
+		}
+	}
+
+	if (pcid_supported)
+		write_cr4(read_cr4() | CR4_PCIDE);
+}
+
+/** Load CR3 and account for the load in per-CPU statistics.
+ *
+ * @param cr3 New CR3 value, possibly including PCID and the no-flush bit.
+ */
+void cr3_load(__address cr3)
+{
+	if (CPU) {
+		if (pcid_supported && (cr3 & CR3_NOFLUSH))
+			CPU->arch.cr3_noflush++;
+		else
+			CPU->arch.cr3_flush++;
+	}
+	write_cr3(cr3);
+}
+
+/** Check and clear the stale mark of a PCID on the current processor.
+ *
+ * Without INVPCID, TLB entries of a PCID other than the current
+ * one cannot be flushed directly. Instead, the PCID is marked
+ * stale and the next load of CR3 with it flushes them.
+ * Interrupts must be disabled.
+ *
+ * @param asid PCID being loaded into CR3.
+ *
+ * @return True if the PCID was stale and CR3 must be loaded with flush.
+ */
+bool pcid_stale_clear(asid_t asid)
+{
+	__u64 bit = 1ULL << (asid % 64);
+
+	if (!(CPU->arch.pcid_stale[asid / 64] & bit))
+		return false;
+	CPU->arch.pcid_stale[asid / 64] &= ~bit;
+	return true;
+}
 
 /** Invalidate all entries in TLB. */
 void tlb_invalidate_all(void)
 {
-	write_cr3(read_cr3());
+	__native cr4;
+
+	if (invpcid_supported) {
+		invpcid(INVPCID_ALL_GLOBAL, 0, 0);
+	} else if (pcid_supported) {
+		/*
+		 * With PCID enabled, CR3 load flushes only the current
+		 * PCID. Toggling CR4.PGE flushes all of them.
+		 */
+		cr4 = read_cr4();
+		write_cr4(cr4 ^ CR4_PGE);
+		write_cr4(cr4);
+	} else {
+		cr3_load(read_cr3());
+	}
 }
 
 /** Invalidate all entries in TLB that belong to specified address space.
  *
- * @param asid This parameter is ignored as the architecture doesn't support it.
+ * @param asid Address space identifier.
  */
 void tlb_invalidate_asid(asid_t asid)
 {
-	tlb_invalidate_all();
+	__native cr3;
+
+	if (!pcid_supported || asid == ASID_KERNEL) {
+		/* Kernel mappings are cached under every PCID. */
+		tlb_invalidate_all();
+		return;
+	}
+
+	if (invpcid_supported) {
+		invpcid(INVPCID_CONTEXT, asid, 0);
+		return;
+	}
+
+	cr3 = read_cr3();
+	if ((cr3 & CR3_PCID_MASK) == asid) {
+		cr3_load(cr3);
+	} else {
+		/*
+		 * Loading CR3 tagged with the victim PCID would let
+		 * speculative page walks fill it with translations of
+		 * the current page tables. Defer the flush to the next
+		 * switch to the victim instead. Interrupts are disabled
+		 * by the callers.
+		 */
+		CPU->arch.pcid_stale[asid / 64] |= 1ULL << (asid % 64);
+	}
 }
 
 /** Invalidate TLB entries for specified page range belonging to specified address space.
  *
- * @param asid This parameter is ignored as the architecture doesn't support it.
+ * @param asid Address space identifier.
  * @param page Address of the first page whose entry is to be invalidated.
  * @param cnt Number of entries to invalidate.
  */
@@ -56,6 +167,18 @@ void tlb_invalidate_pages(asid_t asid, __address page, count_t cnt)
 {
 	int i;
 
-	for (i = 0; i < cnt; i++)
-		invlpg(page + i * PAGE_SIZE);
+	if (pcid_supported && asid == ASID_KERNEL) {
+		tlb_invalidate_all();
+		return;
+	}
+
+	if (!pcid_supported || (read_cr3() & CR3_PCID_MASK) == asid) {
+		for (i = 0; i < cnt; i++)
+			invlpg(page + i * PAGE_SIZE);
+	} else if (invpcid_supported) {
+		for (i = 0; i < cnt; i++)
+			invpcid(INVPCID_ADDRESS, asid, page + i * PAGE_SIZE);
+	} else {
+		tlb_invalidate_asid(asid);
+	}
 }
@@ -40,6 +40,9 @@
 #include <memstr.h>
 #include <mm/slab.h>
 #include <debug.h>
+#include <panic.h>
+#include <arch.h>
+#include <cpu.h>
 
 /*
  * There is no segmentation in long mode so we set up flat mode. In this
@@ -188,8 +191,11 @@ void idt_init(void)
  */
 void pm_init(void)
 {
+	ptr_16_64_t ap_gdtr;
+	ptr_16_64_t *gdtr_p = &gdtr;
 	descriptor_t *gdt_p = (struct descriptor *) gdtr.base;
 	tss_descriptor_t *tss_desc;
+	tss_t *tss_cpu;
 
 	/*
 	 * Each CPU has its private GDT and TSS.
@@ -203,6 +209,7 @@ void pm_init(void)
 		 * the heap hasn't been initialized so far.
 		 */
 		tss_p = &tss;
+		tss_cpu = tss_p;
 	}
 	else {
 		/* We are going to use malloc, which may return
@@ -210,22 +217,37 @@ void pm_init(void)
 		 * ahead of page_init */
 		write_cr3((__address) AS_KERNEL->page_table);
 
-		tss_p = (struct tss *) malloc(sizeof(tss_t), FRAME_ATOMIC);
-		if (!tss_p)
+		/*
+		 * Application processors come up in parallel and
+		 * each of them builds its own copy of the GDT.
+		 */
+		gdt_p = (struct descriptor *) malloc(GDT_ITEMS * sizeof(struct descriptor), FRAME_ATOMIC);
+		if (!gdt_p)
+			panic("could not allocate GDT\n");
+
+		memcpy(gdt_p, gdt, GDT_ITEMS * sizeof(struct descriptor));
+		memsetb((__address) (&gdt_p[TSS_DES]), sizeof(struct descriptor), 0);
+		ap_gdtr.limit = GDT_ITEMS * sizeof(struct descriptor);
+		ap_gdtr.base = (__address) gdt_p;
+		gdtr_p = &ap_gdtr;
+
+		tss_cpu = (struct tss *) malloc(sizeof(tss_t), FRAME_ATOMIC);
+		if (!tss_cpu)
 			panic("could not allocate TSS\n");
+		CPU->arch.tss = tss_cpu;
 	}
 
-	tss_initialize(tss_p);
+	tss_initialize(tss_cpu);
 
 	tss_desc = (tss_descriptor_t *) (&gdt_p[TSS_DES]);
 	tss_desc->present = 1;
 	tss_desc->type = AR_TSS;
 	tss_desc->dpl = PL_KERNEL;
 	
-	gdt_tss_setbase(&gdt_p[TSS_DES], (__address) tss_p);
+	gdt_tss_setbase(&gdt_p[TSS_DES], (__address) tss_cpu);
 	gdt_tss_setlimit(&gdt_p[TSS_DES], TSS_BASIC_SIZE - 1);
 
-	gdtr_load(&gdtr);
+	gdtr_load(gdtr_p);
 	idtr_load(&idtr);
 	/*
 	 * As of this moment, the current CPU has its own GDT pointing
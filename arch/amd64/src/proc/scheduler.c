@@ -52,11 +52,9 @@ void before_thread_runs_arch(void)
 {
 	CPU->arch.tss->rsp0 = (__address) &THREAD->kstack[THREAD_STACK_SIZE-SP_DELTA];
 
-	/* Syscall support - write address of thread stack pointer to 
-	 * hidden part of gs */
-	swapgs();
-	write_msr(AMD_MSR_GS, (__u64)&THREAD->kstack);
-	swapgs();
+	/* Syscall support - write address of thread_arch_t holding
+	 * the syscall stack pointers to hidden part of gs */
+	write_msr(AMD_MSR_KERNEL_GS, (__u64) &THREAD->arch);
 
 	/* TLS support - set FS to thread local storage */
 	write_msr(AMD_MSR_FS, THREAD->arch.tls);
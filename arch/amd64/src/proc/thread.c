@@ -27,6 +27,7 @@
  */
 
 #include <proc/thread.h>
+#include <arch/context.h>	/* SP_DELTA */
 
 /** Perform amd64 specific thread initialization.
  *
@@ -35,4 +36,5 @@
 void thread_create_arch(thread_t *t)
 {
 	t->arch.tls = 0;
+	t->arch.syscall_rsp = (__address) &t->kstack[THREAD_STACK_SIZE-SP_DELTA];
 }
@@ -231,7 +231,12 @@ int l_apic_broadcast_custom_ipi(__u8 vector)
 	return apic_poll_errors();
 }
 
-/** Universal Start-up Algorithm for bringing up the AP processors.
+/** Send INIT IPI to an application processor.
+ *
+ * First half of the Universal Start-up Algorithm. The caller is
+ * supposed to wait 10ms before sending the STARTUP IPIs with
+ * l_apic_send_startup_ipi(). This way, the wait can be shared
+ * by all processors being brought up.
  *
  * @param apicid APIC ID of the processor to be brought up.
  *
@@ -240,7 +245,6 @@ int l_apic_broadcast_custom_ipi(__u8 vector)
 int l_apic_send_init_ipi(__u8 apicid)
 {
 	icr_t icr;
-	int i;
 
 	/*
 	 * Read the ICR register in and zero all non-reserved fields.
@@ -279,26 +283,44 @@ int l_apic_send_init_ipi(__u8 apicid)
 	icr.vector = 0;
 	l_apic[ICRlo] = icr.lo;
 
+	return apic_poll_errors();
+}
+
+/** Send STARTUP IPIs to an application processor.
+ *
+ * Second half of the Universal Start-up Algorithm. 82489DX-based
+ * local APICs do not know STARTUP IPIs and start the processor
+ * from the warm-reset vector already upon the INIT IPI.
+ *
+ * @param apicid APIC ID of the processor to be brought up.
+ *
+ * @return 0 on failure, 1 on success.
+ */
+int l_apic_send_startup_ipi(__u8 apicid)
+{
+	icr_t icr;
+	int i;
+
+	if (is_82489DX_apic(l_apic[LAVR]))
+		return 1;
+
+	icr.hi = l_apic[ICRhi];
+	icr.dest = apicid;
+	l_apic[ICRhi] = icr.hi;
+
 	/*
-	 * Wait 10ms as MP Specification specifies.
+	 * If this is not 82489DX-based l_apic we must send two STARTUP IPI's.
 	 */
-	delay(10000);
-
-	if (!is_82489DX_apic(l_apic[LAVR])) {
-		/*
-		 * If this is not 82489DX-based l_apic we must send two STARTUP IPI's.
-		 */
-		for (i = 0; i<2; i++) {
-			icr.lo = l_apic[ICRlo];
-			icr.vector = ((__address) ap_boot) / 4096; /* calculate the reset vector */
-			icr.delmod = DELMOD_STARTUP;
-			icr.destmod = DESTMOD_PHYS;
-			icr.level = LEVEL_ASSERT;
-			icr.shorthand = SHORTHAND_NONE;
-			icr.trigger_mode = TRIGMOD_LEVEL;
-			l_apic[ICRlo] = icr.lo;
-			delay(200);
-		}
+	for (i = 0; i<2; i++) {
+		icr.lo = l_apic[ICRlo];
+		icr.vector = ((__address) ap_boot) / 4096; /* calculate the reset vector */
+		icr.delmod = DELMOD_STARTUP;
+		icr.destmod = DESTMOD_PHYS;
+		icr.level = LEVEL_ASSERT;
+		icr.shorthand = SHORTHAND_NONE;
+		icr.trigger_mode = TRIGMOD_LEVEL;
+		l_apic[ICRlo] = icr.lo;
+		delay(200);
 	}
 	
 	return apic_poll_errors();
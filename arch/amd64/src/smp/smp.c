@@ -48,6 +48,10 @@
 #include <print.h>
 #include <memstr.h>
 #include <arch/drivers/i8259.h>
+#include <arch/smp/apic.h>
+#include <arch/context.h>
+#include <proc/thread.h>
+#include <time/delay.h>
 
 #ifdef CONFIG_SMP
 
@@ -86,16 +90,59 @@ void smp_init(void)
         }
 }
 
+/** Boot stacks of the application processors, indexed by local APIC ID.
+ *
+ * An AP claims its stack in ap_boot() by swapping zero into its slot.
+ * An AP that finds its slot zero parks itself for good, so a stack
+ * withdrawn by kmp is never used.
+ */
+atomic_t ap_boot_stacks[AP_BOOT_STACKS];
+
+/** Check whether the processor entry describes a startable AP. */
+static bool ap_startable(int i)
+{
+	/*
+	 * Skip processors marked unusable.
+	 */
+	if (!ops->cpu_enabled(i))
+		return false;
+
+	/*
+	 * The bootstrap processor is already up.
+	 */
+	if (ops->cpu_bootstrap(i))
+		return false;
+
+	if (ops->cpu_apic_id(i) == l_apic_id()) {
+		printf("%s: bad processor entry #%d, will not send IPI to myself\n", __FUNCTION__, i);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * Kernel thread for bringing up application processors. It becomes clear
  * that we need an arrangement like this (AP's being initialized by a kernel
- * thread), for a thread has its dedicated stack. (The stack used during the
- * BSP initialization (prior the very first call to scheduler()) will be used
- * as an initialization stack for each AP.)
+ * thread), for a thread has its dedicated stack.
+ *
+ * The application processors are started in a batch. All of them receive
+ * the INIT IPI first so that the mandatory 10ms wait is paid only once.
+ * Then each AP gets its own boot stack and the STARTUP IPIs. The next AP
+ * is started as soon as the previous one has taken its CPU number and
+ * left the shared trampoline, so that the rest of their initialization
+ * proceeds in parallel.
  */
 void kmp(void *arg)
 {
-	int i;
+	int i, j;
+	int started = 0;
+	bool batch;
+	bool *initialized;
+	__address *stacks;
+	__address sp;
+	__u8 apic_id;
+	count_t active;
 	
 	ASSERT(ops != NULL);
 
@@ -122,49 +169,114 @@ void kmp(void *arg)
 	pic_disable_irqs(0xffff);
 	apic_init();
 
+	/*
+	 * The trampoline code uses the GDT of the bootstrap processor.
+	 * Each AP builds its private copy in pm_init().
+	 */
+	protected_ap_gdtr.limit = GDT_ITEMS * sizeof(struct descriptor);
+	protected_ap_gdtr.base = KA2PA((__address) gdt);
+
+	initialized = (bool *) malloc(ops->cpu_count() * sizeof(bool), 0);
+	stacks = (__address *) malloc(ops->cpu_count() * sizeof(__address), 0);
+	memsetb((__address) stacks, ops->cpu_count() * sizeof(__address), 0);
+
+	/*
+	 * 82489DX-based local APICs start the processor already upon
+	 * the INIT IPI. Such processors must be started one by one.
+	 */
+	batch = !is_82489DX_apic(l_apic[LAVR]);
+
 	for (i = 0; i < ops->cpu_count(); i++) {
-		struct descriptor *gdt_new;
-	
-		/*
-		 * Skip processors marked unusable.
-		 */
-		if (!ops->cpu_enabled(i))
+		initialized[i] = false;
+		if (!batch || !ap_startable(i))
 			continue;
 
-		/*
-		 * The bootstrap processor is already up.
-		 */
-		if (ops->cpu_bootstrap(i))
-			continue;
+		initialized[i] = l_apic_send_init_ipi(ops->cpu_apic_id(i));
+		if (!initialized[i])
+			printf("INIT IPI for l_apic%d failed\n", ops->cpu_apic_id(i));
+	}
 
-		if (ops->cpu_apic_id(i) == l_apic_id()) {
-			printf("%s: bad processor entry #%d, will not send IPI to myself\n", __FUNCTION__, i);
-			continue;
+	/*
+	 * Wait 10ms as MP Specification specifies.
+	 */
+	if (batch)
+		delay(10000);
+
+	for (i = 0; i < ops->cpu_count(); i++) {
+		if (batch) {
+			if (!initialized[i])
+				continue;
+		} else {
+			if (!ap_startable(i))
+				continue;
+			if (!l_apic_send_init_ipi(ops->cpu_apic_id(i))) {
+				printf("INIT IPI for l_apic%d failed\n", ops->cpu_apic_id(i));
+				continue;
+			}
+			delay(10000);
 		}
-		
-		/*
-		 * Prepare new GDT for CPU in question.
-		 */
-		if (!(gdt_new = (struct descriptor *) malloc(GDT_ITEMS*sizeof(struct descriptor), FRAME_ATOMIC)))
-			panic("couldn't allocate memory for GDT\n");
-
-		memcpy(gdt_new, gdt, GDT_ITEMS * sizeof(struct descriptor));
-		memsetb((__address)(&gdt_new[TSS_DES]), sizeof(struct descriptor), 0);
-		protected_ap_gdtr.limit = GDT_ITEMS * sizeof(struct descriptor);
-		protected_ap_gdtr.base = KA2PA((__address) gdt_new);
-		gdtr.base = (__address) gdt_new;
-
-		if (l_apic_send_init_ipi(ops->cpu_apic_id(i))) {
+
+		apic_id = ops->cpu_apic_id(i);
+		stacks[i] = PA2KA(PFN2ADDR(frame_alloc(STACK_FRAMES, FRAME_KA)));
+		sp = stacks[i] + THREAD_STACK_SIZE - SP_DELTA;
+		atomic_set(&ap_boot_stacks[apic_id], (long) sp);
+		active = config.cpu_active;
+
+		if (!l_apic_send_startup_ipi(apic_id)) {
+			printf("STARTUP IPI for l_apic%d failed\n", apic_id);
+		} else {
 			/*
-			 * There may be just one AP being initialized at
-			 * the time. After it comes completely up, it is
-			 * supposed to wake us up.
+			 * Wait until the AP takes its CPU number in main_ap().
+			 * The APs take their numbers one by one, so only then
+			 * we can proceed to the next one.
 			 */
-			if (waitq_sleep_timeout(&ap_completion_wq, 1000000, SYNCH_FLAGS_NONE) == ESYNCH_TIMEOUT)
-				printf("%s: waiting for cpu%d (APIC ID = %d) timed out\n", __FUNCTION__, config.cpu_active > i ? config.cpu_active : i, ops->cpu_apic_id(i));
-		} else
-			printf("INIT IPI for l_apic%d failed\n", ops->cpu_apic_id(i));
+			for (j = 0; (config.cpu_active == active) && (j < 1000); j++)
+				delay(1000);
+		}
+
+		if (config.cpu_active == active) {
+			/*
+			 * Withdraw the boot stack. If the AP has not claimed
+			 * it yet, it will park itself once it comes up and
+			 * the stack can be released. Otherwise the AP is
+			 * already running and we must wait for its number.
+			 */
+			if (atomic_cas(&ap_boot_stacks[apic_id], (long) sp, 0)) {
+				printf("%s: starting l_apic%d timed out\n", __FUNCTION__, apic_id);
+				frame_free(ADDR2PFN(KA2PA(stacks[i])));
+				stacks[i] = 0;
+				continue;
+			}
+			while (config.cpu_active == active)
+				delay(1000);
+		}
+
+		started++;
+	}
+
+	/*
+	 * Each started AP is supposed to wake us up after it comes
+	 * completely up.
+	 */
+	for (i = 0; i < started; i++) {
+		if (waitq_sleep_timeout(&ap_completion_wq, 1000000, SYNCH_FLAGS_NONE) == ESYNCH_TIMEOUT) {
+			printf("%s: waiting for %d cpu(s) timed out\n", __FUNCTION__, started - i);
+			break;
+		}
 	}
+
+	/*
+	 * Release the boot stacks unless some AP might still be using one.
+	 */
+	if (i == started) {
+		for (i = 0; i < ops->cpu_count(); i++) {
+			if (stacks[i])
+				frame_free(ADDR2PFN(KA2PA(stacks[i])));
+		}
+	}
+
+	free(stacks);
+	free(initialized);
 }
 
 int smp_irq_to_pin(int irq)
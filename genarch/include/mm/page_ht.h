@@ -39,15 +39,22 @@
 #include <typedefs.h>
 #include <arch/types.h>
 #include <adt/list.h>
-#include <adt/hash_table.h>
+#include <adt/rhash_table.h>
 
 #define PAGE_HT_KEYS	2
 #define KEY_AS		0
 #define KEY_PAGE	1
 
+/** Initial number of buckets, the table grows with the number of mappings. */
 #define PAGE_HT_ENTRIES_BITS	13
 #define PAGE_HT_ENTRIES		(1<<PAGE_HT_ENTRIES_BITS)
 
+/** Multiplier of the page hash, the 32-bit golden ratio prime. */
+#define PAGE_HT_MIX		0x9e3779b1
+
+/** Number of chain lengths distinguished by ht_print_histogram(). */
+#define PAGE_HT_HISTOGRAM	8
+
 #define PTE_VALID(pte)		((pte) != NULL)
 #define PTE_PRESENT(pte)	((pte)->p != 0)
 #define PTE_GET_FRAME(pte)	((pte)->frame)
@@ -73,9 +80,10 @@ struct pte {
 };
 
 extern page_mapping_operations_t ht_mapping_operations;
-extern mutex_t page_ht_lock;
-extern hash_table_t page_ht;
-extern hash_table_operations_t ht_operations;
+extern rhash_table_t page_ht;
+extern rhash_table_operations_t ht_operations;
+
+extern void ht_print_histogram(void);
 
 #endif
 
@@ -38,7 +38,7 @@
 #include <arch/types.h>
 #include <typedefs.h>
 #include <memstr.h>
-#include <adt/hash_table.h>
+#include <adt/rhash_table.h>
 #include <synch/mutex.h>
 
 static pte_t *ht_create(int flags);
@@ -67,8 +67,7 @@ as_operations_t as_ht_operations = {
 pte_t *ht_create(int flags)
 {
 	if (flags & FLAG_AS_KERNEL) {
-		hash_table_create(&page_ht, PAGE_HT_ENTRIES, 2, &ht_operations);
-		mutex_initialize(&page_ht_lock);
+		rhash_table_create(&page_ht, PAGE_HT_ENTRIES, 2, &ht_operations);
 	}
 	return NULL;
 }
@@ -86,8 +85,14 @@ void ht_destroy(pte_t *page_table)
 
 /** Lock page table.
  *
- * Lock address space and page hash table.
- * Interrupts must be disabled.
+ * Lock address space and its part of the page hash table.
+ * Page faults change mappings without the address space
+ * lock, so the per-address space page table mutex is what
+ * serializes the changes. The page hash table locks its
+ * buckets itself, so mappings of different address spaces
+ * can be changed in parallel.
+ * The page table mutex may sleep, so it must be taken before
+ * a TLB shootdown sequence is started and not within it.
  *
  * @param as Address space.
  * @param lock If false, do not attempt to lock the address space.
@@ -96,20 +101,20 @@ void ht_lock(as_t *as, bool lock)
 {
 	if (lock)
 		mutex_lock(&as->lock);
-	mutex_lock(&page_ht_lock);
+	mutex_lock(&as->page_table_mutex);
 }
 
 /** Unlock page table.
  *
- * Unlock address space and page hash table.
- * Interrupts must be disabled.
+ * Unlock the address space's part of the page hash table
+ * and the address space.
  *
  * @param as Address space.
- * @param unlock If false, do not attempt to lock the address space.
+ * @param unlock If false, do not attempt to unlock the address space.
  */
 void ht_unlock(as_t *as, bool unlock)
 {
-	mutex_unlock(&page_ht_lock);
+	mutex_unlock(&as->page_table_mutex);
 	if (unlock)
 		mutex_unlock(&as->lock);
 }
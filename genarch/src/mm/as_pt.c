@@ -109,8 +109,10 @@ void ptl0_destroy(pte_t *page_table)
 
 /** Lock page tables.
  *
- * Lock only the address space.
- * Interrupts must be disabled.
+ * Lock the address space and its page tables.
+ * The page table lock is a mutex and may sleep. It must
+ * therefore be taken before a TLB shootdown sequence is
+ * started and not within it.
  *
  * @param as Address space.
  * @param lock If false, do not attempt to lock the address space.
@@ -119,18 +121,19 @@ void pt_lock(as_t *as, bool lock)
 {
 	if (lock)
 		mutex_lock(&as->lock);
+	mutex_lock(&as->page_table_mutex);
 }
 
 /** Unlock page tables.
  *
- * Unlock the address space.
- * Interrupts must be disabled.
+ * Unlock the page tables and the address space.
  *
  * @param as Address space.
  * @param unlock If false, do not attempt to unlock the address space.
  */
 void pt_unlock(as_t *as, bool unlock)
 {
+	mutex_unlock(&as->page_table_mutex);
 	if (unlock)
 		mutex_unlock(&as->lock);
 }
@@ -60,6 +60,8 @@
 #include <synch/mutex.h>
 #include <arch.h>
 #include <adt/list.h>
+#include <atomic.h>
+#include <arch/barrier.h>
 #include <debug.h>
 
 /**
@@ -71,7 +73,7 @@ static count_t asids_allocated = 0;
 
 /** Allocate free address space identifier.
  *
- * Interrupts must be disabled and inactive_as_with_asid_lock must be held
+ * Interrupts must be disabled and as_with_asid_lock must be held
  * prior to this call
  *
  * @return New ASID.
@@ -95,16 +97,32 @@ asid_t asid_get(void)
 		 */
 		
 		/*
-		 * Remove the first item on the list.
-		 * It is guaranteed to belong to an
-		 * inactive address space.
+		 * The list of address spaces with ASID is not
+		 * updated by as_switch() and so it can contain
+		 * active address spaces. Walk it from the oldest
+		 * assignment and move active address spaces to
+		 * its end until an inactive one is found. There
+		 * is always one as ASIDS_ALLOCABLE is greater than
+		 * the number of processors.
 		 */
-		ASSERT(!list_empty(&inactive_as_with_asid_head));
-		tmp = inactive_as_with_asid_head.next;
-		list_remove(tmp);
-		
-		as = list_get_instance(tmp, as_t, inactive_as_with_asid_link);
-		mutex_lock_active(&as->lock);
+		while (true) {
+			ASSERT(!list_empty(&as_with_asid_head));
+			tmp = as_with_asid_head.next;
+			list_remove(tmp);
+			as = list_get_instance(tmp, as_t, as_with_asid_link);
+
+			/*
+			 * Announce the intent to steal before looking
+			 * at cpu_refcount. as_switch() does the same
+			 * in the reverse order.
+			 */
+			as->asid_steal = true;
+			memory_barrier();
+			if (atomic_get(&as->cpu_refcount) == 0)
+				break;
+			as->asid_steal = false;
+			list_append(tmp, &as_with_asid_head);
+		}
 
 		/*
 		 * Steal the ASID.
@@ -118,7 +136,8 @@ asid_t asid_get(void)
 		 * was stolen by invalidating its asid member.
 		 */
 		as->asid = ASID_INVALID;
-		mutex_unlock(&as->lock);
+		write_barrier();
+		as->asid_steal = false;
 
 		/*
 		 * Get the system rid of the stolen ASID.
@@ -45,10 +45,12 @@
 #include <arch.h>
 #include <debug.h>
 #include <memstr.h>
-#include <adt/hash_table.h>
+#include <adt/rhash_table.h>
+#include <print.h>
 #include <align.h>
 
-static index_t hash(__native key[]);
+static __native hash(__native key[]);
+static __native hash_item(link_t *item);
 static bool compare(__native key[], count_t keys, link_t *item);
 static void remove_callback(link_t *item);
 
@@ -56,22 +58,19 @@ static void ht_mapping_insert(as_t *as, __address page, __address frame, int fla
 static void ht_mapping_remove(as_t *as, __address page);
 static pte_t *ht_mapping_find(as_t *as, __address page);
 
-/**
- * This lock protects the page hash table. It must be acquired
- * after address space lock and after any address space area
- * locks.
- */
-mutex_t page_ht_lock;
-
 /**
  * Page hash table.
- * The page hash table may be accessed only when page_ht_lock is held.
+ * The page hash table locks its buckets itself. Mappings of one
+ * address space are only inserted, removed and looked up with the
+ * address space lock held, which keeps a PTE returned by
+ * ht_mapping_find() valid until the lock is released.
  */
-hash_table_t page_ht;
+rhash_table_t page_ht;
 
 /** Hash table operations for page hash table. */
-hash_table_operations_t ht_operations = {
+rhash_table_operations_t ht_operations = {
 	.hash = hash,
+	.hash_item = hash_item,
 	.compare = compare,
 	.remove_callback = remove_callback
 };
@@ -83,33 +82,47 @@ page_mapping_operations_t ht_mapping_operations = {
 	.mapping_find = ht_mapping_find
 };
 
-/** Compute page hash table index.
+/** Compute page hash.
  *
  * @param key Array of two keys (i.e. page and address space).
  *
- * @return Index into page hash table.
+ * @return Hash of the page and the address space.
  */
-index_t hash(__native key[])
+__native hash(__native key[])
 {
-	as_t *as = (as_t *) key[KEY_AS];
-	__address page = (__address) key[KEY_PAGE];
-	index_t index;
-	
-	/*
-	 * Virtual page addresses have roughly the same probability
-	 * of occurring. Least significant bits of VPN compose the
-	 * hash index.
-	 */
-	index = ((page >> PAGE_WIDTH) & (PAGE_HT_ENTRIES-1));
-	
+	__native h;
+
 	/*
-	 * Address space structures are likely to be allocated from
-	 * similar addresses. Least significant bits compose the
-	 * hash index.
+	 * Address space structures come from the slab allocator and
+	 * share their low bits, while consecutive pages differ only
+	 * in their low VPN bits. Neither can be used directly. Combine
+	 * both and mix the high bits of the product into the low ones,
+	 * which the table uses.
 	 */
-	index |= ((__native) as) & (PAGE_HT_ENTRIES-1);
-	
-	return index;
+	h = (key[KEY_PAGE] >> PAGE_WIDTH) + (key[KEY_AS] >> 4) * PAGE_HT_MIX;
+	h ^= h >> (sizeof(__native) * 4);
+	h *= PAGE_HT_MIX;
+	h ^= h >> (sizeof(__native) * 4);
+
+	return h;
+}
+
+/** Compute page hash of page hash table item.
+ *
+ * @param item Page hash table item.
+ *
+ * @return Hash of the page and the address space of the item.
+ */
+__native hash_item(link_t *item)
+{
+	pte_t *t;
+	__native key[2];
+
+	t = rhash_table_get_instance(item, pte_t, link);
+	key[KEY_AS] = (__native) t->as;
+	key[KEY_PAGE] = t->page;
+
+	return hash(key);
 }
 
 /** Compare page hash table item with page and/or address space.
@@ -130,7 +143,7 @@ bool compare(__native key[], count_t keys, link_t *item)
 	/*
 	 * Convert item to PTE.
 	 */
-	t = hash_table_get_instance(item, pte_t, link);
+	t = rhash_table_get_instance(item, pte_t, link);
 
 	if (keys == PAGE_HT_KEYS) {
 		return (key[KEY_AS] == (__address) t->as) && (key[KEY_PAGE] == t->page);
@@ -152,7 +165,7 @@ void remove_callback(link_t *item)
 	/*
 	 * Convert item to PTE.
 	 */
-	t = hash_table_get_instance(item, pte_t, link);
+	t = rhash_table_get_instance(item, pte_t, link);
 
 	free(t);
 }
@@ -174,7 +187,7 @@ void ht_mapping_insert(as_t *as, __address page, __address frame, int flags)
 	pte_t *t;
 	__native key[2] = { (__address) as, page = ALIGN_DOWN(page, PAGE_SIZE) };
 	
-	if (!hash_table_find(&page_ht, key)) {
+	if (!rhash_table_find(&page_ht, key)) {
 		t = (pte_t *) malloc(sizeof(pte_t), FRAME_ATOMIC);
 		ASSERT(t != NULL);
 
@@ -189,7 +202,7 @@ void ht_mapping_insert(as_t *as, __address page, __address frame, int flags)
 		t->page = ALIGN_DOWN(page, PAGE_SIZE);
 		t->frame = ALIGN_DOWN(frame, FRAME_SIZE);
 
-		hash_table_insert(&page_ht, key, &t->link);
+		rhash_table_insert(&page_ht, key, &t->link);
 	}
 }
 
@@ -212,7 +225,7 @@ void ht_mapping_remove(as_t *as, __address page)
 	 * Note that removed PTE's will be freed
 	 * by remove_callback().
 	 */
-	hash_table_remove(&page_ht, key, 2);
+	rhash_table_remove(&page_ht, key, 2);
 }
 
 
@@ -233,9 +246,23 @@ pte_t *ht_mapping_find(as_t *as, __address page)
 	pte_t *t = NULL;
 	__native key[2] = { (__address) as, page = ALIGN_DOWN(page, PAGE_SIZE) };
 	
-	hlp = hash_table_find(&page_ht, key);
+	hlp = rhash_table_find(&page_ht, key);
 	if (hlp)
-		t = hash_table_get_instance(hlp, pte_t, link);
+		t = rhash_table_get_instance(hlp, pte_t, link);
 
 	return t;
 }
+
+/** Print histogram of page hash table chain lengths. */
+void ht_print_histogram(void)
+{
+	count_t hist[PAGE_HT_HISTOGRAM];
+	index_t i;
+
+	rhash_table_histogram(&page_ht, hist, PAGE_HT_HISTOGRAM);
+
+	printf("mappings: %zd\n", atomic_get(&page_ht.items));
+	printf("chain   buckets\n");
+	for (i = 0; i < PAGE_HT_HISTOGRAM; i++)
+		printf("%2zd%s %9zd\n", i, i == PAGE_HT_HISTOGRAM - 1 ? "+" : " ", hist[i]);
+}
@@ -41,21 +41,36 @@
 #include <typedefs.h>
 #include <arch/asm.h>
 #include <memstr.h>
+#include <debug.h>
 
 static void pt_mapping_insert(as_t *as, __address page, __address frame, int flags);
+static void pt_mapping_insert_large(as_t *as, __address page, __address frame, int flags, size_t size);
 static void pt_mapping_remove(as_t *as, __address page);
+static void pt_mapping_remove_large(as_t *as, __address page, size_t size);
 static pte_t *pt_mapping_find(as_t *as, __address page);
+static pte_t *pt_mapping_find_size(as_t *as, __address page, size_t *size);
+
+static void pt_split_huge(pte_t *ptl1, index_t i);
+static void pt_split_large(pte_t *ptl2, index_t i);
+static bool pt_table_empty(pte_t *pt, count_t entries);
 
 page_mapping_operations_t pt_mapping_operations = {
 	.mapping_insert = pt_mapping_insert,
+	.mapping_insert_large = pt_mapping_insert_large,
 	.mapping_remove = pt_mapping_remove,
-	.mapping_find = pt_mapping_find
+	.mapping_remove_large = pt_mapping_remove_large,
+	.mapping_find = pt_mapping_find,
+	.mapping_find_size = pt_mapping_find_size
 };
 
+#define PTL2_IS_HUGE(ptl1, page)	(GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_LARGE)
+#define PTL3_IS_LARGE(ptl2, page)	(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_LARGE)
+
 /** Map page to frame using hierarchical page tables.
  *
  * Map virtual address page to physical address frame
- * using flags.
+ * using flags. If page is covered by a large mapping,
+ * the large mapping is split first.
  *
  * The page table must be locked and interrupts must be disabled.
  *
@@ -80,6 +95,9 @@ void pt_mapping_insert(as_t *as, __address page, __address frame, int flags)
 
 	ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
 
+	if (PTL2_IS_HUGE(ptl1, page))
+		pt_split_huge(ptl1, PTL1_INDEX(page));
+
 	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT) {
 		newpt = PA2KA(PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_KA)));
 		memsetb(newpt, PAGE_SIZE, 0);
@@ -89,6 +107,9 @@ void pt_mapping_insert(as_t *as, __address page, __address frame, int flags)
 
 	ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
 
+	if (PTL3_IS_LARGE(ptl2, page))
+		pt_split_large(ptl2, PTL2_INDEX(page));
+
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) {
 		newpt = PA2KA(PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_KA)));
 		memsetb(newpt, PAGE_SIZE, 0);
@@ -102,13 +123,131 @@ void pt_mapping_insert(as_t *as, __address page, __address frame, int flags)
 	SET_FRAME_FLAGS(ptl3, PTL3_INDEX(page), flags);
 }
 
+/** Map large page to frame using hierarchical page tables.
+ *
+ * Map LARGE_PAGE_SIZE or HUGE_PAGE_SIZE bytes of virtual memory
+ * starting at page by a single PTL2 or PTL1 entry, respectively.
+ * The whole range must not be mapped yet.
+ *
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as Address space to wich page belongs.
+ * @param page Virtual address of the large page, aligned to size.
+ * @param frame Physical address of the large frame, aligned to size.
+ * @param flags Flags to be used for mapping.
+ * @param size Either LARGE_PAGE_SIZE or HUGE_PAGE_SIZE.
+ */
+void pt_mapping_insert_large(as_t *as, __address page, __address frame, int flags, size_t size)
+{
+	pte_t *ptl0, *ptl1, *ptl2;
+	__address newpt;
+
+	ASSERT((size == LARGE_PAGE_SIZE) || (size == HUGE_PAGE_SIZE));
+
+	ptl0 = (pte_t *) PA2KA((__address) as->page_table);
+
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT) {
+		newpt = PA2KA(PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_KA)));
+		memsetb(newpt, PAGE_SIZE, 0);
+		SET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page), KA2PA(newpt));
+		SET_PTL1_FLAGS(ptl0, PTL0_INDEX(page), PAGE_PRESENT | PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE | PAGE_WRITE);
+	}
+
+	ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+
+	if (size == HUGE_PAGE_SIZE) {
+		ASSERT(GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT);
+		SET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page), frame);
+		SET_PTL2_FLAGS(ptl1, PTL1_INDEX(page), flags | PAGE_LARGE);
+		return;
+	}
+
+	if (PTL2_IS_HUGE(ptl1, page))
+		pt_split_huge(ptl1, PTL1_INDEX(page));
+
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT) {
+		newpt = PA2KA(PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_KA)));
+		memsetb(newpt, PAGE_SIZE, 0);
+		SET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page), KA2PA(newpt));
+		SET_PTL2_FLAGS(ptl1, PTL1_INDEX(page), PAGE_PRESENT | PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE | PAGE_WRITE);
+	}
+
+	ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+
+	ASSERT(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT);
+	SET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page), frame);
+	SET_PTL3_FLAGS(ptl2, PTL2_INDEX(page), flags | PAGE_LARGE);
+}
+
+/** Split huge mapping into large mappings.
+ *
+ * The PTL1 entry mapping a huge page is replaced by a pointer
+ * to a new PTL2 table with large mappings of the same memory.
+ *
+ * @param ptl1 PTL1 table containing the huge mapping.
+ * @param i Index of the huge mapping in ptl1.
+ */
+void pt_split_huge(pte_t *ptl1, index_t i)
+{
+	__address frame, newpt;
+	int flags;
+	index_t j;
+
+	frame = (__address) GET_PTL2_ADDRESS(ptl1, i);
+	flags = GET_PTL2_FLAGS(ptl1, i);
+
+	newpt = PA2KA(PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_KA)));
+	memsetb(newpt, PAGE_SIZE, 0);
+	for (j = 0; j < PTL2_ENTRIES; j++) {
+		SET_PTL3_ADDRESS((pte_t *) newpt, j, frame + j * LARGE_PAGE_SIZE);
+		SET_PTL3_FLAGS((pte_t *) newpt, j, flags);
+	}
+
+	SET_PTL2_ADDRESS(ptl1, i, KA2PA(newpt));
+	SET_PTL2_FLAGS(ptl1, i, PAGE_PRESENT | PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE | PAGE_WRITE);
+}
+
+/** Split large mapping into ordinary mappings.
+ *
+ * The PTL2 entry mapping a large page is replaced by a pointer
+ * to a new PTL3 table with ordinary mappings of the same memory.
+ * The translations do not change and thus no TLB shootdown is needed.
+ *
+ * @param ptl2 PTL2 table containing the large mapping.
+ * @param i Index of the large mapping in ptl2.
+ */
+void pt_split_large(pte_t *ptl2, index_t i)
+{
+	__address frame, newpt;
+	int flags;
+	index_t j;
+
+	frame = (__address) GET_PTL3_ADDRESS(ptl2, i);
+	flags = GET_PTL3_FLAGS(ptl2, i) & ~PAGE_LARGE;
+
+	newpt = PA2KA(PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_KA)));
+	memsetb(newpt, PAGE_SIZE, 0);
+	for (j = 0; j < PTL3_ENTRIES; j++) {
+		SET_FRAME_ADDRESS((pte_t *) newpt, j, frame + j * PAGE_SIZE);
+		SET_FRAME_FLAGS((pte_t *) newpt, j, flags);
+	}
+
+	SET_PTL3_ADDRESS(ptl2, i, KA2PA(newpt));
+	SET_PTL3_FLAGS(ptl2, i, PAGE_PRESENT | PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE | PAGE_WRITE);
+}
+
 /** Remove mapping of page from hierarchical page tables.
  *
  * Remove any mapping of page within address space as.
  * TLB shootdown should follow in order to make effects of
  * this call visible.
  *
- * Empty page tables except PTL0 are freed.
+ * Empty page tables except PTL0 are freed. If page
+ * is covered by a large mapping, the large mapping is split
+ * and only the mapping of page is removed. The split allocates
+ * memory and may sleep, so it must not happen within a TLB
+ * shootdown sequence. Whole large pages are to be removed by
+ * pt_mapping_remove_large() instead.
  *
  * The page table must be locked and interrupts must be disabled.
  *
@@ -135,11 +274,17 @@ void pt_mapping_remove(as_t *as, __address page)
 	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+	if (PTL2_IS_HUGE(ptl1, page))
+		pt_split_huge(ptl1, PTL1_INDEX(page));
+
 	ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
 
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+	if (PTL3_IS_LARGE(ptl2, page))
+		pt_split_large(ptl2, PTL2_INDEX(page));
+
 	ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 
 	/* Destroy the mapping. Setting to PAGE_NOT_PRESENT is not sufficient. */
@@ -226,6 +371,80 @@ void pt_mapping_remove(as_t *as, __address page)
 
 }
 
+/** Remove large mapping from hierarchical page tables.
+ *
+ * Remove the single PTL2 or PTL1 entry that maps the LARGE_PAGE_SIZE
+ * or HUGE_PAGE_SIZE bytes of virtual memory starting at page. Unlike
+ * pt_mapping_remove(), the large mapping is not split and thus no
+ * memory needs to be allocated. Only a large page that is part of a
+ * huge page is split, as that is a partial removal of the huge page.
+ * TLB shootdown should follow in order to make effects of this call
+ * visible. Emptied PTL2 and PTL1 tables are freed.
+ *
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as Address space to wich page belongs.
+ * @param page Virtual address of the large page, aligned to size.
+ * @param size Either LARGE_PAGE_SIZE or HUGE_PAGE_SIZE.
+ */
+void pt_mapping_remove_large(as_t *as, __address page, size_t size)
+{
+	pte_t *ptl0, *ptl1, *ptl2;
+
+	ASSERT((size == LARGE_PAGE_SIZE) || (size == HUGE_PAGE_SIZE));
+
+	ptl0 = (pte_t *) PA2KA((__address) as->page_table);
+
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	if (size == HUGE_PAGE_SIZE) {
+		ASSERT(PTL2_IS_HUGE(ptl1, page));
+		memsetb((__address) &ptl1[PTL1_INDEX(page)], sizeof(pte_t), 0);
+	} else {
+		if (PTL2_IS_HUGE(ptl1, page))
+			pt_split_huge(ptl1, PTL1_INDEX(page));
+
+		ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+
+		ASSERT(PTL3_IS_LARGE(ptl2, page));
+		memsetb((__address) &ptl2[PTL2_INDEX(page)], sizeof(pte_t), 0);
+
+		if (!pt_table_empty(ptl2, PTL2_ENTRIES))
+			return;
+		frame_free(ADDR2PFN(KA2PA((__address) ptl2)));
+		memsetb((__address) &ptl1[PTL1_INDEX(page)], sizeof(pte_t), 0);
+	}
+
+	if (!pt_table_empty(ptl1, PTL1_ENTRIES))
+		return;
+	frame_free(ADDR2PFN(KA2PA((__address) ptl1)));
+	memsetb((__address) &ptl0[PTL0_INDEX(page)], sizeof(pte_t), 0);
+}
+
+/** Check whether page table contains no valid entries.
+ *
+ * @param pt Page table.
+ * @param entries Number of entries in pt.
+ *
+ * @return True if no entry of pt is valid, false otherwise.
+ */
+bool pt_table_empty(pte_t *pt, count_t entries)
+{
+	index_t i;
+
+	for (i = 0; i < entries; i++) {
+		if (PTE_VALID(&pt[i]))
+			return false;
+	}
+	return true;
+}
+
 /** Find mapping for virtual page in hierarchical page tables.
  *
  * Find mapping for virtual page.
@@ -236,8 +455,29 @@ void pt_mapping_remove(as_t *as, __address page)
  * @param page Virtual page.
  *
  * @return NULL if there is no such mapping; entry from PTL3 describing the mapping otherwise.
+ *	   If page is covered by a large mapping, the PTL2 or PTL1 entry describing
+ *	   the whole large page is returned, see pt_mapping_find_size().
  */
 pte_t *pt_mapping_find(as_t *as, __address page)
+{
+	size_t size;
+
+	return pt_mapping_find_size(as, page, &size);
+}
+
+/** Find mapping for virtual page in hierarchical page tables and its page size.
+ *
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as Address space to which page belongs.
+ * @param page Virtual page.
+ * @param size Address where to store the size of the page mapped by the returned
+ *	       entry, i.e. PAGE_SIZE, LARGE_PAGE_SIZE or HUGE_PAGE_SIZE.
+ *
+ * @return NULL if there is no such mapping; entry from the page table level
+ *	   that maps the page otherwise.
+ */
+pte_t *pt_mapping_find_size(as_t *as, __address page, size_t *size)
 {
 	pte_t *ptl0, *ptl1, *ptl2, *ptl3;
 
@@ -251,12 +491,23 @@ pte_t *pt_mapping_find(as_t *as, __address page)
 	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+	if (PTL2_IS_HUGE(ptl1, page)) {
+		*size = HUGE_PAGE_SIZE;
+		return &ptl1[PTL1_INDEX(page)];
+	}
+
 	ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
 
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+	if (PTL3_IS_LARGE(ptl2, page)) {
+		*size = LARGE_PAGE_SIZE;
+		return &ptl2[PTL2_INDEX(page)];
+	}
+
 	ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 
+	*size = PAGE_SIZE;
 	return &ptl3[PTL3_INDEX(page)];
 }
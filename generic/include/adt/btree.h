@@ -33,7 +33,16 @@
 #include <typedefs.h>
 #include <adt/list.h>
 
-#define BTREE_M		5
+/*
+ * Order of the B+tree, at least 5. A node takes 24 * BTREE_M + 40 bytes
+ * without the debugging fields, so orders of the form 8k + 1 fill whole
+ * 64-byte cache lines. The default node of order 17 takes seven lines.
+ */
+#ifdef CONFIG_BTREE_M
+#  define BTREE_M	CONFIG_BTREE_M
+#else
+#  define BTREE_M	17
+#endif
 #define BTREE_MAX_KEYS	(BTREE_M - 1)
 
 typedef __u64 btree_key_t;
@@ -67,9 +76,11 @@ struct btree_node {
 	/** Link connecting leaf-level nodes. Defined only when this node is a leaf. */
 	link_t leaf_link;
 
+#ifdef CONFIG_DEBUG
 	/** Variables needed by btree_print(). */	
 	link_t bfs_link;
 	int depth;
+#endif
 };
 
 /** B-tree structure. */
@@ -78,6 +89,20 @@ struct btree {
 	link_t leaf_head;	/**< Leaf-level list head. */
 };
 
+/** Position of a key-value pair in the leaf level of a B-tree.
+ *
+ * A position past the last key is represented by the last
+ * leaf node and index equal to its number of keys.
+ */
+typedef struct {
+	btree_node_t *leaf;	/**< Leaf node. */
+	index_t idx;		/**< Index of the key within the leaf node. */
+} btree_pos_t;
+
+#define BTREE_POS_VALID(pos)	((pos)->idx < (pos)->leaf->keys)
+#define BTREE_POS_KEY(pos)	((pos)->leaf->key[(pos)->idx])
+#define BTREE_POS_VALUE(pos)	((pos)->leaf->value[(pos)->idx])
+
 extern void btree_init(void);
 
 extern void btree_create(btree_t *t);
@@ -87,8 +112,18 @@ extern void btree_insert(btree_t *t, btree_key_t key, void *value, btree_node_t
 extern void btree_remove(btree_t *t, btree_key_t key, btree_node_t *leaf_node);
 extern void *btree_search(btree_t *t, btree_key_t key, btree_node_t **leaf_node);
 
+extern void btree_append(btree_t *t, btree_key_t key, void *value);
+extern count_t btree_remove_range(btree_t *t, btree_key_t lo, btree_key_t hi);
+
+extern bool btree_lower_bound(btree_t *t, btree_key_t key, btree_pos_t *pos);
+extern bool btree_upper_bound(btree_t *t, btree_key_t key, btree_pos_t *pos);
+extern bool btree_pos_next(btree_t *t, btree_pos_t *pos);
+extern bool btree_pos_prev(btree_t *t, btree_pos_t *pos);
+
 extern btree_node_t *btree_leaf_node_left_neighbour(btree_t *t, btree_node_t *node);
 extern btree_node_t *btree_leaf_node_right_neighbour(btree_t *t, btree_node_t *node);
 
+#ifdef CONFIG_DEBUG
 extern void btree_print(btree_t *t);
 #endif
+#endif
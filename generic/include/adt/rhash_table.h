@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RHASH_TABLE_H__
+#define __RHASH_TABLE_H__
+
+#include <adt/list.h>
+#include <arch/types.h>
+#include <typedefs.h>
+#include <synch/spinlock.h>
+#include <synch/rcu.h>
+
+/** Average chain length that triggers growing the table. */
+#define RHASH_LOAD_MAX		2
+
+/** Number of buckets moved to the new array by one operation. */
+#define RHASH_MIGRATE_STEP	4
+
+/** Hash table bucket. */
+typedef struct {
+	SPINLOCK_DECLARE(lock);
+	link_t head;
+	bool migrated;		/**< Items were moved to the next array. */
+} rhash_bucket_t;
+
+/** Array of buckets. */
+typedef struct rhash_array rhash_array_t;
+struct rhash_array {
+	rcu_head_t rcu;		/**< Deferred free of a replaced array. */
+	count_t size;		/**< Number of buckets, a power of two. */
+	bool frames;		/**< Buckets were too large for malloc() and use frames. */
+	rhash_array_t *next;	/**< Array replacing this one during resize. */
+	rhash_bucket_t *bucket;
+};
+
+/** Resizable hash table with per-bucket locks.
+ *
+ * While the table grows, items live both in the old and in the
+ * current array. Each operation moves a few buckets of the old
+ * array to the current one until the old array can be freed.
+ */
+struct rhash_table {
+	rhash_array_t * volatile cur;	/**< Array receiving new items. */
+	rhash_array_t * volatile old;	/**< Array being migrated or NULL. */
+	atomic_t items;			/**< Number of items in the table. */
+	SPINLOCK_DECLARE(resize_lock);	/**< Serializes resizes and migration. */
+	count_t migrated;		/**< Buckets of the old array migrated so far. */
+	count_t walkers;		/**< Number of running walks, which hold migration off. */
+	count_t max_keys;
+	rhash_table_operations_t *op;
+};
+
+/** Set of operations for resizable hash table. */
+struct rhash_table_operations {
+	/** Hash function.
+	 *
+	 * @param key Array of keys needed to compute hash. All keys must be passed.
+	 *
+	 * @return Hash of the keys. The table takes as many low bits as it needs.
+	 */
+	__native (* hash)(__native key[]);
+
+	/** Item hash function.
+	 *
+	 * @param item Item of the hash table.
+	 *
+	 * @return Same value as hash() returns for the keys of the item.
+	 */
+	__native (* hash_item)(link_t *item);
+	
+	/** Hash table item comparison function.
+	 *
+	 * @param key Array of keys that will be compared with item. It is not necessary to pass all keys.
+	 *
+	 * @return true if the keys match, false otherwise.
+	 */
+	bool (*compare)(__native key[], count_t keys, link_t *item);
+
+	/** Hash table item removal callback.
+	 *
+	 * Called with the bucket lock held. Items that may still be
+	 * in use by rhash_table_find() callers must be freed via call_rcu().
+	 *
+	 * @param item Item that was removed from the hash table.
+	 */
+	void (*remove_callback)(link_t *item);
+};
+
+/** Walk callback, called with the bucket lock held.
+ *
+ * @param item Item of the hash table.
+ * @param arg Argument passed to rhash_table_walk().
+ */
+typedef void (* rhash_walker_t)(link_t *item, void *arg);
+
+#define rhash_table_get_instance(item, type, member)	list_get_instance((item), type, member)
+
+extern void rhash_table_create(rhash_table_t *h, count_t m, count_t max_keys, rhash_table_operations_t *op);
+extern void rhash_table_destroy(rhash_table_t *h);
+extern void rhash_table_insert(rhash_table_t *h, __native key[], link_t *item);
+extern link_t *rhash_table_find(rhash_table_t *h, __native key[]);
+extern void rhash_table_remove(rhash_table_t *h, __native key[], count_t keys);
+extern void rhash_table_walk(rhash_table_t *h, rhash_walker_t walker, void *arg);
+extern void rhash_table_histogram(rhash_table_t *h, count_t hist[], count_t n);
+
+#endif
@@ -29,7 +29,37 @@
 #ifndef _KLOG_H_
 #define _KLOG_H_
 
+#include <arch/types.h>
+
+/*
+ * Order of frames shared with userspace for the log.
+ */
+#ifdef CONFIG_KLOG_ORDER
+#	define KLOG_ORDER	CONFIG_KLOG_ORDER
+#else
+#	define KLOG_ORDER	2
+#endif
+
+#define KLOG_ALIGN		8	/**< Alignment of records in the log. */
+#define KLOG_RECORD_MAX		256	/**< Maximum length of record text. */
+
+/** Header of a record in the log shared with userspace.
+ *
+ * The log is a circular buffer of 8-byte aligned records,
+ * each consisting of this header followed by the text.
+ * Both the header and the text may wrap around the end of
+ * the buffer. A record whose sequence number does not match
+ * the expected one has been overwritten.
+ */
+typedef struct {
+	__u64 seq;		/**< Sequence number of the record. */
+	__u64 stamp;		/**< Cycle counter at the time the record was logged. */
+	__u32 cpu;		/**< Processor that logged the record. */
+	__u32 len;		/**< Length of the text, not zero terminated. */
+} klog_hdr_t;
+
 void klog_init(void);
 void klog_printf(const char *fmt, ...);
+void klog_notify(void);
 
 #endif
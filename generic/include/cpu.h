@@ -39,6 +39,9 @@
 #include <config.h>
 #include <adt/list.h>
 #include <mm/tlb.h>
+#include <syscall/syscall.h>
+#include <printf/printbuf.h>
+#include <synch/rcu.h>
 
 #define CPU_STACK_SIZE	STACK_SIZE
 
@@ -80,6 +83,28 @@ struct cpu {
 	cpu_arch_t arch;
 
 	thread_t *fpu_owner;
+
+	/**
+	 * Thread switched away from directly, without passing through
+	 * the scheduler stack. It is put back to a run queue by the next
+	 * thread running on this CPU. See scheduler_finish_switch().
+	 */
+	thread_t *switch_prev;
+
+	count_t area_cache_hits;	/**< Hits of the per-thread address space area cache. */
+	count_t area_cache_misses;	/**< Misses of the per-thread address space area cache. */
+
+	printbuf_t printbuf;		/**< Buffer of printf() output, see printbuf.c. */
+
+	rcu_cpu_t rcu;			/**< RCU callbacks and quiescent state, see rcu.c. */
+
+#ifdef CONFIG_SYSCALL_STATS
+	/**
+	 * Statistics of syscalls finished on this CPU.
+	 * Accessed only with interrupts disabled.
+	 */
+	syscall_stat_t syscall_stats[SYSCALL_END];
+#endif /* CONFIG_SYSCALL_STATS */
 	
 	/**
 	 * Stack used by scheduler when there is no running thread.
@@ -37,6 +37,19 @@
 # error "CONFIG_FPU_LAZY defined, but no ARCH_HAS_FPU"
 #endif
 
+/** Size of the FPU context. Architectures may determine it at run time. */
+#ifndef FPU_CONTEXT_SIZE
+# define FPU_CONTEXT_SIZE	sizeof(fpu_context_t)
+#endif
+
+/**
+ * With lazy FPU context switching, a thread whose FPU trap was taken in
+ * FPU_EAGER_THRESHOLD consecutive time slices gets its FPU context loaded
+ * eagerly for the next FPU_EAGER_PERIOD time slices.
+ */
+#define FPU_EAGER_THRESHOLD	5
+#define FPU_EAGER_PERIOD	64
+
 extern void fpu_context_save(fpu_context_t *);
 extern void fpu_context_restore(fpu_context_t *);
 extern void fpu_init(void);
@@ -34,6 +34,8 @@
 #define AS_AREA_WRITE		2
 #define AS_AREA_EXEC		4
 #define AS_AREA_CACHEABLE	8
+#define AS_AREA_POPULATE	16	/**< Map all pages of the area when it is created. */
+#define AS_AREA_LARGE		32	/**< Use large pages where the backend supports them. */
 
 #ifdef KERNEL
 
@@ -46,6 +48,7 @@
 #include <synch/mutex.h>
 #include <adt/list.h>
 #include <adt/btree.h>
+#include <atomic.h>
 #include <elf.h>
 
 /** Defined to be true if user address space and kernel address space shadow each other. */
@@ -62,6 +65,13 @@
 
 #define FLAG_AS_KERNEL	    (1 << 0)	/**< Kernel address space. */
 
+/** Maximum number of pages mapped by the backends in one page fault. */
+#ifdef CONFIG_FAULT_AROUND
+#define AS_FAULT_AROUND		CONFIG_FAULT_AROUND
+#else
+#define AS_FAULT_AROUND		16
+#endif
+
 /** Address space structure.
  *
  * as_t contains the list of as_areas of userspace accessible
@@ -70,23 +80,44 @@
  * set up during system initialization.
  */
 struct as {
-	/** Protected by asidlock. */
-	link_t inactive_as_with_asid_link;
+	/** Link in as_with_asid_head list. Protected by as_with_asid_lock. */
+	link_t as_with_asid_link;
 
+	/** Serializes changes of the address space and its areas. */
 	mutex_t lock;
 
+	/**
+	 * Protects modifications of as_area_btree and the reference counts
+	 * of the areas. It allows as_page_fault() to find the faulting
+	 * area without taking the address space mutex.
+	 */
+	SPINLOCK_DECLARE(area_lock);
+
 	/** Number of references (i.e tasks that reference this as). */
 	count_t refcount;
 
 	/** Number of processors on wich is this address space active. */
-	count_t cpu_refcount;
+	atomic_t cpu_refcount;
+
+	/** Set by asid_get() while it considers stealing ASID of this address space. */
+	volatile bool asid_steal;
 
 	/** B+tree of address space areas. */
 	btree_t as_area_btree;
 
+	/**
+	 * Generation of the address space areas. It is incremented whenever an
+	 * area is created, resized or destroyed. Modified with both the address
+	 * space mutex and area_lock held.
+	 */
+	count_t area_gen;
+
 	/** Page table pointer. Constant on architectures that use global page hash table. */
 	pte_t *page_table;
 
+	/** Protects page tables private to this address space. */
+	mutex_t page_table_mutex;
+
 	/** Address space identifier. Constant on architectures that do not support ASIDs.*/
 	asid_t asid;
 };
@@ -144,6 +175,7 @@ struct as_area {
 	as_t *as;		/**< Containing address space. */
 	int flags;		/**< Flags related to the memory represented by the address space area. */
 	int attributes;		/**< Attributes related to the address space area itself. */
+	count_t refcount;	/**< Number of references. Protected by as->area_lock. */
 	count_t pages;		/**< Size of this area in multiples of PAGE_SIZE. */
 	__address base;		/**< Base address of this area. */
 	btree_t used_space;	/**< Map of used space. */
@@ -158,8 +190,8 @@ struct as_area {
 extern as_t *AS_KERNEL;
 extern as_operations_t *as_operations;
 
-extern spinlock_t inactive_as_with_asid_lock;
-extern link_t inactive_as_with_asid_head;
+extern spinlock_t as_with_asid_lock;
+extern link_t as_with_asid_head;
 
 extern void as_init(void);
 
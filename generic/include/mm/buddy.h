@@ -34,6 +34,11 @@
 
 #define BUDDY_SYSTEM_INNER_BLOCK	0xff
 
+#define BUDDY_SYSTEM_CLASSES		2	/**< Number of free block classes kept apart by the buddy system. */
+
+/** Return free list of given class and order. */
+#define BUDDY_LIST(b, class, i)		(&(b)->order[(class) * ((b)->max_order + 1) + (i)])
+
 /** Buddy system operations to be implemented by each implementation. */
 struct buddy_system_operations {
 	link_t *(* find_buddy)(buddy_system_t *, link_t *);		/**< Return pointer to left-side or right-side buddy for block passed as argument. */
@@ -46,22 +51,30 @@ struct buddy_system_operations {
 	/** Find parent of block that has given order  */
 	link_t *(* find_block)(buddy_system_t *, link_t *, __u8);
 	void (* print_id)(buddy_system_t *, link_t *);
+	/** Return class of block passed as argument. Optional, all blocks are of class 0 if NULL. */
+	__u8 (* get_class)(buddy_system_t *, link_t *);
+	/** Set class of all class_order-sized groups touched by block passed as argument. Optional. */
+	void (* set_class)(buddy_system_t *, link_t *, __u8);
 };
 
 struct buddy_system {
 	__u8 max_order;				/**< Maximal order of block which can be stored by buddy system. */
-	link_t *order;
+	__u8 class_order;			/**< Order of the smallest group of blocks which has its own class. */
+	link_t *order;				/**< Free lists, BUDDY_SYSTEM_CLASSES arrays of max_order + 1 lists. */
+	count_t fallbacks;			/**< Number of allocations satisfied from a foreign class. */
+	count_t claims;				/**< Number of groups converted to another class by fallbacks. */
 	buddy_system_operations_t *op;
 	void *data;				/**< Pointer to be used by the implementation. */
 };
 
 extern void buddy_system_create(buddy_system_t *b,
-				__u8 max_order, 
+				__u8 max_order, __u8 class_order,
 				buddy_system_operations_t *op, void *data);
-extern link_t *buddy_system_alloc(buddy_system_t *b, __u8 i);
+extern link_t *buddy_system_alloc(buddy_system_t *b, __u8 i, __u8 class);
 extern bool buddy_system_can_alloc(buddy_system_t *b, __u8 order);
 extern void buddy_system_free(buddy_system_t *b, link_t *block);
 extern void buddy_system_structure_print(buddy_system_t *b, size_t elem_size);
+extern count_t buddy_system_free_blocks(buddy_system_t *b, __u8 i, __u8 class);
 extern size_t buddy_conf_size(int max_order);
 extern link_t *buddy_system_alloc_block(buddy_system_t *b, link_t *block);
 
@@ -55,6 +55,16 @@
 #define FRAME_PANIC		0x2	/* panic on failure */
 #define FRAME_ATOMIC 	        0x4	/* do not panic and do not sleep on failure */
 #define FRAME_NO_RECLAIM        0x8     /* do not start reclaiming when no free memory */
+#define FRAME_MOVABLE		0x10	/* frame is not pinned by the kernel (e.g. anonymous user memory) */
+
+#define FRAME_MOBILITY_UNMOVABLE	0	/**< Buddy class of frames pinned by the kernel. */
+#define FRAME_MOBILITY_MOVABLE		1	/**< Buddy class of frames allocated with FRAME_MOVABLE. */
+
+/** Frames are grouped by mobility in naturally aligned blocks of 2^FRAME_MOBILITY_ORDER frames. */
+#define FRAME_MOBILITY_ORDER	9
+
+/** Number of orders reported by fragmentation statistics. */
+#define FRAME_FRAG_ORDERS	16
 
 #define FRAME_OK		0	/* frame_alloc return status */
 #define FRAME_NO_MEMORY		1	/* frame_alloc return status */
@@ -105,5 +115,8 @@ void zone_merge_all(void);
  */
 extern void zone_print_list(void);
 void zone_print_one(int znum);
+extern void zone_print_frag(void);
+extern void frame_sysinfo_init(void);
+extern int frame_frag_index(__u8 order);
 
 #endif
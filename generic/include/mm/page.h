@@ -44,6 +44,7 @@
 #define PAGE_WRITE_SHIFT		4
 #define PAGE_EXEC_SHIFT			5
 #define PAGE_GLOBAL_SHIFT		6
+#define PAGE_LARGE_SHIFT		7
 
 #define PAGE_NOT_CACHEABLE	(0<<PAGE_CACHEABLE_SHIFT)
 #define PAGE_CACHEABLE		(1<<PAGE_CACHEABLE_SHIFT)
@@ -60,6 +61,8 @@
 
 #define PAGE_GLOBAL		(1<<PAGE_GLOBAL_SHIFT)
 
+#define PAGE_LARGE		(1<<PAGE_LARGE_SHIFT)
+
 /** Page fault access type. */
 enum pf_access {
 	PF_ACCESS_READ,
@@ -71,8 +74,11 @@ typedef enum pf_access pf_access_t;
 /** Operations to manipulate page mappings. */
 struct page_mapping_operations {
 	void (* mapping_insert)(as_t *as, __address page, __address frame, int flags);
+	void (* mapping_insert_large)(as_t *as, __address page, __address frame, int flags, size_t size);
 	void (* mapping_remove)(as_t *as, __address page);
+	void (* mapping_remove_large)(as_t *as, __address page, size_t size);
 	pte_t *(* mapping_find)(as_t *as, __address page);
+	pte_t *(* mapping_find_size)(as_t *as, __address page, size_t *size);
 };
 typedef struct page_mapping_operations page_mapping_operations_t;
 
@@ -82,8 +88,11 @@ extern void page_init(void);
 extern void page_table_lock(as_t *as, bool lock);
 extern void page_table_unlock(as_t *as, bool unlock);
 extern void page_mapping_insert(as_t *as, __address page, __address frame, int flags);
+extern void page_mapping_insert_large(as_t *as, __address page, __address frame, int flags, size_t size);
 extern void page_mapping_remove(as_t *as, __address page);
+extern void page_mapping_remove_large(as_t *as, __address page, size_t size);
 extern pte_t *page_mapping_find(as_t *as, __address page);
+extern pte_t *page_mapping_find_size(as_t *as, __address page, size_t *size);
 extern pte_t *page_table_create(int flags);
 extern void page_table_destroy(pte_t *page_table);
 extern void map_structure(__address s, size_t size);
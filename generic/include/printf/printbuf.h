@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __PRINTBUF_H__
+#define __PRINTBUF_H__
+
+#include <arch/types.h>
+#include <typedefs.h>
+#include <arch/arg.h>
+
+#define PRINTBUF_ORDER		2	/**< Order of frames allocated for each per-CPU buffer. */
+#define PRINTBUF_PERIOD		10000	/**< Period in microseconds in which kprintd drains the buffers. */
+#define PRINTBUF_BATCH		64	/**< Maximum number of messages printed under one printflock acquisition. */
+
+/** Per-CPU buffer of formatted printf() output.
+ *
+ * The buffer has a single producer, the owning CPU with interrupts
+ * disabled, and a single consumer, whoever holds printflock.
+ */
+typedef struct {
+	__u8 *data;
+	volatile __native head;		/**< Producer position, written only by the owning CPU. */
+	volatile __native tail;		/**< Consumer position, written only under printflock. */
+	count_t dropped;		/**< Number of messages that did not fit. */
+} printbuf_t;
+
+extern volatile bool printbuf_panic;
+
+extern void printbuf_init(void);
+extern bool printbuf_vprintf(const char *fmt, va_list ap, int *ret);
+extern void printbuf_flush(void);
+extern void printbuf_drain(void);
+extern void printbuf_console_set(thread_t *t);
+extern void kprintd(void *arg);
+
+#endif
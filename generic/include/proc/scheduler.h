@@ -50,6 +50,7 @@ extern void scheduler_init(void);
 
 extern void scheduler_fpu_lazy_request(void);
 extern void scheduler(void);
+extern void scheduler_finish_switch(void);
 extern void kcpulb(void *arg);
 
 extern void sched_print_list(void);
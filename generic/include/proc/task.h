@@ -57,6 +57,7 @@ struct task {
 	bool accept_new_threads;
 
 	count_t refcount;	/**< Number of references (i.e. threads). */
+	count_t lifecount;	/**< Number of threads that have not called thread_exit() yet. */
 
 	cap_t capabilities;	/**< Task capabilities. */
 
@@ -86,6 +87,7 @@ extern void task_destroy(task_t *t);
 extern task_t *task_run_program(void *program_addr, char *name);
 extern task_t *task_find_by_id(task_id_t id);
 extern int task_kill(task_id_t id);
+extern void task_thread_exit(void);
 
 
 #ifndef task_create_arch
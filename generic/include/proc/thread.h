@@ -46,6 +46,8 @@
 
 #define THREAD_STACK_SIZE	STACK_SIZE
 
+#define THREAD_FUTEX_CACHE	4	/**< Number of entries in the per-thread futex cache, keep it a power of 2. */
+
 /**< Thread states. */
 enum state {
 	Invalid,	/**< It is an error, if thread is found in this state. */
@@ -59,15 +61,9 @@ enum state {
 
 extern char *thread_states[];
 
-/**< Join types. */
-typedef enum {
-	None,
-	TaskClnp,	/**< The thread will be joined by ktaskclnp thread. */
-	TaskGC		/**< The thread will be joined by ktaskgc thread. */
-} thread_join_type_t;
-
 #define X_WIRED		(1<<0)
 #define X_STOLEN	(1<<1)
+#define X_FPU_EAGER	(1<<2)	/**< Load the FPU context whenever the thread is scheduled. */
 
 #define THREAD_NAME_BUFLEN	20
 
@@ -104,6 +100,20 @@ struct thread {
 	bool in_copy_from_uspace;
 	/** True if this thread is executing copy_to_uspace(). False otherwise. */
 	bool in_copy_to_uspace;
+
+	/** Address space area in which the last page fault was resolved. */
+	as_area_t *area_cache;
+	/** Generation of the address space areas at the time area_cache was set. */
+	count_t area_cache_gen;
+
+	/**
+	 * Direct-mapped cache of futexes recently used by the thread.
+	 * The futexes are referenced by the task, which outlives the thread.
+	 */
+	struct {
+		__address paddr;
+		futex_t *futex;
+	} futex_cache[THREAD_FUTEX_CACHE];
 	
 	/**
 	 * If true, the thread will not go to sleep at all and will
@@ -111,7 +121,6 @@ struct thread {
 	 */
 	bool interrupted;			
 	
-	thread_join_type_t	join_type;	/**< Who joinins the thread. */
 	bool detached;				/**< If true, thread_join_timeout() cannot be used on this thread. */
 	waitq_t join_wq;			/**< Waitq for thread_join_timeout(). */
 
@@ -125,6 +134,17 @@ struct thread {
 	 */
 	int fpu_context_engaged;
 
+	/** Number of FPU traps taken by the thread for lazy FPU context switching. */
+	count_t fpu_traps;
+	/** True if the thread took FPU trap in the current time slice. */
+	bool fpu_trapped;
+	/**
+	 * Number of consecutive time slices in which the thread took FPU trap.
+	 * From FPU_EAGER_THRESHOLD on, it counts time slices with eagerly loaded
+	 * FPU context.
+	 */
+	int fpu_streak;
+
 	rwlock_type_t rwlock_holder_type;
 
 	void (* call_me)(void *);		/**< Funtion to be called in scheduler before the thread is put asleep. */
@@ -38,6 +38,7 @@ struct symtab_entry {
 	char symbol_name[MAX_SYMBOL_NAME];
 };
 
+extern void symtab_init(void);
 extern char * get_symtab_entry(__native addr);
 extern __address get_symbol_addr(const char *name);
 extern void symtab_print_search(const char *name);
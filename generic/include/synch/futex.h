@@ -32,21 +32,40 @@
 #include <arch/types.h>
 #include <typedefs.h>
 #include <synch/waitq.h>
+#include <synch/spinlock.h>
+#include <adt/list.h>
 #include <genarch/mm/page_ht.h>
 #include <genarch/mm/page_pt.h>
 
+/** Largest number of threads woken up or moved by one futex syscall. */
+#define FUTEX_COUNT_MAX		1024
+
 /** Kernel-side futex structure. */
 struct futex {
 	__address paddr;	/**< Physical address of the status variable. */
 	waitq_t wq;		/**< Wait queue for threads waiting for futex availability. */
 	link_t ht_link;		/**< Futex hash table link. */
-	count_t refcount;	/**< Number of tasks that reference this futex. */
+	count_t refcount;	/**< Number of tasks that reference this futex. Protected by the bucket lock. */
 };
 
+/** Bucket of the global futex hash table. */
+typedef struct {
+	SPINLOCK_DECLARE(lock);
+	link_t head;		/**< List of futexes hashed to this bucket. */
+} futex_bucket_t;
+
 extern void futex_init(void);
 extern __native sys_futex_sleep_timeout(__address uaddr, __u32 usec, int flags);
+extern __native sys_futex_sleep_compare(__address uaddr, __native expected, __u32 usec, int flags);
 extern __native sys_futex_wakeup(__address uaddr);
+extern __native sys_futex_wakeup_n(__address uaddr, count_t count);
+extern __native sys_futex_requeue(__address uaddr, __address uaddr2, count_t count, count_t move);
 
 extern void futex_cleanup(void);
 
+#ifdef CONFIG_TEST
+extern count_t futex_sleepers(__address uaddr);
+extern void futex_forget(__address uaddr);
+#endif /* CONFIG_TEST */
+
 #endif
@@ -34,8 +34,21 @@
 #include <synch/semaphore.h>
 #include <synch/synch.h>
 
+/** Maximum number of polls of a running owner before going to sleep. */
+#define MUTEX_SPIN_MAX		10000
+
 struct mutex {
 	semaphore_t sem;
+	thread_t * volatile owner;	/**< Thread holding the mutex or NULL if not known. */
+
+	/*
+	 * Contention statistics.
+	 * They are updated only by the holder of the mutex.
+	 */
+	count_t acquired;		/**< Number of successful acquisitions. */
+	count_t contended;		/**< Number of acquisitions that found the mutex held. */
+	count_t spun;			/**< Number of contended acquisitions that succeeded by spinning. */
+	count_t slept;			/**< Number of contended acquisitions that had to sleep. */
 };
 
 #define mutex_lock(mtx) \
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RCU_H__
+#define __RCU_H__
+
+#include <arch/types.h>
+#include <typedefs.h>
+#include <preemption.h>
+#include <arch/barrier.h>
+
+/** Period of the per-CPU callback thread krcud in microseconds. */
+#define RCU_PERIOD	10000
+
+typedef struct rcu_head rcu_head_t;
+typedef void (* rcu_func_t)(rcu_head_t *head);
+
+/** Deferred callback, embedded in the structure it reclaims. */
+struct rcu_head {
+	rcu_head_t *next;
+	rcu_func_t func;
+};
+
+/** Per-CPU RCU state.
+ *
+ * Except for qs_needed, it is accessed only by its CPU
+ * with interrupts disabled.
+ */
+typedef struct {
+	volatile bool qs_needed;	/**< Current grace period waits for this CPU. */
+	rcu_head_t *next;		/**< Callbacks not assigned to a grace period yet. */
+	rcu_head_t **next_tail;		/**< Last next pointer in the next list. */
+	rcu_head_t *cur;		/**< Callbacks waiting for grace period cur_gp. */
+	__u64 cur_gp;			/**< Grace period the cur list waits for. */
+} rcu_cpu_t;
+
+/*
+ * Readers must not sleep. A context switch, or the idle loop,
+ * is therefore a quiescent state of the CPU.
+ */
+#define rcu_read_lock()		preemption_disable()
+#define rcu_read_unlock()	preemption_enable()
+
+/** Publish pointer to an initialized structure. */
+#define rcu_assign_pointer(p, v) \
+	do { write_barrier(); (p) = (v); } while (0)
+
+extern void rcu_init(void);
+extern void rcu_qs(void);
+extern void call_rcu(rcu_head_t *head, rcu_func_t func);
+extern void rcu_synchronize(void);
+extern void krcud(void *arg);
+extern void rcu_print(void);
+
+#endif
@@ -34,6 +34,8 @@
 #include <synch/mutex.h>
 #include <synch/synch.h>
 #include <synch/spinlock.h>
+#include <synch/waitq.h>
+#include <atomic.h>
 
 enum rwlock_type {
 	RWLOCK_NONE,
@@ -41,10 +43,22 @@ enum rwlock_type {
 	RWLOCK_WRITER
 };
 
+/** Size of one per-CPU reader count, chosen to fill a cache line. */
+#define RWLOCK_CPU_SIZE		64
+
+/** Per-CPU count of readers in the critical section. */
+typedef struct {
+	atomic_t readers;
+	__u8 pad[RWLOCK_CPU_SIZE - sizeof(atomic_t)];
+} rwlock_cpu_t;
+
 struct rwlock {
 	SPINLOCK_DECLARE(lock);
 	mutex_t exclusive;	/**< Mutex for writers, readers can bypass it if readers_in is positive. */
-	count_t readers_in;	/**< Number of readers in critical section. */
+	count_t readers_in;	/**< Number of readers holding the exclusive mutex. */
+	volatile count_t writers;	/**< Number of writers holding or waiting for the lock. */
+	rwlock_cpu_t *cpus;	/**< Per-CPU counts of readers in critical section. */
+	waitq_t drain;		/**< Writer waits here for readers to leave. */
 };
 
 #define rwlock_write_lock(rwl) \
@@ -61,6 +75,7 @@ struct rwlock {
 	_rwlock_read_lock_timeout((rwl),(usec),SYNCH_FLAGS_NONE)
 
 extern void rwlock_initialize(rwlock_t *rwl);
+extern void rwlock_destroy(rwlock_t *rwl);
 extern void rwlock_read_unlock(rwlock_t *rwl);
 extern void rwlock_write_unlock(rwlock_t *rwl);
 extern int _rwlock_read_lock_timeout(rwlock_t *rwl, __u32 usec, int flags);
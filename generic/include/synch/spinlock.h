@@ -36,11 +36,40 @@
 #include <debug.h>
 
 #ifdef CONFIG_SMP
+
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCK_STAT)
+#  define SPINLOCK_NAMED
+#endif
+
+#ifdef CONFIG_LOCK_STAT
+/** Contention statistics shared by all spinlocks of the same name. */
+typedef struct {
+	char *name;		/**< Name of the spinlocks. */
+	atomic_t acquired;	/**< Number of acquisitions. */
+	atomic_t contended;	/**< Number of acquisitions that had to wait. */
+	atomic_t wait_total;	/**< Total number of cycles spent waiting. */
+	atomic_t wait_max;	/**< Longest wait in cycles. */
+} lock_stat_t;
+
+#define LOCK_STAT_ENTRIES	256
+#endif
+
+/*
+ * With CONFIG_TICKET_SPINLOCK, val is the next ticket to be handed out
+ * and serving is the ticket of the current holder. The lock is free if
+ * both are equal. Otherwise val is just a test-and-set flag.
+ */
 struct spinlock {
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef SPINLOCK_NAMED
 	char *name;
+#endif
+#ifdef CONFIG_LOCK_STAT
+	lock_stat_t *stat;
 #endif
 	atomic_t val;
+#ifdef CONFIG_TICKET_SPINLOCK
+	volatile long serving;
+#endif
 };
 
 /*
@@ -49,29 +78,66 @@ struct spinlock {
  */
 #define SPINLOCK_DECLARE(slname) 	spinlock_t slname
 
+#ifdef SPINLOCK_NAMED
+#  define SPINLOCK_NAME_INITIALIZER(slname)	.name = #slname,
+#else
+#  define SPINLOCK_NAME_INITIALIZER(slname)
+#endif
+
+#ifdef CONFIG_TICKET_SPINLOCK
+#  define SPINLOCK_TICKET_INITIALIZER		.serving = 0,
+#else
+#  define SPINLOCK_TICKET_INITIALIZER
+#endif
+
 /*
  * SPINLOCK_INITIALIZE is to be used for statically allocated spinlocks.
  * It declares and initializes the lock.
  */
-#ifdef CONFIG_DEBUG_SPINLOCK
-#define SPINLOCK_INITIALIZE(slname) 	\
-	spinlock_t slname = { 		\
-		.name = #slname,	\
-		.val = { 0 }		\
-	}
-#else
-#define SPINLOCK_INITIALIZE(slname) 	\
-	spinlock_t slname = { 		\
-		.val = { 0 }		\
+#define SPINLOCK_INITIALIZE(slname) 		\
+	spinlock_t slname = { 			\
+		SPINLOCK_NAME_INITIALIZER(slname)	\
+		SPINLOCK_TICKET_INITIALIZER	\
+		.val = { 0 }			\
 	}
-#endif
 
 extern void spinlock_initialize(spinlock_t *sl, char *name);
 extern int spinlock_trylock(spinlock_t *sl);
 extern void spinlock_lock_debug(spinlock_t *sl);
 
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef CONFIG_LOCK_STAT
+extern void lock_stat_print(void);
+#endif
+
+#ifdef CONFIG_TICKET_SPINLOCK
+/** Lock ticket spinlock
+ *
+ * Take the next ticket and wait until it is served.
+ * Waiters are served in FIFO order and poll only
+ * the serving field, which changes once per release.
+ *
+ * @param sl Pointer to spinlock_t structure.
+ */
+static inline void spinlock_lock_ticket(spinlock_t *sl)
+{
+	long ticket;
+
+	preemption_disable();
+	ticket = atomic_postinc(&sl->val);
+	while (sl->serving != ticket)
+		;
+
+	/*
+	 * Prevent critical section code from bleeding out this way up.
+	 */
+	CS_ENTER_BARRIER();
+}
+#endif
+
+#ifdef SPINLOCK_NAMED
 #  define spinlock_lock(x) spinlock_lock_debug(x)
+#elif defined(CONFIG_TICKET_SPINLOCK)
+#  define spinlock_lock(x) spinlock_lock_ticket(x)
 #else
 #  define spinlock_lock(x) atomic_lock_arch(&(x)->val)
 #endif
@@ -84,14 +150,23 @@ extern void spinlock_lock_debug(spinlock_t *sl);
  */
 static inline void spinlock_unlock(spinlock_t *sl)
 {
+#ifdef CONFIG_TICKET_SPINLOCK
+	ASSERT(atomic_get(&sl->val) != sl->serving);
+#else
 	ASSERT(atomic_get(&sl->val) != 0);
+#endif
 
 	/*
 	 * Prevent critical section code from bleeding out this way down.
 	 */
 	CS_LEAVE_BARRIER();
 	
+#ifdef CONFIG_TICKET_SPINLOCK
+	/* Only the holder writes serving. */
+	sl->serving++;
+#else
 	atomic_set(&sl->val,0);
+#endif
 	preemption_enable();
 }
 
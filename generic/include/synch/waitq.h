@@ -61,6 +61,8 @@ extern int waitq_sleep_timeout_unsafe(waitq_t *wq, __u32 usec, int flags);
 extern void waitq_sleep_finish(waitq_t *wq, int rc, ipl_t ipl);
 extern void waitq_wakeup(waitq_t *wq, bool all);
 extern void _waitq_wakeup_unsafe(waitq_t *wq, bool all);
+extern count_t waitq_wakeup_n(waitq_t *wq, count_t n);
+extern count_t waitq_requeue(waitq_t *src, waitq_t *dst, count_t n);
 extern void waitq_interrupt_sleep(thread_t *t);
 
 #endif
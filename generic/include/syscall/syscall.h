@@ -59,6 +59,9 @@ typedef enum {
 	SYS_SYSINFO_VALID,
 	SYS_SYSINFO_VALUE,
 	SYS_DEBUG_ENABLE_CONSOLE,
+	SYS_FUTEX_SLEEP_COMPARE,
+	SYS_FUTEX_WAKEUP_N,
+	SYS_FUTEX_REQUEUE,
 	SYSCALL_END
 } syscall_t;
 
@@ -69,11 +72,26 @@ typedef enum {
 
 typedef __native (*syshandler_t)();
 
+#ifdef CONFIG_SYSCALL_STATS
+/** Per-CPU statistics of one syscall. */
+typedef struct {
+	count_t count;		/**< Number of calls. */
+	__u64 cycles;		/**< Total number of cycles spent in the syscall. */
+	__u64 min;		/**< Shortest call in cycles. */
+	__u64 max;		/**< Longest call in cycles. */
+} syscall_stat_t;
+#endif /* CONFIG_SYSCALL_STATS */
+
 extern syshandler_t syscall_table[SYSCALL_END];
 extern __native syscall_handler(__native a1, __native a2, __native a3,
 				__native a4, __native id);
 extern __native sys_tls_set(__native addr);
 
+#ifdef CONFIG_SYSCALL_STATS
+extern void syscall_stats_init(void);
+extern void syscall_stats_print(void);
+#endif /* CONFIG_SYSCALL_STATS */
+
 
 #endif
 
@@ -29,6 +29,31 @@
 #ifndef __TEST_H__
 #define __TEST_H__
 
+#include <arch/types.h>
+#include <typedefs.h>
+#include <atomic.h>
+
 extern void test(void);
+extern thread_t *test_thread_create(void (* func)(void *), void *arg, task_t *task, cpu_t *cpu, char *name);
+extern void test_barrier(atomic_t *barrier, count_t threads);
+extern __u64 test_ns(__u64 cycles);
+extern count_t futex2_lock(atomic_t *futex, bool contended);
+extern void futex2_unlock(atomic_t *futex);
+
+extern bool test_btree1(void);
+extern bool test_futex1(void);
+extern bool test_rcu1(void);
+extern bool test_rhash1(void);
+
+extern void bench_btree2(void);
+extern void bench_condvar1(void);
+extern void bench_fault1(void);
+extern void bench_futex2(void);
+extern void bench_pingpong1(void);
+extern void bench_rhash2(void);
+extern void bench_rwlock1(void);
+extern void bench_spawn1(void);
+extern void bench_symtab1(void);
+extern void bench_yield1(void);
 
 #endif
@@ -33,7 +33,8 @@
  * This file implements B+tree type and operations.
  *
  * The B+tree has the following properties:
- * @li it is a ballanced 3-4-5 tree (i.e. BTREE_M = 5)
+ * @li it is a ballanced tree of order BTREE_M
+ * @li keys within a node are searched by bisection
  * @li values (i.e. pointers to values) are stored only in leaves
  * @li leaves are linked in a list
  *
@@ -53,6 +54,7 @@
 static void btree_destroy_subtree(btree_node_t *root);
 static void _btree_insert(btree_t *t, btree_key_t key, void *value, btree_node_t *rsubtree, btree_node_t *node);
 static void _btree_remove(btree_t *t, btree_key_t key, btree_node_t *node);
+static btree_node_t *find_leaf_node(btree_t *t, btree_key_t key);
 static void node_initialize(btree_node_t *node);
 static void node_insert_key_and_lsubtree(btree_node_t *node, btree_key_t key, void *value, btree_node_t *lsubtree);
 static void node_insert_key_and_rsubtree(btree_node_t *node, btree_key_t key, void *value, btree_node_t *rsubtree);
@@ -61,6 +63,8 @@ static void node_remove_key_and_rsubtree(btree_node_t *node, btree_key_t key);
 static btree_node_t *node_split(btree_node_t *node, btree_key_t key, void *value, btree_node_t *rsubtree, btree_key_t *median);
 static btree_node_t *node_combine(btree_node_t *node);
 static index_t find_key_by_subtree(btree_node_t *node, btree_node_t *subtree, bool right);
+static index_t node_lower_bound(btree_node_t *node, btree_key_t key);
+static index_t node_upper_bound(btree_node_t *node, btree_key_t key);
 static void rotate_from_right(btree_node_t *lnode, btree_node_t *rnode, index_t idx);
 static void rotate_from_left(btree_node_t *lnode, btree_node_t *rnode, index_t idx);
 static bool try_insert_by_rotation_to_left(btree_node_t *node, btree_key_t key, void *value, btree_node_t *rsubtree);
@@ -201,7 +205,9 @@ void _btree_insert(btree_t *t, btree_key_t key, void *value, btree_node_t *rsubt
 			 */			
 			t->root->subtree[0] = node;
 
+#ifdef CONFIG_DEBUG
 			t->root->depth = node->depth + 1;
+#endif
 		}
 		_btree_insert(t, median, NULL, rnode, node->parent);
 	}	
@@ -313,60 +319,208 @@ void _btree_remove(btree_t *t, btree_key_t key, btree_node_t *node)
  */
 void *btree_search(btree_t *t, btree_key_t key, btree_node_t **leaf_node)
 {
-	btree_node_t *cur, *next;
+	btree_node_t *leaf;
+	index_t i;
 	
+	leaf = find_leaf_node(t, key);
+	*leaf_node = leaf;
+
 	/*
-	 * Iteratively descend to the leaf that can contain the searched key.
+	 * In a leaf, the only candidate is leaf->key[i - 1].
+	 * If i is zero, the key is smaller than any of its keys.
 	 */
-	for (cur = t->root; cur; cur = next) {
+	i = node_upper_bound(leaf, key);
+	if (i && key == leaf->key[i - 1])
+		return leaf->value[i - 1];
+	return NULL;
+}
 
-		/* Last iteration will set this with proper leaf node address. */
-		*leaf_node = cur;
-		
-		/*
-		 * The key can be in the leftmost subtree.
-		 * Test it separately.
-		 */
-		if (key < cur->key[0]) {
-			next = cur->subtree[0];
-			continue;
-		} else {
-			void *val;
-			int i;
-		
-			/*
-			 * Now if the key is smaller than cur->key[i]
-			 * it can only mean that the value is in cur->subtree[i]
-			 * or it is not in the tree at all.
-			 */
-			for (i = 1; i < cur->keys; i++) {
-				if (key < cur->key[i]) {
-					next = cur->subtree[i];
-					val = cur->value[i - 1];
+/** Descend to the leaf node that can contain a key.
+ *
+ * All keys in the leaf nodes to the left of the returned
+ * leaf node are smaller than the key and all keys in the
+ * leaf nodes to the right of it are greater than the key.
+ *
+ * @param t B-tree.
+ * @param key Key to be searched.
+ *
+ * @return Leaf node that can contain the key.
+ */
+btree_node_t *find_leaf_node(btree_t *t, btree_key_t key)
+{
+	btree_node_t *cur;
 
-					if (LEAF_NODE(cur))
-						return key == cur->key[i - 1] ? val : NULL;
+	/*
+	 * Now if the key is smaller than cur->key[i] and not
+	 * smaller than cur->key[i - 1], it can only mean that
+	 * the value is in cur->subtree[i] or it is not in the
+	 * tree at all.
+	 */
+	for (cur = t->root; INDEX_NODE(cur); cur = cur->subtree[node_upper_bound(cur, key)])
+		;
 
-					goto descend;
-				} 
-			}
-			
+	return cur;
+}
+
+/** Append key-value pair to B-tree.
+ *
+ * This is the way to load a B-tree from sorted input. If the key
+ * is greater than any key in the B-tree, the insertion begins
+ * in the rightmost leaf node without searching the B-tree and
+ * the left siblings are filled up by rotations before any split.
+ * Otherwise, this function falls back to btree_insert().
+ *
+ * @param t B-tree.
+ * @param key Key to be appended.
+ * @param value Value to be appended.
+ */
+void btree_append(btree_t *t, btree_key_t key, void *value)
+{
+	btree_node_t *lnode;
+
+	ASSERT(value);
+
+	lnode = list_get_instance(t->leaf_head.prev, btree_node_t, leaf_link);
+	if (lnode->keys && key <= lnode->key[lnode->keys - 1]) {
+		btree_insert(t, key, value, NULL);
+		return;
+	}
+
+	_btree_insert(t, key, value, NULL, lnode);
+}
+
+/** Remove all keys from an interval from B-tree.
+ *
+ * The values of the removed keys are not touched. Callers that
+ * need to release them should walk the interval first.
+ *
+ * The B-tree is searched only once as long as the removals
+ * do not require the leaf node to borrow from or be combined
+ * with its siblings.
+ *
+ * @param t B-tree.
+ * @param lo Smallest key to be removed.
+ * @param hi Key bounding the interval from above. It is not removed.
+ *
+ * @return Number of removed keys.
+ */
+count_t btree_remove_range(btree_t *t, btree_key_t lo, btree_key_t hi)
+{
+	btree_pos_t pos;
+	count_t removed = 0;
+	bool valid;
+
+	valid = btree_lower_bound(t, lo, &pos);
+	while (valid && BTREE_POS_KEY(&pos) < hi) {
+		if (ROOT_NODE(pos.leaf) || pos.leaf->keys > FILL_FACTOR) {
+			/*
+			 * The key can be removed without touching
+			 * the siblings and the next key slides into
+			 * its place.
+			 */
+			_btree_remove(t, BTREE_POS_KEY(&pos), pos.leaf);
+			valid = BTREE_POS_VALID(&pos) || btree_pos_next(t, &pos);
+		} else {
 			/*
-			 * Last possibility is that the key is in the rightmost subtree.
+			 * The leaf node is going to be rebalanced.
+			 * Search for the next key again afterwards.
 			 */
-			next = cur->subtree[i];
-			val = cur->value[i - 1];
-			if (LEAF_NODE(cur))
-				return key == cur->key[i - 1] ? val : NULL;
+			_btree_remove(t, BTREE_POS_KEY(&pos), pos.leaf);
+			valid = btree_lower_bound(t, lo, &pos);
 		}
-		descend:
-			;
+		removed++;
 	}
 
-	/*
-	 * The key was not found in the *leaf_node and is smaller than any of its keys.
-	 */
-	return NULL;
+	return removed;
+}
+
+/** Find the first key not smaller than a key.
+ *
+ * @param t B-tree.
+ * @param key Key to be searched.
+ * @param pos Address where to put the position of the found key.
+ *
+ * @return True if there is such key, false if pos is past the last key.
+ */
+bool btree_lower_bound(btree_t *t, btree_key_t key, btree_pos_t *pos)
+{
+	pos->leaf = find_leaf_node(t, key);
+	pos->idx = node_lower_bound(pos->leaf, key);
+
+	return BTREE_POS_VALID(pos) || btree_pos_next(t, pos);
+}
+
+/** Find the first key greater than a key.
+ *
+ * @param t B-tree.
+ * @param key Key to be searched.
+ * @param pos Address where to put the position of the found key.
+ *
+ * @return True if there is such key, false if pos is past the last key.
+ */
+bool btree_upper_bound(btree_t *t, btree_key_t key, btree_pos_t *pos)
+{
+	pos->leaf = find_leaf_node(t, key);
+	pos->idx = node_upper_bound(pos->leaf, key);
+
+	return BTREE_POS_VALID(pos) || btree_pos_next(t, pos);
+}
+
+/** Move B-tree position to the next key.
+ *
+ * The leaf nodes are followed in the order of the leaf-level list.
+ * If there is no next key, the position is set past the last key.
+ *
+ * @param t B-tree.
+ * @param pos Position to be moved.
+ *
+ * @return True if there is the next key, false otherwise.
+ */
+bool btree_pos_next(btree_t *t, btree_pos_t *pos)
+{
+	btree_node_t *node;
+
+	if (pos->idx + 1 < pos->leaf->keys) {
+		pos->idx++;
+		return true;
+	}
+
+	/* Empty leaf nodes are found only in an empty B-tree. */
+	if ((node = btree_leaf_node_right_neighbour(t, pos->leaf))) {
+		pos->leaf = node;
+		pos->idx = 0;
+		return true;
+	}
+
+	pos->idx = pos->leaf->keys;
+	return false;
+}
+
+/** Move B-tree position to the previous key.
+ *
+ * A position past the last key is moved to the last key.
+ *
+ * @param t B-tree.
+ * @param pos Position to be moved. It is not changed if there is no previous key.
+ *
+ * @return True if there is the previous key, false otherwise.
+ */
+bool btree_pos_prev(btree_t *t, btree_pos_t *pos)
+{
+	btree_node_t *node;
+
+	if (pos->idx > 0) {
+		pos->idx--;
+		return true;
+	}
+
+	if ((node = btree_leaf_node_left_neighbour(t, pos->leaf))) {
+		pos->leaf = node;
+		pos->idx = node->keys - 1;
+		return true;
+	}
+
+	return false;
 }
 
 /** Return pointer to B-tree leaf node's left neighbour.
@@ -423,8 +577,57 @@ void node_initialize(btree_node_t *node)
 	
 	link_initialize(&node->leaf_link);
 
+#ifdef CONFIG_DEBUG
 	link_initialize(&node->bfs_link);
 	node->depth = 0;
+#endif
+}
+
+/** Find the first key in B-tree node not smaller than a key.
+ *
+ * @param node B-tree node.
+ * @param key Key to compare the keys of the node with.
+ *
+ * @return Index of the first key not smaller than key or node->keys if there is none.
+ */
+index_t node_lower_bound(btree_node_t *node, btree_key_t key)
+{
+	index_t lo = 0, hi = node->keys, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (node->key[mid] < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/** Find the first key in B-tree node greater than a key.
+ *
+ * The keys of a node are sorted, so they are bisected.
+ * The number of keys may exceed BTREE_MAX_KEYS by one.
+ *
+ * @param node B-tree node.
+ * @param key Key to compare the keys of the node with.
+ *
+ * @return Index of the first key greater than key or node->keys if there is none.
+ */
+index_t node_upper_bound(btree_node_t *node, btree_key_t key)
+{
+	index_t lo = 0, hi = node->keys, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (key < node->key[mid])
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
 }
 
 /** Insert key-value-lsubtree triplet into B-tree node.
@@ -439,20 +642,16 @@ void node_initialize(btree_node_t *node)
  */ 
 void node_insert_key_and_lsubtree(btree_node_t *node, btree_key_t key, void *value, btree_node_t *lsubtree)
 {
-	int i;
+	int i, j;
 
-	for (i = 0; i < node->keys; i++) {
-		if (key < node->key[i]) {
-			int j;
-		
-			for (j = node->keys; j > i; j--) {
-				node->key[j] = node->key[j - 1];
-				node->value[j] = node->value[j - 1];
-				node->subtree[j + 1] = node->subtree[j];
-			}
+	i = node_upper_bound(node, key);
+	if (i < node->keys) {
+		for (j = node->keys; j > i; j--) {
+			node->key[j] = node->key[j - 1];
+			node->value[j] = node->value[j - 1];
 			node->subtree[j + 1] = node->subtree[j];
-			break;	
 		}
+		node->subtree[j + 1] = node->subtree[j];
 	}
 	node->key[i] = key;
 	node->value[i] = value;
@@ -475,19 +674,13 @@ void node_insert_key_and_lsubtree(btree_node_t *node, btree_key_t key, void *val
  */ 
 void node_insert_key_and_rsubtree(btree_node_t *node, btree_key_t key, void *value, btree_node_t *rsubtree)
 {
-	int i;
+	int i, j;
 
-	for (i = 0; i < node->keys; i++) {
-		if (key < node->key[i]) {
-			int j;
-		
-			for (j = node->keys; j > i; j--) {
-				node->key[j] = node->key[j - 1];
-				node->value[j] = node->value[j - 1];
-				node->subtree[j + 1] = node->subtree[j];
-			}
-			break;	
-		}
+	i = node_upper_bound(node, key);
+	for (j = node->keys; j > i; j--) {
+		node->key[j] = node->key[j - 1];
+		node->value[j] = node->value[j - 1];
+		node->subtree[j + 1] = node->subtree[j];
 	}
 	node->key[i] = key;
 	node->value[i] = value;
@@ -509,17 +702,16 @@ void node_remove_key_and_lsubtree(btree_node_t *node, btree_key_t key)
 {
 	int i, j;
 	
-	for (i = 0; i < node->keys; i++) {
-		if (key == node->key[i]) {
-			for (j = i + 1; j < node->keys; j++) {
-				node->key[j - 1] = node->key[j];
-				node->value[j - 1] = node->value[j];
-				node->subtree[j - 1] = node->subtree[j];
-			}
+	i = (int) node_upper_bound(node, key) - 1;
+	if (i >= 0 && key == node->key[i]) {
+		for (j = i + 1; j < node->keys; j++) {
+			node->key[j - 1] = node->key[j];
+			node->value[j - 1] = node->value[j];
 			node->subtree[j - 1] = node->subtree[j];
-			node->keys--;
-			return;
 		}
+		node->subtree[j - 1] = node->subtree[j];
+		node->keys--;
+		return;
 	}
 	panic("node %p does not contain key %d\n", node, key);
 }
@@ -537,16 +729,15 @@ void node_remove_key_and_rsubtree(btree_node_t *node, btree_key_t key)
 {
 	int i, j;
 	
-	for (i = 0; i < node->keys; i++) {
-		if (key == node->key[i]) {
-			for (j = i + 1; j < node->keys; j++) {
-				node->key[j - 1] = node->key[j];
-				node->value[j - 1] = node->value[j];
-				node->subtree[j] = node->subtree[j + 1];
-			}
-			node->keys--;
-			return;
+	i = (int) node_upper_bound(node, key) - 1;
+	if (i >= 0 && key == node->key[i]) {
+		for (j = i + 1; j < node->keys; j++) {
+			node->key[j - 1] = node->key[j];
+			node->value[j - 1] = node->value[j];
+			node->subtree[j] = node->subtree[j + 1];
 		}
+		node->keys--;
+		return;
 	}
 	panic("node %p does not contain key %d\n", node, key);
 }
@@ -594,7 +785,9 @@ btree_node_t *node_split(btree_node_t *node, btree_key_t key, void *value, btree
 	rnode = (btree_node_t *) slab_alloc(btree_node_slab, 0);
 	node_initialize(rnode);
 	rnode->parent = node->parent;
+#ifdef CONFIG_DEBUG
 	rnode->depth = node->depth;
+#endif
 	
 	/*
 	 * Copy big keys, values and subtree pointers to the new right sibling.
@@ -931,6 +1124,7 @@ bool try_rotation_from_right(btree_node_t *lnode)
 	return false;
 }
 
+#ifdef CONFIG_DEBUG
 /** Print B-tree.
  *
  * @param t Print out B-tree.
@@ -993,3 +1187,4 @@ void btree_print(btree_t *t)
 	}
 	printf("\n");
 }
+#endif
@@ -0,0 +1,570 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	rhash_table.c
+ * @brief	Resizable hash table with per-bucket locks.
+ *
+ * Unlike hash_table_t, this table needs no external lock. Each bucket
+ * has its own spinlock and operations on different buckets do not
+ * contend.
+ *
+ * When the average chain grows longer than RHASH_LOAD_MAX, a twice
+ * as large array is allocated and becomes the current one. The old
+ * array stays in use and each subsequent insert or remove moves
+ * RHASH_MIGRATE_STEP of its buckets to the new array. A migrated
+ * bucket is marked as such and operations that find it marked
+ * continue in the next array. When all buckets are migrated, the
+ * old array is freed after an RCU grace period, as other CPUs may
+ * still be looking at it.
+ */
+
+#include <adt/rhash_table.h>
+#include <adt/list.h>
+#include <typedefs.h>
+#include <arch/types.h>
+#include <arch/asm.h>
+#include <arch/barrier.h>
+#include <debug.h>
+#include <panic.h>
+#include <mm/slab.h>
+#include <mm/frame.h>
+#include <mm/page.h>
+#include <synch/spinlock.h>
+#include <synch/rcu.h>
+
+/** Arguments of rhash_remove_bucket(). */
+typedef struct {
+	__native *key;
+	count_t keys;
+} rhash_remove_arg_t;
+
+/** Arguments of rhash_histogram_bucket(). */
+typedef struct {
+	count_t *hist;
+	count_t n;
+} rhash_histogram_arg_t;
+
+/** Arguments of rhash_walk_bucket(). */
+typedef struct {
+	rhash_walker_t walker;
+	void *arg;
+} rhash_walk_arg_t;
+
+typedef void (* rhash_bucket_fn_t)(rhash_table_t *h, rhash_bucket_t *b, void *arg);
+
+static rhash_array_t *rhash_array_create(count_t size, int flags);
+static void rhash_array_free(rcu_head_t *head);
+static rhash_bucket_t *rhash_lock(rhash_table_t *h, __native hash);
+static void rhash_maintain(rhash_table_t *h);
+static void rhash_grow(rhash_table_t *h);
+static void rhash_migrate(rhash_table_t *h);
+static void rhash_buckets(rhash_table_t *h, rhash_bucket_fn_t fn, void *arg);
+static void rhash_remove_bucket(rhash_table_t *h, rhash_bucket_t *b, void *arg);
+static void rhash_walk_bucket(rhash_table_t *h, rhash_bucket_t *b, void *arg);
+static void rhash_histogram_bucket(rhash_table_t *h, rhash_bucket_t *b, void *arg);
+
+/** Create resizable hash table.
+ *
+ * @param h Hash table structure. Will be initialized by this call.
+ * @param m Initial number of buckets, rounded up to a power of two.
+ * @param max_keys Maximal number of keys needed to identify an item.
+ * @param op Hash table operations structure.
+ */
+void rhash_table_create(rhash_table_t *h, count_t m, count_t max_keys, rhash_table_operations_t *op)
+{
+	count_t size;
+
+	ASSERT(h);
+	ASSERT(op && op->hash && op->hash_item && op->compare);
+	ASSERT(max_keys > 0);
+
+	for (size = 1; size < m; size <<= 1)
+		;
+
+	h->cur = rhash_array_create(size, 0);
+	if (!h->cur)
+		panic("cannot allocate memory for hash table\n");
+	h->old = NULL;
+	atomic_set(&h->items, 0);
+	spinlock_initialize(&h->resize_lock, "rhash_table.resize_lock");
+	h->migrated = 0;
+	h->walkers = 0;
+	h->max_keys = max_keys;
+	h->op = op;
+}
+
+/** Destroy empty hash table.
+ *
+ * The table must not be used by anybody else anymore.
+ *
+ * @param h Hash table.
+ */
+void rhash_table_destroy(rhash_table_t *h)
+{
+	ASSERT(!atomic_get(&h->items));
+
+	if (h->old)
+		rhash_array_free(&h->old->rcu);
+	rhash_array_free(&h->cur->rcu);
+}
+
+/** Insert item into hash table.
+ *
+ * @param h Hash table.
+ * @param key Array of all keys necessary to compute hash.
+ * @param item Item to be inserted into the hash table.
+ */
+void rhash_table_insert(rhash_table_t *h, __native key[], link_t *item)
+{
+	rhash_bucket_t *b;
+	ipl_t ipl;
+
+	ASSERT(item);
+
+	ipl = interrupts_disable();
+	rcu_read_lock();
+	
+	b = rhash_lock(h, h->op->hash(key));
+	list_append(item, &b->head);
+	spinlock_unlock(&b->lock);
+	atomic_inc(&h->items);
+
+	rhash_maintain(h);
+	
+	rcu_read_unlock();
+	interrupts_restore(ipl);
+}
+
+/** Search hash table for an item matching keys.
+ *
+ * Nothing prevents the returned item from being removed
+ * right after the bucket lock is dropped. The caller must
+ * either serialize removals by other means, or be in an
+ * RCU read section and have removed items freed by call_rcu().
+ *
+ * @param h Hash table.
+ * @param key Array of all keys needed to compute hash.
+ *
+ * @return Matching item on success, NULL if there is no such item.
+ */
+link_t *rhash_table_find(rhash_table_t *h, __native key[])
+{
+	rhash_bucket_t *b;
+	link_t *cur, *found = NULL;
+	ipl_t ipl;
+
+	ipl = interrupts_disable();
+	rcu_read_lock();
+
+	b = rhash_lock(h, h->op->hash(key));
+	for (cur = b->head.next; cur != &b->head; cur = cur->next) {
+		if (h->op->compare(key, h->max_keys, cur)) {
+			found = cur;
+			break;
+		}
+	}
+	spinlock_unlock(&b->lock);
+
+	rcu_read_unlock();
+	interrupts_restore(ipl);
+
+	return found;
+}
+
+/** Remove all matching items from hash table.
+ *
+ * For each removed item, h->remove_callback() is called.
+ * If fewer than max_keys keys are passed, all buckets
+ * are searched, each with only its own lock held.
+ *
+ * @param h Hash table.
+ * @param key Array of keys that will be compared against items of the hash table.
+ * @param keys Number of keys in the key array.
+ */
+void rhash_table_remove(rhash_table_t *h, __native key[], count_t keys)
+{
+	rhash_remove_arg_t arg;
+	rhash_bucket_t *b;
+	ipl_t ipl;
+
+	ASSERT(h->op->remove_callback);
+	ASSERT(keys <= h->max_keys);
+
+	arg.key = key;
+	arg.keys = keys;
+
+	if (keys < h->max_keys) {
+		rhash_buckets(h, rhash_remove_bucket, &arg);
+		return;
+	}
+
+	ipl = interrupts_disable();
+	rcu_read_lock();
+
+	b = rhash_lock(h, h->op->hash(key));
+	rhash_remove_bucket(h, b, &arg);
+	spinlock_unlock(&b->lock);
+	rhash_maintain(h);
+
+	rcu_read_unlock();
+	interrupts_restore(ipl);
+}
+
+/** Call function for every item of hash table.
+ *
+ * Only one bucket is locked at a time, so inserts and removes
+ * proceed during the walk. Items are not moved between arrays
+ * while a walk is running, so none is visited twice.
+ *
+ * @param h Hash table.
+ * @param walker Function called for each item with the bucket locked.
+ * @param arg Argument passed to walker.
+ */
+void rhash_table_walk(rhash_table_t *h, rhash_walker_t walker, void *arg)
+{
+	rhash_walk_arg_t warg;
+
+	warg.walker = walker;
+	warg.arg = arg;
+	rhash_buckets(h, rhash_walk_bucket, &warg);
+}
+
+/** Compute histogram of chain lengths.
+ *
+ * Buckets of the old array that are not migrated yet are
+ * counted along with the buckets of the current array.
+ *
+ * @param h Hash table.
+ * @param hist Array of n counters. hist[i] receives the number of
+ *	buckets with i items, hist[n - 1] also counts all longer chains.
+ * @param n Number of counters.
+ */
+void rhash_table_histogram(rhash_table_t *h, count_t hist[], count_t n)
+{
+	rhash_histogram_arg_t harg;
+	index_t i;
+
+	ASSERT(n > 0);
+
+	for (i = 0; i < n; i++)
+		hist[i] = 0;
+
+	harg.hist = hist;
+	harg.n = n;
+	rhash_buckets(h, rhash_histogram_bucket, &harg);
+}
+
+/** Allocate and initialize array of buckets.
+ *
+ * Buckets which do not fit into the largest malloc()
+ * cache are allocated directly from the frame allocator.
+ *
+ * @param size Number of buckets.
+ * @param flags Flags passed to malloc() and frame_alloc().
+ *
+ * @return New array or NULL if there is not enough memory.
+ */
+rhash_array_t *rhash_array_create(count_t size, int flags)
+{
+	rhash_array_t *a;
+	size_t bytes = size * sizeof(rhash_bucket_t);
+	pfn_t pfn;
+	__u8 order;
+	index_t i;
+
+	a = (rhash_array_t *) malloc(sizeof(rhash_array_t), flags);
+	if (!a)
+		return NULL;
+
+	a->frames = bytes > (1 << SLAB_MAX_MALLOC_W);
+	if (a->frames) {
+		for (order = 0; (FRAME_SIZE << order) < bytes; order++)
+			;
+		pfn = frame_alloc(order, FRAME_KA | flags);
+		a->bucket = pfn ? (rhash_bucket_t *) PA2KA(PFN2ADDR(pfn)) : NULL;
+	} else {
+		a->bucket = (rhash_bucket_t *) malloc(bytes, flags);
+	}
+	if (!a->bucket) {
+		free(a);
+		return NULL;
+	}
+
+	a->size = size;
+	a->next = NULL;
+	for (i = 0; i < size; i++) {
+		spinlock_initialize(&a->bucket[i].lock, "rhash_bucket.lock");
+		list_initialize(&a->bucket[i].head);
+		a->bucket[i].migrated = false;
+	}
+
+	return a;
+}
+
+/** Free migrated array of buckets, called after a grace period. */
+void rhash_array_free(rcu_head_t *head)
+{
+	rhash_array_t *a = (rhash_array_t *) head;
+
+	if (a->frames)
+		frame_free(ADDR2PFN(KA2PA(a->bucket)));
+	else
+		free(a->bucket);
+	free(a);
+}
+
+/** Find and lock bucket for hash.
+ *
+ * Must be called in an RCU read section.
+ *
+ * @param h Hash table.
+ * @param hash Hash of the keys.
+ *
+ * @return Locked bucket.
+ */
+rhash_bucket_t *rhash_lock(rhash_table_t *h, __native hash)
+{
+	rhash_array_t *a, *old;
+	rhash_bucket_t *b;
+
+	/*
+	 * Items not yet migrated are in the old array. It is published
+	 * before the current one, so seeing the new current array
+	 * implies seeing the old one.
+	 */
+	a = h->cur;
+	read_barrier();
+	old = h->old;
+	if (old)
+		a = old;
+
+	while (1) {
+		b = &a->bucket[hash & (a->size - 1)];
+		spinlock_lock(&b->lock);
+		if (!b->migrated)
+			return b;
+		spinlock_unlock(&b->lock);
+		a = a->next;
+	}
+}
+
+/** Grow hash table or migrate some buckets if needed.
+ *
+ * Must be called in an RCU read section with interrupts disabled.
+ * It gives up if another CPU is resizing the table already.
+ *
+ * @param h Hash table.
+ */
+void rhash_maintain(rhash_table_t *h)
+{
+	if (!h->old && atomic_get(&h->items) <= h->cur->size * RHASH_LOAD_MAX)
+		return;
+
+	if (!spinlock_trylock(&h->resize_lock))
+		return;
+
+	if (!h->walkers) {
+		if (h->old)
+			rhash_migrate(h);
+		else if (atomic_get(&h->items) > h->cur->size * RHASH_LOAD_MAX)
+			rhash_grow(h);
+	}
+
+	spinlock_unlock(&h->resize_lock);
+}
+
+/** Start growing hash table.
+ *
+ * Must be called with h->resize_lock held and no old array.
+ * The table keeps its size if the larger array cannot be
+ * allocated without blocking.
+ *
+ * @param h Hash table.
+ */
+void rhash_grow(rhash_table_t *h)
+{
+	rhash_array_t *a;
+
+	a = rhash_array_create(h->cur->size * 2, FRAME_ATOMIC);
+	if (!a)
+		return;
+
+	h->cur->next = a;
+	h->old = h->cur;
+	h->migrated = 0;
+	write_barrier();
+	h->cur = a;
+}
+
+/** Move some buckets of the old array to the current one.
+ *
+ * Must be called with h->resize_lock held.
+ * The old array is twice smaller than the current one,
+ * so items of bucket i go to bucket i or i + old size.
+ *
+ * @param h Hash table.
+ */
+void rhash_migrate(rhash_table_t *h)
+{
+	rhash_array_t *old = h->old;
+	rhash_array_t *cur = h->cur;
+	rhash_bucket_t *ob;
+	index_t nb;
+	link_t *item;
+	int i;
+
+	for (i = 0; i < RHASH_MIGRATE_STEP && h->migrated < old->size; i++, h->migrated++) {
+		ob = &old->bucket[h->migrated];
+
+		/*
+		 * Other CPUs hold at most one bucket at a time,
+		 * so the order only has to be consistent here.
+		 */
+		spinlock_lock(&ob->lock);
+		spinlock_lock(&cur->bucket[h->migrated].lock);
+		spinlock_lock(&cur->bucket[h->migrated + old->size].lock);
+
+		while (!list_empty(&ob->head)) {
+			item = ob->head.next;
+			list_remove(item);
+			nb = h->op->hash_item(item) & (cur->size - 1);
+			ASSERT(nb == h->migrated || nb == h->migrated + old->size);
+			list_append(item, &cur->bucket[nb].head);
+		}
+		ob->migrated = true;
+
+		spinlock_unlock(&cur->bucket[h->migrated + old->size].lock);
+		spinlock_unlock(&cur->bucket[h->migrated].lock);
+		spinlock_unlock(&ob->lock);
+	}
+
+	if (h->migrated == old->size) {
+		h->old = NULL;
+		call_rcu(&old->rcu, rhash_array_free);
+	}
+}
+
+/** Call function for every bucket of hash table.
+ *
+ * The function is called with the bucket locked and
+ * interrupts disabled. Migration is held off meanwhile,
+ * so that the arrays do not change.
+ *
+ * @param h Hash table.
+ * @param fn Function to call.
+ * @param arg Argument passed to fn.
+ */
+void rhash_buckets(rhash_table_t *h, rhash_bucket_fn_t fn, void *arg)
+{
+	rhash_array_t *a;
+	rhash_bucket_t *b;
+	index_t i;
+	ipl_t ipl;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&h->resize_lock);
+	h->walkers++;
+	a = h->old ? h->old : h->cur;
+	spinlock_unlock(&h->resize_lock);
+	interrupts_restore(ipl);
+
+	for (; a; a = a->next) {
+		for (i = 0; i < a->size; i++) {
+			b = &a->bucket[i];
+			ipl = interrupts_disable();
+			spinlock_lock(&b->lock);
+			if (!b->migrated)
+				fn(h, b, arg);
+			spinlock_unlock(&b->lock);
+			interrupts_restore(ipl);
+		}
+	}
+
+	ipl = interrupts_disable();
+	spinlock_lock(&h->resize_lock);
+	h->walkers--;
+	spinlock_unlock(&h->resize_lock);
+	interrupts_restore(ipl);
+}
+
+/** Remove matching items from locked bucket.
+ *
+ * @param h Hash table.
+ * @param b Locked bucket.
+ * @param arg Keys to compare, rhash_remove_arg_t.
+ */
+void rhash_remove_bucket(rhash_table_t *h, rhash_bucket_t *b, void *arg)
+{
+	rhash_remove_arg_t *rarg = (rhash_remove_arg_t *) arg;
+	link_t *cur, *next;
+
+	for (cur = b->head.next; cur != &b->head; cur = next) {
+		next = cur->next;
+		if (h->op->compare(rarg->key, rarg->keys, cur)) {
+			list_remove(cur);
+			atomic_dec(&h->items);
+			h->op->remove_callback(cur);
+		}
+	}
+}
+
+/** Call walker for items of locked bucket.
+ *
+ * @param h Hash table.
+ * @param b Locked bucket.
+ * @param arg Walker and its argument.
+ */
+void rhash_walk_bucket(rhash_table_t *h, rhash_bucket_t *b, void *arg)
+{
+	rhash_walk_arg_t *warg = (rhash_walk_arg_t *) arg;
+	link_t *cur, *next;
+
+	for (cur = b->head.next; cur != &b->head; cur = next) {
+		next = cur->next;
+		warg->walker(cur, warg->arg);
+	}
+}
+
+/** Count chain length of locked bucket.
+ *
+ * @param h Hash table.
+ * @param b Locked bucket.
+ * @param arg Histogram, rhash_histogram_arg_t.
+ */
+void rhash_histogram_bucket(rhash_table_t *h, rhash_bucket_t *b, void *arg)
+{
+	rhash_histogram_arg_t *harg = (rhash_histogram_arg_t *) arg;
+	link_t *cur;
+	count_t len = 0;
+
+	for (cur = b->head.next; cur != &b->head; cur = cur->next)
+		len++;
+
+	harg->hist[len < harg->n ? len : harg->n - 1]++;
+}
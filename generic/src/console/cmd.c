@@ -59,6 +59,16 @@
 #include <proc/thread.h>
 #include <proc/task.h>
 #include <ipc/ipc.h>
+#include <main/timeline.h>
+#include <syscall/syscall.h>
+#include <synch/rcu.h>
+#ifdef CONFIG_TEST
+#include <test.h>
+#endif /* CONFIG_TEST */
+
+#ifdef CONFIG_PAGE_HT
+#include <genarch/mm/page_ht.h>
+#endif
 
 /** Data and methods for 'help' command. */
 static int cmd_help(cmd_arg_t *argv);
@@ -301,6 +311,15 @@ static cmd_info_t zones_info = {
 	.argc = 0
 };
 
+/** Data and methods for 'frag' command */
+static int cmd_frag(cmd_arg_t *argv);
+static cmd_info_t frag_info = {
+	.name = "frag",
+	.description = "Show free block histogram and fragmentation index of memory zones.",
+	.func = cmd_frag,
+	.argc = 0
+};
+
 /** Data and methods for 'ipc_task' command */
 static int cmd_ipc_task(cmd_arg_t *argv);
 static cmd_arg_t ipc_task_argv = {
@@ -350,26 +369,249 @@ cmd_info_t version_info = {
 	.argv = NULL
 };
 
+/** Data and methods for 'boottime' command. */
+static int cmd_boottime(cmd_arg_t *argv);
+static cmd_info_t boottime_info = {
+	.name = "boottime",
+	.description = "Print boot timeline.",
+	.func = cmd_boottime,
+	.argc = 0
+};
+
+#ifdef CONFIG_SYSCALL_STATS
+/** Data and methods for 'syscalls' command. */
+static int cmd_syscalls(cmd_arg_t *argv);
+static cmd_info_t syscalls_info = {
+	.name = "syscalls",
+	.description = "Print per-CPU syscall statistics.",
+	.func = cmd_syscalls,
+	.argc = 0
+};
+#endif /* CONFIG_SYSCALL_STATS */
+
+#if defined(CONFIG_SMP) && defined(CONFIG_LOCK_STAT)
+/** Data and methods for 'lockstat' command. */
+static int cmd_lockstat(cmd_arg_t *argv);
+static cmd_info_t lockstat_info = {
+	.name = "lockstat",
+	.description = "Print spinlock contention statistics.",
+	.func = cmd_lockstat,
+	.argc = 0
+};
+#endif /* CONFIG_SMP && CONFIG_LOCK_STAT */
+
+#ifdef CONFIG_PAGE_HT
+/** Data and methods for 'pageht' command. */
+static int cmd_pageht(cmd_arg_t *argv);
+static cmd_info_t pageht_info = {
+	.name = "pageht",
+	.description = "Print page hash table chain length histogram.",
+	.func = cmd_pageht,
+	.argc = 0
+};
+#endif /* CONFIG_PAGE_HT */
+
+/** Data and methods for 'rcu' command. */
+static int cmd_rcu(cmd_arg_t *argv);
+static cmd_info_t rcu_info = {
+	.name = "rcu",
+	.description = "Print RCU grace period statistics.",
+	.func = cmd_rcu,
+	.argc = 0
+};
+
+#ifdef CONFIG_TEST
+/** Data and methods for 'btreebench' command. */
+static int cmd_btreebench(cmd_arg_t *argv);
+static cmd_info_t btreebench_info = {
+	.name = "btreebench",
+	.description = "Benchmark B+tree operations at various sizes.",
+	.func = cmd_btreebench,
+	.argc = 0
+};
+
+/** Data and methods for 'btreetest' command. */
+static int cmd_btreetest(cmd_arg_t *argv);
+static cmd_info_t btreetest_info = {
+	.name = "btreetest",
+	.description = "Test B+tree range operations.",
+	.func = cmd_btreetest,
+	.argc = 0
+};
+
+/** Data and methods for 'condvarbench' command. */
+static int cmd_condvarbench(cmd_arg_t *argv);
+static cmd_info_t condvarbench_info = {
+	.name = "condvarbench",
+	.description = "Benchmark condition variable broadcasts.",
+	.func = cmd_condvarbench,
+	.argc = 0
+};
+
+/** Data and methods for 'faultbench' command. */
+static int cmd_faultbench(cmd_arg_t *argv);
+static cmd_info_t faultbench_info = {
+	.name = "faultbench",
+	.description = "Benchmark page faults of a multi-threaded task.",
+	.func = cmd_faultbench,
+	.argc = 0
+};
+
+/** Data and methods for 'futexbench' command. */
+static int cmd_futexbench(cmd_arg_t *argv);
+static cmd_info_t futexbench_info = {
+	.name = "futexbench",
+	.description = "Benchmark contended futexes of many tasks.",
+	.func = cmd_futexbench,
+	.argc = 0
+};
+
+/** Data and methods for 'futextest' command. */
+static int cmd_futextest(cmd_arg_t *argv);
+static cmd_info_t futextest_info = {
+	.name = "futextest",
+	.description = "Test futex wakeup and requeue operations.",
+	.func = cmd_futextest,
+	.argc = 0
+};
+
+/** Data and methods for 'pingpongbench' command. */
+static int cmd_pingpongbench(cmd_arg_t *argv);
+static cmd_info_t pingpongbench_info = {
+	.name = "pingpongbench",
+	.description = "Benchmark switches between threads of different tasks.",
+	.func = cmd_pingpongbench,
+	.argc = 0
+};
+
+/** Data and methods for 'rcutest' command. */
+static int cmd_rcutest(cmd_arg_t *argv);
+static cmd_info_t rcutest_info = {
+	.name = "rcutest",
+	.description = "Test RCU grace periods on all CPUs.",
+	.func = cmd_rcutest,
+	.argc = 0
+};
+
+/** Data and methods for 'rhashbench' command. */
+static int cmd_rhashbench(cmd_arg_t *argv);
+static cmd_info_t rhashbench_info = {
+	.name = "rhashbench",
+	.description = "Benchmark resizable hash table at various load factors.",
+	.func = cmd_rhashbench,
+	.argc = 0
+};
+
+/** Data and methods for 'rhashtest' command. */
+static int cmd_rhashtest(cmd_arg_t *argv);
+static cmd_info_t rhashtest_info = {
+	.name = "rhashtest",
+	.description = "Test resizable hash table on all CPUs.",
+	.func = cmd_rhashtest,
+	.argc = 0
+};
+
+/** Data and methods for 'rwlockbench' command. */
+static int cmd_rwlockbench(cmd_arg_t *argv);
+static cmd_info_t rwlockbench_info = {
+	.name = "rwlockbench",
+	.description = "Benchmark read-mostly reader/writer lock use.",
+	.func = cmd_rwlockbench,
+	.argc = 0
+};
+
+/** Data and methods for 'spawnbench' command. */
+static int cmd_spawnbench(cmd_arg_t *argv);
+static cmd_info_t spawnbench_info = {
+	.name = "spawnbench",
+	.description = "Benchmark task creation and teardown.",
+	.func = cmd_spawnbench,
+	.argc = 0
+};
+
+/** Data and methods for 'symtabbench' command. */
+static int cmd_symtabbench(cmd_arg_t *argv);
+static cmd_info_t symtabbench_info = {
+	.name = "symtabbench",
+	.description = "Benchmark kernel symbol table lookups.",
+	.func = cmd_symtabbench,
+	.argc = 0
+};
+
+/** Data and methods for 'yieldbench' command. */
+static int cmd_yieldbench(cmd_arg_t *argv);
+static cmd_info_t yieldbench_info = {
+	.name = "yieldbench",
+	.description = "Benchmark thread switches on one CPU.",
+	.func = cmd_yieldbench,
+	.argc = 0
+};
+#endif /* CONFIG_TEST */
+
 static cmd_info_t *basic_commands[] = {
+	&boottime_info,
+#ifdef CONFIG_TEST
+	&btreebench_info,
+	&btreetest_info,
+#endif /* CONFIG_TEST */
 	&call0_info,
 	&call1_info,
 	&call2_info,
 	&call3_info,
+#ifdef CONFIG_TEST
+	&condvarbench_info,
+#endif /* CONFIG_TEST */
 	&continue_info,
 	&cpus_info,
 	&desc_info,
 	&exit_info,
+#ifdef CONFIG_TEST
+	&faultbench_info,
+#endif /* CONFIG_TEST */
+	&frag_info,
+#ifdef CONFIG_TEST
+	&futexbench_info,
+	&futextest_info,
+#endif /* CONFIG_TEST */
 	&halt_info,
 	&help_info,
 	&ipc_task_info,
+#if defined(CONFIG_SMP) && defined(CONFIG_LOCK_STAT)
+	&lockstat_info,
+#endif /* CONFIG_SMP && CONFIG_LOCK_STAT */
+#ifdef CONFIG_PAGE_HT
+	&pageht_info,
+#endif /* CONFIG_PAGE_HT */
+#ifdef CONFIG_TEST
+	&pingpongbench_info,
+#endif /* CONFIG_TEST */
+	&rcu_info,
+#ifdef CONFIG_TEST
+	&rcutest_info,
+	&rhashbench_info,
+	&rhashtest_info,
+	&rwlockbench_info,
+#endif /* CONFIG_TEST */
 	&set4_info,
 	&slabs_info,
+#ifdef CONFIG_TEST
+	&spawnbench_info,
+#endif /* CONFIG_TEST */
 	&symaddr_info,
+#ifdef CONFIG_TEST
+	&symtabbench_info,
+#endif /* CONFIG_TEST */
+#ifdef CONFIG_SYSCALL_STATS
+	&syscalls_info,
+#endif /* CONFIG_SYSCALL_STATS */
 	&sched_info,
 	&threads_info,
 	&tasks_info,
 	&tlb_info,
 	&version_info,
+#ifdef CONFIG_TEST
+	&yieldbench_info,
+#endif /* CONFIG_TEST */
 	&zones_info,
 	&zone_info,
 	NULL
@@ -701,6 +943,17 @@ int cmd_zone(cmd_arg_t * argv) {
 	return 1;
 }
 
+/** Command for printing memory fragmentation statistics
+ *
+ * @param argv Ignored
+ *
+ * return Always 1
+ */
+int cmd_frag(cmd_arg_t * argv) {
+	zone_print_frag();
+	return 1;
+}
+
 /** Command for printing task ipc details
  *
  * @param argv Integer argument from cmdline expected
@@ -737,6 +990,242 @@ int cmd_version(cmd_arg_t *argv)
 	return 1;
 }
 
+/** Command for printing the boot timeline.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_boottime(cmd_arg_t *argv)
+{
+	timeline_print();
+	return 1;
+}
+
+#ifdef CONFIG_SYSCALL_STATS
+/** Command for printing syscall statistics.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_syscalls(cmd_arg_t *argv)
+{
+	syscall_stats_print();
+	return 1;
+}
+#endif /* CONFIG_SYSCALL_STATS */
+
+#ifdef CONFIG_PAGE_HT
+/** Command for printing page hash table histogram.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_pageht(cmd_arg_t *argv)
+{
+	ht_print_histogram();
+	return 1;
+}
+#endif /* CONFIG_PAGE_HT */
+
+#ifdef CONFIG_TEST
+/** Command for benchmarking B+tree operations.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_btreebench(cmd_arg_t *argv)
+{
+	bench_btree2();
+	return 1;
+}
+
+/** Command for testing B+tree range operations.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_btreetest(cmd_arg_t *argv)
+{
+	printf("B+tree test %s\n", test_btree1() ? "passed" : "failed");
+	return 1;
+}
+
+/** Command for benchmarking condition variable broadcasts.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_condvarbench(cmd_arg_t *argv)
+{
+	bench_condvar1();
+	return 1;
+}
+
+/** Command for benchmarking page faults.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_faultbench(cmd_arg_t *argv)
+{
+	bench_fault1();
+	return 1;
+}
+
+/** Command for benchmarking contended futexes.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_futexbench(cmd_arg_t *argv)
+{
+	bench_futex2();
+	return 1;
+}
+
+/** Command for testing futex operations.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_futextest(cmd_arg_t *argv)
+{
+	printf("Futex test %s\n", test_futex1() ? "passed" : "failed");
+	return 1;
+}
+
+/** Command for benchmarking switches between tasks.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_pingpongbench(cmd_arg_t *argv)
+{
+	bench_pingpong1();
+	return 1;
+}
+
+/** Command for testing RCU.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_rcutest(cmd_arg_t *argv)
+{
+	printf("RCU test %s\n", test_rcu1() ? "passed" : "failed");
+	return 1;
+}
+
+/** Command for benchmarking resizable hash table.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_rhashbench(cmd_arg_t *argv)
+{
+	bench_rhash2();
+	return 1;
+}
+
+/** Command for testing resizable hash table.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_rhashtest(cmd_arg_t *argv)
+{
+	printf("Resizable hash table test %s\n", test_rhash1() ? "passed" : "failed");
+	return 1;
+}
+
+/** Command for benchmarking reader/writer locks.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_rwlockbench(cmd_arg_t *argv)
+{
+	bench_rwlock1();
+	return 1;
+}
+
+/** Command for benchmarking task creation and teardown.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_spawnbench(cmd_arg_t *argv)
+{
+	bench_spawn1();
+	return 1;
+}
+
+/** Command for benchmarking symbol table lookups.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_symtabbench(cmd_arg_t *argv)
+{
+	bench_symtab1();
+	return 1;
+}
+
+/** Command for benchmarking thread switches.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_yieldbench(cmd_arg_t *argv)
+{
+	bench_yield1();
+	return 1;
+}
+#endif /* CONFIG_TEST */
+
+/** Command for printing RCU statistics.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_rcu(cmd_arg_t *argv)
+{
+	rcu_print();
+	return 1;
+}
+
+#if defined(CONFIG_SMP) && defined(CONFIG_LOCK_STAT)
+/** Command for printing spinlock statistics.
+ *
+ * @param argv Ignored.
+ *
+ * return Always 1.
+ */
+int cmd_lockstat(cmd_arg_t *argv)
+{
+	lock_stat_print();
+	return 1;
+}
+#endif /* CONFIG_SMP && CONFIG_LOCK_STAT */
+
 /** Command for returning console back to userspace.
  *
  * @param argv Ignored.
@@ -48,6 +48,7 @@
 #include <func.h>
 #include <symtab.h>
 #include <macros.h>
+#include <printf/printbuf.h>
 
 /** Simple kernel console.
  *
@@ -411,6 +412,13 @@ void kconsole(void *prompt)
 		printf("%s: no stdin\n", __FUNCTION__);
 		return;
 	}
+
+	/*
+	 * Input is echoed by putchar(), which is not buffered.
+	 * Keep the prompt and command output in order with it.
+	 */
+	if (THREAD)
+		printbuf_console_set(THREAD);
 	
 	while (true) {
 		cmdline = clever_readline(prompt, stdin);
@@ -31,22 +31,45 @@
 #include <console/klog.h>
 #include <print.h>
 #include <ipc/irq.h>
-
-/* Order of frame to be allocated for klog communication */
-#define KLOG_ORDER 0
+#include <synch/spinlock.h>
+#include <arch/barrier.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <atomic.h>
+#include <align.h>
+#include <macros.h>
+#include <memstr.h>
+#include <cpu.h>
 
 static char *klog;
-static int klogsize;
-static int klogpos;
+static size_t klogsize;
 
+/*
+ * klog_lock protects only the reservation of space in the log.
+ * Records are formatted before and copied in after the lock is
+ * dropped.
+ */
 SPINLOCK_INITIALIZE(klog_lock);
+static __u64 klogpos;		/**< Position of the next record to be reserved. */
+static __u64 klogseq;		/**< Sequence number of the next record. */
+static atomic_t klog_writers;	/**< Number of records being copied in. */
+
+/*
+ * Position up to which userspace has been notified.
+ * Accessed only by klog_notify().
+ */
+SPINLOCK_INITIALIZE(klog_notify_lock);
+static __u64 klog_notified;
+
+static void klog_copy_in(__u64 pos, const void *src, size_t cnt);
 
 /** Initialize kernel logging facility
  *
  * Allocate pages that are to be shared with uspace for console data.
- * The shared area is a circular buffer. Userspace application may
- * be notified on new data with indication of position and size
- * of the data within the circular buffer.
+ * The shared area is a circular buffer of records described by
+ * klog_hdr_t. Userspace application may be notified on new data with
+ * indication of position and size of the data within the circular
+ * buffer. The notifications are coalesced, see klog_notify().
  */
 void klog_init(void)
 {
@@ -62,29 +85,47 @@ void klog_init(void)
 
 	klogsize = PAGE_SIZE << KLOG_ORDER;
 	klogpos = 0;
+	klogseq = 0;
+	klog_notified = 0;
+	atomic_set(&klog_writers, 0);
 }
 
 static void klog_vprintf(const char *fmt, va_list args)
 {
+	char text[KLOG_RECORD_MAX];
+	klog_hdr_t hdr;
+	__u64 pos;
 	int ret;
+	ipl_t ipl;
 	va_list atst;
 
+	hdr.stamp = get_cycle();
+
 	va_copy(atst, args);
-	spinlock_lock(&klog_lock);
+	ret = vsnprintf(text, sizeof(text), fmt, atst);
+	va_end(atst);
+	if (ret < 0)
+		return;
+	hdr.len = min(ret, sizeof(text) - 1);
 
-	ret = vsnprintf(klog+klogpos, klogsize-klogpos, fmt, atst);
-	if (ret >= klogsize-klogpos) {
-		klogpos = 0;
-		if (ret >= klogsize)
-			goto out;
-	}
-	ipc_irq_send_msg(IPC_IRQ_KLOG, klogpos, ret);
-	klogpos += ret;
-	if (klogpos >= klogsize)
-		klogpos = 0;
-out:
+	ipl = interrupts_disable();
+	hdr.cpu = CPU ? CPU->id : 0;
+
+	spinlock_lock(&klog_lock);
+	pos = klogpos;
+	klogpos += ALIGN_UP(sizeof(klog_hdr_t) + hdr.len, KLOG_ALIGN);
+	hdr.seq = klogseq++;
+	atomic_inc(&klog_writers);
 	spinlock_unlock(&klog_lock);
-	va_end(atst);
+
+	klog_copy_in(pos + sizeof(klog_hdr_t), text, hdr.len);
+	/* The header goes last so that the sequence number marks a complete record. */
+	write_barrier();
+	klog_copy_in(pos, &hdr, sizeof(klog_hdr_t));
+	write_barrier();
+	atomic_dec(&klog_writers);
+
+	interrupts_restore(ipl);
 }
 
 /** Printf a message to kernel-uspace log */
@@ -98,3 +139,47 @@ void klog_printf(const char *fmt, ...)
 
 	va_end(args);
 }
+
+/** Notify userspace about new records in the log
+ *
+ * A single notification covers all records logged since the
+ * previous one. The notification is postponed while some record
+ * is still being copied in. Called periodically by kprintd.
+ */
+void klog_notify(void)
+{
+	__u64 pos, len;
+	ipl_t ipl;
+
+	if (!klog)
+		return;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&klog_notify_lock);
+
+	spinlock_lock(&klog_lock);
+	pos = klogpos;
+	if (atomic_get(&klog_writers))
+		pos = klog_notified;
+	spinlock_unlock(&klog_lock);
+
+	if (pos != klog_notified) {
+		len = min(pos - klog_notified, klogsize);
+		ipc_irq_send_msg(IPC_IRQ_KLOG, (pos - len) % klogsize, len);
+		klog_notified = pos;
+	}
+
+	spinlock_unlock(&klog_notify_lock);
+	interrupts_restore(ipl);
+}
+
+/** Copy data into the log, wrapping around its end. */
+void klog_copy_in(__u64 pos, const void *src, size_t cnt)
+{
+	index_t offset = pos % klogsize;
+	size_t first = min(cnt, klogsize - offset);
+
+	memcpy(klog + offset, src, first);
+	if (cnt > first)
+		memcpy(klog, ((char *) src) + first, cnt - first);
+}
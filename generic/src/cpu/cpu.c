@@ -83,7 +83,11 @@ void cpu_init(void) {
 	}
 	#endif /* CONFIG_SMP */
 
-	CPU = &cpus[config.cpu_active-1];
+	/*
+	 * Application processors have claimed their slot already in main_ap().
+	 */
+	if (!CPU)
+		CPU = &cpus[config.cpu_active-1];
 	
 	CPU->active = 1;
 	CPU->tlb_active = 1;
@@ -77,7 +77,7 @@ static int ddi_physmem_map(__address pf, __address vp, count_t pages, int flags)
 	ipl = interrupts_disable();
 	spinlock_lock(&TASK->lock);
 	
-	if (!as_area_create(TASK->as, flags, pages * PAGE_SIZE, vp, AS_AREA_ATTR_NONE,
+	if (!as_area_create(TASK->as, flags | AS_AREA_LARGE, pages * PAGE_SIZE, vp, AS_AREA_ATTR_NONE,
 		&phys_backend, &backend_data)) {
 		/*
 		 * The address space area could not have been created.
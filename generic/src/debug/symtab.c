@@ -36,6 +36,94 @@
 #include <arch/byteorder.h>
 #include <func.h>
 #include <print.h>
+#include <mm/slab.h>
+
+/** Number of entries in symbol_table, computed on first use. */
+static count_t symtab_count = 0;
+
+/*
+ * Open addressing hash of symbol_table indices keyed by the symbol
+ * name following the colon. Empty slots contain -1.
+ */
+static int *symtab_hash = NULL;
+static count_t symtab_hash_size = 0;
+
+static count_t symtab_size(void);
+static char *symtab_name(count_t i);
+static __u32 symtab_hash_name(const char *name);
+
+/** Return number of entries in symbol_table. */
+count_t symtab_size(void)
+{
+	count_t i;
+
+	if (!symtab_count) {
+		for (i = 0; symbol_table[i].address_le; i++)
+			;
+		symtab_count = i;
+	}
+
+	return symtab_count;
+}
+
+/** Return the part of entry name that follows the colon or NULL if there is none. */
+char *symtab_name(count_t i)
+{
+	char *name = symbol_table[i].symbol_name;
+
+	while (*name && *name != ':')
+		name++;
+
+	return *name ? name + 1 : NULL;
+}
+
+/** Compute hash of symbol name. */
+__u32 symtab_hash_name(const char *name)
+{
+	__u32 hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (__u8) *name++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/** Build the index of symbols by name.
+ *
+ * Must be called after the slab allocator is initialized.
+ * Until then, get_symbol_addr() searches the table linearly.
+ */
+void symtab_init(void)
+{
+	count_t i, size;
+	int *hash;
+	char *name;
+	__u32 h;
+
+	for (size = 1; size < 2 * symtab_size(); size <<= 1)
+		;
+
+	hash = (int *) malloc(size * sizeof(int), FRAME_ATOMIC);
+	if (!hash)
+		return;
+
+	for (i = 0; i < size; i++)
+		hash[i] = -1;
+
+	for (i = 0; i < symtab_size(); i++) {
+		name = symtab_name(i);
+		if (!name)
+			continue;
+		for (h = symtab_hash_name(name) & (size - 1); hash[h] != -1; h = (h + 1) & (size - 1))
+			;
+		hash[h] = i;
+	}
+
+	symtab_hash_size = size;
+	symtab_hash = hash;
+}
 
 /** Return entry that seems most likely to correspond to argument.
  *
@@ -44,19 +132,28 @@
  *
  * @param addr Address.
  *
+ * The symbol table is sorted by address, so this is a binary search
+ * for the last entry not above addr.
+ *
  * @return Pointer to respective symbol string on success, NULL otherwise.
  */
 char * get_symtab_entry(__native addr)
 {
-	count_t i;
+	count_t lo = 0, hi = symtab_size(), mid;
 
-	for (i=1;symbol_table[i].address_le;++i) {
-		if (addr < __u64_le2host(symbol_table[i].address_le))
-			break;
+	if (!hi || addr < __u64_le2host(symbol_table[0].address_le))
+		return NULL;
+
+	/* Invariant: entry lo is not above addr, entry hi is (or does not exist). */
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (addr < __u64_le2host(symbol_table[mid].address_le))
+			hi = mid;
+		else
+			lo = mid;
 	}
-	if (addr >= __u64_le2host(symbol_table[i-1].address_le))
-		return symbol_table[i-1].symbol_name;
-	return NULL;
+
+	return symbol_table[lo].symbol_name;
 }
 
 /** Find symbols that match the parameter forward and print them.
@@ -110,6 +207,24 @@ __address get_symbol_addr(const char *name)
 	__address addr = NULL;
 	char *hint;
 	int i;
+	__u32 h;
+
+	for (i = 0; name[i] && name[i] != ':'; i++)
+		;
+
+	/* Names qualified by the part before the colon are searched linearly. */
+	if (symtab_hash && !name[i]) {
+		for (h = symtab_hash_name(name) & (symtab_hash_size - 1); symtab_hash[h] != -1;
+		    h = (h + 1) & (symtab_hash_size - 1)) {
+			if (strncmp(symtab_name(symtab_hash[h]), name, MAX_SYMBOL_NAME) == 0) {
+				addr = __u64_le2host(symbol_table[symtab_hash[h]].address_le);
+				found++;
+			}
+		}
+		if (found > 1)
+			return ((__address) -1);
+		return addr;
+	}
 
 	i = 0;
 	while ((hint=symtab_search_one(name, &i))) {
@@ -38,6 +38,7 @@
 #include <arch.h>
 #include <typedefs.h>
 #include <console/kconsole.h>
+#include <printf/printbuf.h>
 
 atomic_t haltstate = {0}; /**< Halt flag */
 
@@ -63,6 +64,7 @@ void halt()
 #endif
 
 	interrupts_disable();
+	printbuf_flush();
 #ifdef CONFIG_DEBUG
 	if (rundebugger) {
 		printf("\n");
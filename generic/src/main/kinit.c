@@ -56,6 +56,7 @@
 #include <console/console.h>
 #include <interrupt.h>
 #include <console/kconsole.h>
+#include <printf/printbuf.h>
 #include <security/cap.h>
 
 #ifdef CONFIG_SMP
@@ -64,6 +65,7 @@
 
 #include <synch/waitq.h>
 #include <synch/spinlock.h>
+#include <synch/rcu.h>
 
 #ifdef CONFIG_TEST
 #include <test.h>
@@ -80,6 +82,7 @@
 void kinit(void *arg)
 {
 	thread_t *t;
+	count_t i;
 
 	/*
 	 * Detach kinit as nobody will call thread_join_timeout() on it.
@@ -92,8 +95,9 @@ void kinit(void *arg)
 	if (config.cpu_count > 1) {
 		/*
 		 * Create the kmp thread and wait for its completion.
-		 * cpu1 through cpuN-1 will come up consecutively and
-		 * not mess together with kcpulb threads.
+		 * cpu1 through cpuN-1 will be started one after another
+		 * and finish their initialization in parallel, all before
+		 * any kcpulb threads get created.
 		 * Just a beautification.
 		 */
 		if ((t = thread_create(kmp, NULL, TASK, 0, "kmp"))) {
@@ -117,8 +121,6 @@ void kinit(void *arg)
 
 #ifdef CONFIG_SMP
 	if (config.cpu_count > 1) {
-		int i;
-		
 		/*
 		 * For each CPU, create its load balancing thread.
 		 */
@@ -137,11 +139,34 @@ void kinit(void *arg)
 	}
 #endif /* CONFIG_SMP */
 
+	/*
+	 * For each CPU, create the thread running its RCU callbacks.
+	 */
+	for (i = 0; i < config.cpu_count; i++) {
+		if ((t = thread_create(krcud, NULL, TASK, 0, "krcud"))) {
+			spinlock_lock(&t->lock);
+			t->flags |= X_WIRED;
+			t->cpu = &cpus[i];
+			spinlock_unlock(&t->lock);
+			thread_ready(t);
+		}
+		else panic("thread_create/krcud\n");
+	}
+
 	/*
 	 * At this point SMP, if present, is configured.
 	 */
 	arch_post_smp_init();
 
+	/*
+	 * From now on, printf() only buffers the output
+	 * and kprintd moves it to the console.
+	 */
+	if ((t = thread_create(kprintd, NULL, TASK, 0, "kprintd")))
+		thread_ready(t);
+	else
+		panic("thread_create/kprintd\n");
+
 	/*
 	 * Create kernel console.
 	 */
@@ -158,7 +183,6 @@ void kinit(void *arg)
 #else  /* CONFIG_TEST */
 
 	task_t *utask;
-	count_t i;
 	for (i = 0; i < init.cnt; i++) {
 		/*
 		 * Run user tasks.
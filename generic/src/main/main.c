@@ -54,6 +54,9 @@
 #include <proc/task.h>
 #include <main/kinit.h>
 #include <main/version.h>
+#include <main/timeline.h>
+#include <printf/printbuf.h>
+#include <symtab.h>
 #include <console/kconsole.h>
 #include <cpu.h>
 #include <align.h>
@@ -67,6 +70,7 @@
 #include <mm/slab.h>
 #include <synch/waitq.h>
 #include <synch/futex.h>
+#include <synch/rcu.h>
 #include <arch/arch.h>
 #include <arch.h>
 #include <arch/faddr.h>
@@ -173,6 +177,7 @@ void main_bsp_separated_stack(void)
 	count_t i;
 	
 	the_initialize(THE);
+	timeline_stamp("bsp start");
 
 	/*
 	 * kconsole data structures must be initialized very early
@@ -197,14 +202,17 @@ void main_bsp_separated_stack(void)
 	as_init();
 	page_init();
 	tlb_init();
+	frame_sysinfo_init();
 	config.mm_initialized = true;
 	arch_post_mm_init();
+	timeline_stamp("bsp mm");
 
 	version_print();
 	printf("%.*p: hardcoded_ktext_size=%zdK, hardcoded_kdata_size=%zdK\n", sizeof(__address) * 2, config.base, hardcoded_ktext_size >> 10, hardcoded_kdata_size >> 10);
 
 	arch_pre_smp_init();
 	smp_init();
+	timeline_stamp("bsp smp");
 	
 	slab_enable_cpucache();	/* Slab must be initialized AFTER we know the number of processors */
 
@@ -213,18 +221,26 @@ void main_bsp_separated_stack(void)
 	cpu_init();
 	
 	calibrate_delay_loop();
+	timeline_stamp("bsp cpu");
 	clock_counter_init();
 	timeout_init();
 	scheduler_init();
 	task_init();
 	thread_init();
 	futex_init();
+	rcu_init();
 	klog_init();
+	printbuf_init();
+	symtab_init();
+#ifdef CONFIG_SYSCALL_STATS
+	syscall_stats_init();
+#endif /* CONFIG_SYSCALL_STATS */
 	
 	for (i = 0; i < init.cnt; i++)
 		printf("init[%zd].addr=%.*p, init[%zd].size=%zd\n", i, sizeof(__address) * 2, init.tasks[i].addr, i, init.tasks[i].size);
 	
 	ipc_init();
+	timeline_stamp("bsp subsystems");
 
 	/*
 	 * Create kernel task.
@@ -254,7 +270,7 @@ void main_bsp_separated_stack(void)
 /** Main kernel routine for application CPUs.
  *
  * Executed by application processors, temporary stack
- * is at ctx.sp which was set during BP boot.
+ * is taken from ap_boot_stacks which was set up by kmp.
  * This function passes control directly to
  * main_ap_separated_stack().
  *
@@ -263,24 +279,35 @@ void main_bsp_separated_stack(void)
  */
 void main_ap(void)
 {
+	count_t id;
+
 	/*
 	 * Incrementing the active CPU counter will guarantee that the
 	 * pm_init() will not attempt to build GDT and IDT tables again.
 	 * Neither frame_init() will do the complete thing. Neither cpu_init()
 	 * will do.
+	 *
+	 * kmp waits for the counter to change before it starts another AP,
+	 * but the rest of the initialization runs in parallel with other
+	 * APs. Therefore each AP remembers its own slot right away.
 	 */
-	config.cpu_active++;
+	id = config.cpu_active;
+	config.cpu_active = id + 1;
 
 	/*
-	 * The THE structure is well defined because ctx.sp is used as stack.
+	 * The THE structure is well defined because each AP
+	 * has its own boot stack.
 	 */
 	the_initialize(THE);
+	CPU = &cpus[id];
+	timeline_stamp("ap start");
 	
 	arch_pre_mm_init();
 	frame_init();
 	page_init();
 	tlb_init();
 	arch_post_mm_init();
+	timeline_stamp("ap mm");
 	
 	cpu_init();
 	
@@ -288,12 +315,13 @@ void main_ap(void)
 
 	l_apic_init();
 	l_apic_debug();
+	timeline_stamp("ap cpu");
 
 	the_copy(THE, (the_t *) CPU->stack);
 
 	/*
-	 * If we woke kmp up before we left the kernel stack, we could
-	 * collide with another CPU coming up. To prevent this, we
+	 * Once woken up by all APs, kmp releases their boot stacks.
+	 * To prevent it from pulling the stack from under our feet, we
 	 * switch to this cpu's private stack prior to waking kmp up.
 	 */
 	context_set(&CPU->saved_context, FADDR(main_ap_separated_stack), (__address) CPU->stack, CPU_STACK_SIZE);
@@ -313,6 +341,7 @@ void main_ap_separated_stack(void)
 	 * Configure timeouts for this cpu.
 	 */
 	timeout_init();
+	timeline_stamp("ap ready");
 
 	waitq_wakeup(&ap_completion_wq, WAKEUP_FIRST);
 	scheduler();
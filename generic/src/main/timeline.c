@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	timeline.c
+ * @brief	Boot timeline.
+ *
+ * The bootstrap processor and the application processors record
+ * the cycle counter at the end of each initialization phase so
+ * that the time spent in the individual phases can be examined
+ * from kconsole later on.
+ */
+
+#include <main/timeline.h>
+#include <arch/asm.h>
+#include <atomic.h>
+#include <arch.h>
+#include <cpu.h>
+#include <print.h>
+
+static timeline_entry_t timeline[TIMELINE_ENTRIES];
+static atomic_t timeline_count = { 0 };
+
+/** Record a boot timeline stamp.
+ *
+ * Can be called concurrently by all processors
+ * as soon as their THE structure is initialized.
+ *
+ * @param phase Name of the boot phase just finished.
+ */
+void timeline_stamp(char *phase)
+{
+	__u64 cycle = get_cycle();
+	long i;
+
+	i = atomic_postinc(&timeline_count);
+	if (i >= TIMELINE_ENTRIES)
+		return;
+
+	timeline[i].cpu = CPU ? CPU->id : 0;
+	timeline[i].phase = phase;
+	timeline[i].cycle = cycle;
+}
+
+/** Print the boot timeline.
+ *
+ * Times are relative to the first stamp recorded by
+ * the bootstrap processor. The cycle counters of all
+ * processors are assumed to be synchronized.
+ */
+void timeline_print(void)
+{
+	long i, count;
+	__u64 delta;
+
+	count = atomic_get(&timeline_count);
+	if (count > TIMELINE_ENTRIES)
+		count = TIMELINE_ENTRIES;
+
+	for (i = 0; i < count; i++) {
+		delta = timeline[i].cycle - timeline[0].cycle;
+		printf("cpu%d: %s: +%lld cycles", timeline[i].cpu, timeline[i].phase, delta);
+		if (cpus && cpus[0].frequency_mhz)
+			printf(" (%lld us)", delta / cpus[0].frequency_mhz);
+		printf("\n");
+	}
+}
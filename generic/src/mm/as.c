@@ -60,6 +60,7 @@
 #include <proc/task.h>
 #include <proc/thread.h>
 #include <arch/asm.h>
+#include <arch/barrier.h>
 #include <panic.h>
 #include <debug.h>
 #include <print.h>
@@ -73,23 +74,39 @@
 #include <typedefs.h>
 #include <syscall/copy.h>
 #include <arch/interrupt.h>
+#include <cpu.h>
+#include <sysinfo/sysinfo.h>
 
 as_operations_t *as_operations = NULL;
 
-/** This lock protects inactive_as_with_asid_head list. It must be acquired before as_t mutex. */
-SPINLOCK_INITIALIZE(inactive_as_with_asid_lock);
+/**
+ * This lock protects as_with_asid_head list and serializes assignment
+ * of ASIDs. It must be acquired before as_t mutex. It is not taken
+ * by as_switch() unless the new address space lacks an ASID.
+ */
+SPINLOCK_INITIALIZE(as_with_asid_lock);
 
 /**
- * This list contains address spaces that are not active on any
- * processor and that have valid ASID.
+ * This list contains address spaces that have valid ASID, ordered
+ * by the time of ASID assignment. It is not updated on address space
+ * switches and so it can contain address spaces that are active.
+ * Those are skipped by asid_get() when it looks for an ASID to steal.
  */
-LIST_INITIALIZE(inactive_as_with_asid_head);
+LIST_INITIALIZE(as_with_asid_head);
 
 /** Kernel address space. */
 as_t *AS_KERNEL = NULL;
 
 static int area_flags_to_page_flags(int aflags);
 static as_area_t *find_area_and_lock(as_t *as, __address va);
+static as_area_t *find_area_and_reference(as_t *as, __address va);
+static void area_remove_reference(as_area_t *a);
+static as_area_t *area_cache_lookup(as_t *as, __address va);
+static void area_cache_update(as_t *as, as_area_t *a);
+static __native as_area_cache_sysinfo(sysinfo_item_t *item);
+static void as_area_populate(as_area_t *a);
+static void as_area_pages_free(as_area_t *area, __address page, count_t count);
+static void as_asid_assign(as_t *as);
 static bool check_area_conflicts(as_t *as, __address va, size_t size, as_area_t *avoid_area);
 static void sh_info_remove_reference(share_info_t *sh_info);
 
@@ -100,7 +117,9 @@ void as_init(void)
 	AS_KERNEL = as_create(FLAG_AS_KERNEL);
 	if (!AS_KERNEL)
 		panic("can't create kernel address space\n");
-	
+
+	sysinfo_set_item_function("mm.area_cache.hits", NULL, as_area_cache_sysinfo);
+	sysinfo_set_item_function("mm.area_cache.misses", NULL, as_area_cache_sysinfo);
 }
 
 /** Create address space.
@@ -112,9 +131,11 @@ as_t *as_create(int flags)
 	as_t *as;
 
 	as = (as_t *) malloc(sizeof(as_t), 0);
-	link_initialize(&as->inactive_as_with_asid_link);
+	link_initialize(&as->as_with_asid_link);
 	mutex_initialize(&as->lock);
+	spinlock_initialize(&as->area_lock, "as_area_lock");
 	btree_create(&as->as_area_btree);
+	as->area_gen = 0;
 	
 	if (flags & FLAG_AS_KERNEL)
 		as->asid = ASID_KERNEL;
@@ -122,8 +143,10 @@ as_t *as_create(int flags)
 		as->asid = ASID_INVALID;
 	
 	as->refcount = 0;
-	as->cpu_refcount = 0;
+	atomic_set(&as->cpu_refcount, 0);
+	as->asid_steal = false;
 	as->page_table = page_table_create(flags);
+	mutex_initialize(&as->page_table_mutex);
 
 	return as;
 }
@@ -145,13 +168,12 @@ void as_destroy(as_t *as)
 	 * it is safe not to lock its mutex.
 	 */
 	ipl = interrupts_disable();
-	spinlock_lock(&inactive_as_with_asid_lock);
+	spinlock_lock(&as_with_asid_lock);
 	if (as->asid != ASID_INVALID && as != AS_KERNEL) {
-		if (as != AS && as->cpu_refcount == 0)
-			list_remove(&as->inactive_as_with_asid_link);
+		list_remove(&as->as_with_asid_link);
 		asid_put(as->asid);
 	}
-	spinlock_unlock(&inactive_as_with_asid_lock);
+	spinlock_unlock(&as_with_asid_lock);
 
 	/*
 	 * Destroy address space areas of the address space.
@@ -189,6 +211,9 @@ void as_destroy(as_t *as)
  * @param backend Address space area backend. NULL if no backend is used.
  * @param backend_data NULL or a pointer to an array holding two void *.
  *
+ * If AS_AREA_POPULATE is among the flags, all pages of the area are
+ * mapped by its backend right away instead of on page faults.
+ *
  * @return Address space area on success or NULL on failure.
  */
 as_area_t *as_area_create(as_t *as, int flags, size_t size, __address base, int attrs,
@@ -223,6 +248,7 @@ as_area_t *as_area_create(as_t *as, int flags, size_t size, __address base, int
 	a->as = as;
 	a->flags = flags;
 	a->attributes = attrs;
+	a->refcount = 1;
 	a->pages = SIZE2FRAMES(size);
 	a->base = base;
 	a->sh_info = NULL;
@@ -234,7 +260,13 @@ as_area_t *as_area_create(as_t *as, int flags, size_t size, __address base, int
 
 	btree_create(&a->used_space);
 	
+	spinlock_lock(&as->area_lock);
 	btree_insert(&as->as_area_btree, base, (void *) a, NULL);
+	as->area_gen++;
+	spinlock_unlock(&as->area_lock);
+
+	if ((flags & AS_AREA_POPULATE) && !(attrs & AS_AREA_ATTR_PARTIAL))
+		as_area_populate(a);
 
 	mutex_unlock(&as->lock);
 	interrupts_restore(ipl);
@@ -242,6 +274,93 @@ as_area_t *as_area_create(as_t *as, int flags, size_t size, __address base, int
 	return a;
 }
 
+/** Map all pages of a newly created address space area.
+ *
+ * The pages are mapped by the backend of the area as if they
+ * were faulted in. Pages that the backend cannot map are skipped.
+ * The address space must be locked and interrupts must be disabled.
+ *
+ * @param a Address space area.
+ */
+void as_area_populate(as_area_t *a)
+{
+	pf_access_t access;
+	__address page;
+	pte_t *pte;
+	bool mapped;
+
+	if (!a->backend || !a->backend->page_fault)
+		return;
+
+	if (a->flags & AS_AREA_READ)
+		access = PF_ACCESS_READ;
+	else if (a->flags & AS_AREA_WRITE)
+		access = PF_ACCESS_WRITE;
+	else
+		access = PF_ACCESS_EXEC;
+
+	mutex_lock(&a->lock);
+	for (page = a->base; page < a->base + a->pages * PAGE_SIZE; page += PAGE_SIZE) {
+		page_table_lock(a->as, false);
+		pte = page_mapping_find(a->as, page);
+		mapped = pte && PTE_PRESENT(pte);
+		page_table_unlock(a->as, false);
+		if (mapped)
+			continue;
+		(void) a->backend->page_fault(a, page, access);
+	}
+	mutex_unlock(&a->lock);
+}
+
+/** Unmap pages of address space area and free their frames.
+ *
+ * The pages must be mapped. The address space area and its page tables
+ * must be locked and the TLB shootdown sequence for the pages must be in
+ * progress. Because the shootdown holds the TLB lock with interrupts
+ * disabled, nothing in here may sleep; the page tables are therefore
+ * locked by the caller before the shootdown starts.
+ *
+ * @param area Address space area.
+ * @param page First page to be unmapped.
+ * @param count Number of pages to be unmapped.
+ */
+void as_area_pages_free(as_area_t *area, __address page, count_t count)
+{
+	count_t i;
+	__address off;
+	size_t size;
+	pte_t *pte;
+
+	for (i = 0; i < count; i += size >> PAGE_WIDTH) {
+		pte = page_mapping_find_size(area->as, page + i*PAGE_SIZE, &size);
+		ASSERT(pte && PTE_VALID(pte) && PTE_PRESENT(pte));
+		if (size == PAGE_SIZE) {
+			if (area->backend && area->backend->frame_free) {
+				area->backend->frame_free(area,
+					page + i*PAGE_SIZE, PTE_GET_FRAME(pte));
+			}
+			page_mapping_remove(area->as, page + i*PAGE_SIZE);
+			continue;
+		}
+
+		/*
+		 * Large mappings are created only by the physical memory
+		 * backend, whose areas cannot be resized. A large page is
+		 * therefore always freed as a whole and its mapping can be
+		 * removed without splitting it, which would need memory.
+		 */
+		ASSERT((page + i*PAGE_SIZE) % size == 0);
+		ASSERT(i + (size >> PAGE_WIDTH) <= count);
+		if (area->backend && area->backend->frame_free) {
+			for (off = 0; off < size; off += PAGE_SIZE) {
+				area->backend->frame_free(area,
+					page + i*PAGE_SIZE + off, PTE_GET_FRAME(pte) + off);
+			}
+		}
+		page_mapping_remove_large(area->as, page + i*PAGE_SIZE, size);
+	}
+}
+
 /** Find address space area and change it.
  *
  * @param as Address space.
@@ -303,84 +422,59 @@ int as_area_resize(as_t *as, __address address, size_t size, int flags)
 	}
 	
 	if (pages < area->pages) {
-		bool cond;
+		btree_pos_t pos, left;
+		bool valid;
 		__address start_free = area->base + pages*PAGE_SIZE;
+		__address end = area->base + area->pages*PAGE_SIZE;
 
 		/*
 		 * Shrinking the area.
 		 * No need to check for overlaps.
 		 */
 
+		/*
+		 * Lock the page tables before the TLB shootdown sequence
+		 * is started. The lock may sleep, which is not allowed
+		 * once the other processors are held in the shootdown.
+		 */
+		page_table_lock(as, false);
+
 		/*
 		 * Start TLB shootdown sequence.
 		 */
-		tlb_shootdown_start(TLB_INVL_PAGES, AS->asid, area->base + pages*PAGE_SIZE, area->pages - pages);
+		tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base + pages*PAGE_SIZE, area->pages - pages);
 
 		/*
-		 * Remove frames belonging to used space starting from
-		 * the highest addresses downwards until an overlap with
-		 * the resized address space area is found. Note that this
-		 * is also the right way to remove part of the used_space
-		 * B+tree leaf list.
-		 */		
-		for (cond = true; cond;) {
-			btree_node_t *node;
-		
-			ASSERT(!list_empty(&area->used_space.leaf_head));
-			node = list_get_instance(area->used_space.leaf_head.prev, btree_node_t, leaf_link);
-			if ((cond = (bool) node->keys)) {
-				__address b = node->key[node->keys - 1];
-				count_t c = (count_t) node->value[node->keys - 1];
-				int i = 0;
-			
-				if (overlaps(b, c*PAGE_SIZE, area->base, pages*PAGE_SIZE)) {
-					
-					if (b + c*PAGE_SIZE <= start_free) {
-						/*
-						 * The whole interval fits completely
-						 * in the resized address space area.
-						 */
-						break;
-					}
-		
-					/*
-					 * Part of the interval corresponding to b and c
-					 * overlaps with the resized address space area.
-					 */
-		
-					cond = false;	/* we are almost done */
-					i = (start_free - b) >> PAGE_WIDTH;
-					if (!used_space_remove(area, start_free, c - i))
-						panic("Could not remove used space.");
-				} else {
-					/*
-					 * The interval of used space can be completely removed.
-					 */
-					if (!used_space_remove(area, b, c))
-						panic("Could not remove used space.\n");
-				}
-			
-				for (; i < c; i++) {
-					pte_t *pte;
-			
-					page_table_lock(as, false);
-					pte = page_mapping_find(as, b + i*PAGE_SIZE);
-					ASSERT(pte && PTE_VALID(pte) && PTE_PRESENT(pte));
-					if (area->backend && area->backend->frame_free) {
-						area->backend->frame_free(area,
-							b + i*PAGE_SIZE, PTE_GET_FRAME(pte));
-					}
-					page_mapping_remove(as, b + i*PAGE_SIZE);
-					page_table_unlock(as, false);
-				}
+		 * Remove frames belonging to used space above the new end
+		 * of the area. Only the interval preceding start_free can
+		 * overlap with the resized address space area. It is cut
+		 * in place. The intervals starting at or above start_free
+		 * are removed from the used_space B+tree in one pass after
+		 * their frames have been freed.
+		 */
+		valid = btree_lower_bound(&area->used_space, start_free, &pos);
+		left = pos;
+		if (btree_pos_prev(&area->used_space, &left)) {
+			__address b = BTREE_POS_KEY(&left);
+			count_t c = (count_t) BTREE_POS_VALUE(&left);
+			count_t i = (start_free - b) >> PAGE_WIDTH;
+
+			if (i < c) {
+				as_area_pages_free(area, start_free, c - i);
+				BTREE_POS_VALUE(&left) = (void *) i;
 			}
 		}
 
+		for (; valid && BTREE_POS_KEY(&pos) < end; valid = btree_pos_next(&area->used_space, &pos))
+			as_area_pages_free(area, BTREE_POS_KEY(&pos), (count_t) BTREE_POS_VALUE(&pos));
+		(void) btree_remove_range(&area->used_space, start_free, end);
+
 		/*
 		 * Finish TLB shootdown sequence.
 		 */
-		tlb_invalidate_pages(AS->asid, area->base + pages*PAGE_SIZE, area->pages - pages);
+		tlb_invalidate_pages(as->asid, area->base + pages*PAGE_SIZE, area->pages - pages);
 		tlb_shootdown_finalize();
+		page_table_unlock(as, false);
 	} else {
 		/*
 		 * Growing the area.
@@ -394,7 +488,10 @@ int as_area_resize(as_t *as, __address address, size_t size, int flags)
 		}
 	} 
 
+	spinlock_lock(&as->area_lock);
 	area->pages = pages;
+	as->area_gen++;
+	spinlock_unlock(&as->area_lock);
 	
 	mutex_unlock(&area->lock);
 	mutex_unlock(&as->lock);
@@ -429,10 +526,16 @@ int as_area_destroy(as_t *as, __address address)
 
 	base = area->base;
 
+	/*
+	 * Lock the page tables before the TLB shootdown sequence
+	 * is started, see as_area_resize().
+	 */
+	page_table_lock(as, false);
+
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	tlb_shootdown_start(TLB_INVL_PAGES, AS->asid, area->base, area->pages);
+	tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base, area->pages);
 
 	/*
 	 * Visit only the pages mapped by used_space B+tree.
@@ -442,30 +545,16 @@ int as_area_destroy(as_t *as, __address address)
 		int i;
 		
 		node = list_get_instance(cur, btree_node_t, leaf_link);
-		for (i = 0; i < node->keys; i++) {
-			__address b = node->key[i];
-			count_t j;
-			pte_t *pte;
-			
-			for (j = 0; j < (count_t) node->value[i]; j++) {
-				page_table_lock(as, false);
-				pte = page_mapping_find(as, b + j*PAGE_SIZE);
-				ASSERT(pte && PTE_VALID(pte) && PTE_PRESENT(pte));
-				if (area->backend && area->backend->frame_free) {
-					area->backend->frame_free(area,
-						b + j*PAGE_SIZE, PTE_GET_FRAME(pte));
-				}
-				page_mapping_remove(as, b + j*PAGE_SIZE);
-				page_table_unlock(as, false);
-			}
-		}
+		for (i = 0; i < node->keys; i++)
+			as_area_pages_free(area, node->key[i], (count_t) node->value[i]);
 	}
 
 	/*
 	 * Finish TLB shootdown sequence.
 	 */
-	tlb_invalidate_pages(AS->asid, area->base, area->pages);
+	tlb_invalidate_pages(as->asid, area->base, area->pages);
 	tlb_shootdown_finalize();
+	page_table_unlock(as, false);
 	
 	btree_destroy(&area->used_space);
 
@@ -478,12 +567,17 @@ int as_area_destroy(as_t *as, __address address)
 
 	/*
 	 * Remove the empty area from address space.
+	 * The area itself is deallocated as soon as the
+	 * page faults that still reference it are done.
 	 */
-	btree_remove(&AS->as_area_btree, base, NULL);
+	spinlock_lock(&as->area_lock);
+	btree_remove(&as->as_area_btree, base, NULL);
+	as->area_gen++;
+	spinlock_unlock(&as->area_lock);
 	
-	free(area);
+	area_remove_reference(area);
 	
-	mutex_unlock(&AS->lock);
+	mutex_unlock(&as->lock);
 	interrupts_restore(ipl);
 	return 0;
 }
@@ -648,6 +742,13 @@ bool as_area_check_access(as_area_t *area, pf_access_t access)
  * and if so, it invokes the backend to resolve the page
  * fault.
  *
+ * The address space mutex is not taken. The faulting area
+ * is looked up under the address space area spinlock and
+ * referenced so that it cannot be deallocated. Only the area
+ * mutex and the page table lock are held while the fault is
+ * being resolved. Page faults in different areas of the same
+ * address space can therefore proceed in parallel.
+ *
  * Interrupts are assumed disabled.
  *
  * @param page Faulting page.
@@ -667,44 +768,54 @@ int as_page_fault(__address page, pf_access_t access, istate_t *istate)
 		
 	ASSERT(AS);
 
-	mutex_lock(&AS->lock);
-	area = find_area_and_lock(AS, page);	
+	area = find_area_and_reference(AS, page);
 	if (!area) {
 		/*
 		 * No area contained mapping for 'page'.
 		 * Signal page fault to low-level handler.
 		 */
-		mutex_unlock(&AS->lock);
 		goto page_fault;
 	}
 
+	mutex_lock(&area->lock);
+
 	if (area->attributes & AS_AREA_ATTR_PARTIAL) {
 		/*
-		 * The address space area is not fully initialized.
+		 * The address space area is not fully initialized
+		 * or it is being destroyed.
 		 * Avoid possible race by returning error.
 		 */
 		mutex_unlock(&area->lock);
-		mutex_unlock(&AS->lock);
+		area_remove_reference(area);
 		goto page_fault;		
 	}
 
+	if (page >= area->base + area->pages * PAGE_SIZE) {
+		/*
+		 * The area has been shrunk in the meantime.
+		 */
+		mutex_unlock(&area->lock);
+		area_remove_reference(area);
+		goto page_fault;
+	}
+
 	if (!area->backend || !area->backend->page_fault) {
 		/*
 		 * The address space area is not backed by any backend
 		 * or the backend cannot handle page faults.
 		 */
 		mutex_unlock(&area->lock);
-		mutex_unlock(&AS->lock);
+		area_remove_reference(area);
 		goto page_fault;		
 	}
 
-	page_table_lock(AS, false);
-	
 	/*
 	 * To avoid race condition between two page faults
 	 * on the same address, we need to make sure
 	 * the mapping has not been already inserted.
+	 * Such page faults are serialized by the area mutex.
 	 */
+	page_table_lock(AS, false);
 	if ((pte = page_mapping_find(AS, page))) {
 		if (PTE_PRESENT(pte)) {
 			if (((access == PF_ACCESS_READ) && PTE_READABLE(pte)) ||
@@ -712,25 +823,26 @@ int as_page_fault(__address page, pf_access_t access, istate_t *istate)
 				(access == PF_ACCESS_EXEC && PTE_EXECUTABLE(pte))) {
 				page_table_unlock(AS, false);
 				mutex_unlock(&area->lock);
-				mutex_unlock(&AS->lock);
+				area_remove_reference(area);
 				return AS_PF_OK;
 			}
 		}
 	}
+	page_table_unlock(AS, false);
 	
 	/*
 	 * Resort to the backend page fault handler.
+	 * The backend locks the page tables only for the
+	 * time needed to insert the new mapping.
 	 */
 	if (area->backend->page_fault(area, page, access) != AS_PF_OK) {
-		page_table_unlock(AS, false);
 		mutex_unlock(&area->lock);
-		mutex_unlock(&AS->lock);
+		area_remove_reference(area);
 		goto page_fault;
 	}
 	
-	page_table_unlock(AS, false);
 	mutex_unlock(&area->lock);
-	mutex_unlock(&AS->lock);
+	area_remove_reference(area);
 	return AS_PF_OK;
 
 page_fault:
@@ -752,73 +864,80 @@ page_fault:
  * Note that this function cannot sleep as it is essentially a part of
  * scheduling. Sleeping here would lead to deadlock on wakeup.
  *
+ * In the common case, when the new address space already has an ASID,
+ * no lock is taken. The number of processors using each address space
+ * is maintained atomically and the list of address spaces with ASID
+ * is consulted only when an ASID needs to be stolen.
+ *
  * @param old Old address space or NULL.
  * @param new New address space.
  */
 void as_switch(as_t *old, as_t *new)
 {
 	ipl_t ipl;
-	bool needs_asid = false;
+	bool steal;
 	
 	ipl = interrupts_disable();
-	spinlock_lock(&inactive_as_with_asid_lock);
 
 	/*
-	 * First, take care of the old address space.
-	 */	
-	if (old) {
-		mutex_lock_active(&old->lock);
-		ASSERT(old->cpu_refcount);
-		if((--old->cpu_refcount == 0) && (old != AS_KERNEL)) {
-			/*
-			 * The old address space is no longer active on
-			 * any processor. It can be appended to the
-			 * list of inactive address spaces with assigned
-			 * ASID.
-			 */
-			 ASSERT(old->asid != ASID_INVALID);
-			 list_append(&old->inactive_as_with_asid_link, &inactive_as_with_asid_head);
-		}
-		mutex_unlock(&old->lock);
-	}
-
-	/*
-	 * Second, prepare the new address space.
+	 * First, mark the new address space active on this processor.
+	 * The increment must be visible before asid_steal and asid are
+	 * examined. asid_get() announces its intent to steal the ASID
+	 * in the reverse order and so the two cannot miss each other.
 	 */
-	mutex_lock_active(&new->lock);
-	if ((new->cpu_refcount++ == 0) && (new != AS_KERNEL)) {
-		if (new->asid != ASID_INVALID)
-			list_remove(&new->inactive_as_with_asid_link);
-		else
-			needs_asid = true;	/* defer call to asid_get() until new->lock is released */
-	}
-	SET_PTL0_ADDRESS(new->page_table);
-	mutex_unlock(&new->lock);
+	atomic_inc(&new->cpu_refcount);
+	memory_barrier();
+	steal = new->asid_steal;
+	read_barrier();
+	if (steal || new->asid == ASID_INVALID)
+		as_asid_assign(new);
 
-	if (needs_asid) {
-		/*
-		 * Allocation of new ASID was deferred
-		 * until now in order to avoid deadlock.
-		 */
-		asid_t asid;
-		
-		asid = asid_get();
-		mutex_lock_active(&new->lock);
-		new->asid = asid;
-		mutex_unlock(&new->lock);
-	}
-	spinlock_unlock(&inactive_as_with_asid_lock);
-	interrupts_restore(ipl);
+	SET_PTL0_ADDRESS(new->page_table);
 	
 	/*
 	 * Perform architecture-specific steps.
 	 * (e.g. write ASID to hardware register etc.)
 	 */
 	as_install_arch(new);
+
+	/*
+	 * Second, release the old address space. This is done only now that
+	 * it is no longer installed on this processor, as its ASID can be
+	 * stolen as soon as cpu_refcount drops to zero.
+	 */
+	if (old) {
+		ASSERT(atomic_get(&old->cpu_refcount) > 0);
+		atomic_dec(&old->cpu_refcount);
+	}
+
+	interrupts_restore(ipl);
 	
 	AS = new;
 }
 
+/** Assign ASID to address space being switched to.
+ *
+ * This is the slow path of as_switch(). It is taken when the address space
+ * has no ASID or when asid_get() is just considering stealing it.
+ * Interrupts must be disabled and the caller must have already
+ * accounted for the address space in its cpu_refcount.
+ *
+ * @param as Address space.
+ */
+void as_asid_assign(as_t *as)
+{
+	spinlock_lock(&as_with_asid_lock);
+	/*
+	 * If the ASID was being stolen, asid_get() has given up
+	 * by now because cpu_refcount of the address space is non-zero.
+	 */
+	if (as->asid == ASID_INVALID) {
+		as->asid = asid_get();
+		list_append(&as->as_with_asid_link, &as_with_asid_head);
+	}
+	spinlock_unlock(&as_with_asid_lock);
+}
+
 /** Convert address space area flags to page flags.
  *
  * @param aflags Flags of some address space area.
@@ -937,48 +1056,161 @@ void page_table_unlock(as_t *as, bool unlock)
 as_area_t *find_area_and_lock(as_t *as, __address va)
 {
 	as_area_t *a;
-	btree_node_t *leaf, *lnode;
-	int i;
+	btree_pos_t pos;
 	
-	a = (as_area_t *) btree_search(&as->as_area_btree, va, &leaf);
-	if (a) {
-		/* va is the base address of an address space area */
+	if ((a = area_cache_lookup(as, va))) {
 		mutex_lock(&a->lock);
 		return a;
 	}
 	
 	/*
-	 * Search the leaf node and the righmost record of its left neighbour
-	 * to find out whether this is a miss or va belongs to an address
-	 * space area found there.
+	 * The areas do not overlap, so va can only belong to the area
+	 * with the greatest base address not greater than va. It is the
+	 * predecessor of the first area with base address greater than va.
 	 */
-	
-	/* First, search the leaf node itself. */
-	for (i = 0; i < leaf->keys; i++) {
-		a = (as_area_t *) leaf->value[i];
+	(void) btree_upper_bound(&as->as_area_btree, va, &pos);
+	if (btree_pos_prev(&as->as_area_btree, &pos)) {
+		a = (as_area_t *) BTREE_POS_VALUE(&pos);
 		mutex_lock(&a->lock);
-		if ((a->base <= va) && (va < a->base + a->pages * PAGE_SIZE)) {
+		if (va < a->base + a->pages * PAGE_SIZE) {
+			area_cache_update(as, a);
 			return a;
 		}
 		mutex_unlock(&a->lock);
 	}
 
-	/*
-	 * Second, locate the left neighbour and test its last record.
-	 * Because of its position in the B+tree, it must have base < va.
-	 */
-	if ((lnode = btree_leaf_node_left_neighbour(&as->as_area_btree, leaf))) {
-		a = (as_area_t *) lnode->value[lnode->keys - 1];
-		mutex_lock(&a->lock);
-		if (va < a->base + a->pages * PAGE_SIZE) {
-			return a;
-		}
-		mutex_unlock(&a->lock);
+	return NULL;
+}
+
+/** Find address space area and add reference to it.
+ *
+ * Unlike find_area_and_lock(), the address space mutex need not be held.
+ * The B+tree of address space areas is searched under the address space
+ * area spinlock which also protects the base and size of the areas for
+ * the purpose of this lookup. The area is returned unlocked and the caller
+ * must recheck its attributes and size after it locks the area mutex.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param as Address space.
+ * @param va Virtual address.
+ *
+ * @return Referenced address space area containing va on success or NULL on failure.
+ */
+as_area_t *find_area_and_reference(as_t *as, __address va)
+{
+	as_area_t *a;
+	btree_pos_t pos;
+
+	spinlock_lock(&as->area_lock);
+
+	if ((a = area_cache_lookup(as, va)))
+		goto hit;
+
+	/* See find_area_and_lock(). */
+	(void) btree_upper_bound(&as->as_area_btree, va, &pos);
+	if (btree_pos_prev(&as->as_area_btree, &pos)) {
+		a = (as_area_t *) BTREE_POS_VALUE(&pos);
+		if (va < a->base + a->pages * PAGE_SIZE)
+			goto found;
+	}
+
+	spinlock_unlock(&as->area_lock);
+	return NULL;
+
+found:
+	area_cache_update(as, a);
+hit:
+	a->refcount++;
+	spinlock_unlock(&as->area_lock);
+	return a;
+}
+
+/** Remove reference to address space area.
+ *
+ * If the reference count drops to 0, the area is deallocated.
+ * The area must be unlocked and already removed from the B+tree
+ * of its address space when the last reference is dropped.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param a Address space area.
+ */
+void area_remove_reference(as_area_t *a)
+{
+	bool dealloc;
+
+	spinlock_lock(&a->as->area_lock);
+	ASSERT(a->refcount);
+	dealloc = (--a->refcount == 0);
+	spinlock_unlock(&a->as->area_lock);
+
+	if (dealloc)
+		free(a);
+}
+
+/** Look up address in the address space area cache of the current thread.
+ *
+ * The cached area is valid only if no address space area has been
+ * created, resized or destroyed since the cache was filled in.
+ * Either the address space mutex or the address space area spinlock
+ * must be held and interrupts must be disabled.
+ *
+ * @param as Address space.
+ * @param va Virtual address.
+ *
+ * @return Cached address space area containing va or NULL on cache miss.
+ */
+as_area_t *area_cache_lookup(as_t *as, __address va)
+{
+	as_area_t *a;
+
+	if (!THREAD || (as != AS))
+		return NULL;
+
+	a = THREAD->area_cache;
+	if (a && (THREAD->area_cache_gen == as->area_gen) &&
+	    (a->base <= va) && (va < a->base + a->pages * PAGE_SIZE)) {
+		CPU->area_cache_hits++;
+		return a;
 	}
 
+	CPU->area_cache_misses++;
 	return NULL;
 }
 
+/** Remember address space area in the area cache of the current thread.
+ *
+ * The same locking rules as for area_cache_lookup() apply.
+ *
+ * @param as Address space.
+ * @param a Address space area that has been found.
+ */
+void area_cache_update(as_t *as, as_area_t *a)
+{
+	if (!THREAD || (as != AS))
+		return;
+
+	THREAD->area_cache = a;
+	THREAD->area_cache_gen = as->area_gen;
+}
+
+/** Sysinfo function returning the number of area cache hits or misses. */
+__native as_area_cache_sysinfo(sysinfo_item_t *item)
+{
+	bool hits = (item->name[0] == 'h');
+	__native sum = 0;
+	int i;
+
+	if (!cpus)
+		return 0;
+
+	for (i = 0; i < config.cpu_count; i++)
+		sum += hits ? cpus[i].area_cache_hits : cpus[i].area_cache_misses;
+
+	return sum;
+}
+
 /** Check area conflicts with other areas.
  *
  * The address space must be locked and interrupts must be disabled.
@@ -993,8 +1225,8 @@ as_area_t *find_area_and_lock(as_t *as, __address va)
 bool check_area_conflicts(as_t *as, __address va, size_t size, as_area_t *avoid_area)
 {
 	as_area_t *a;
-	btree_node_t *leaf, *node;
-	int i;
+	btree_pos_t pos, left;
+	bool valid, conflict;
 	
 	/*
 	 * We don't want any area to have conflicts with NULL page.
@@ -1003,51 +1235,40 @@ bool check_area_conflicts(as_t *as, __address va, size_t size, as_area_t *avoid_
 		return false;
 	
 	/*
-	 * The leaf node is found in O(log n), where n is proportional to
-	 * the number of address space areas belonging to as.
-	 * The check for conflicts is then attempted on the rightmost
-	 * record in the left neighbour, the leftmost record in the right
-	 * neighbour and all records in the leaf node itself.
+	 * The position of va is found in O(log n), where n is proportional
+	 * to the number of address space areas belonging to as. Because the
+	 * areas do not overlap, only the area preceding va and the first
+	 * area starting at or above va, not counting avoid_area, need to be
+	 * checked for conflicts.
 	 */
-	
-	if ((a = (as_area_t *) btree_search(&as->as_area_btree, va, &leaf))) {
-		if (a != avoid_area)
-			return false;
-	}
-	
-	/* First, check the two border cases. */
-	if ((node = btree_leaf_node_left_neighbour(&as->as_area_btree, leaf))) {
-		a = (as_area_t *) node->value[node->keys - 1];
-		mutex_lock(&a->lock);
-		if (overlaps(va, size, a->base, a->pages * PAGE_SIZE)) {
-			mutex_unlock(&a->lock);
-			return false;
-		}
-		mutex_unlock(&a->lock);
-	}
-	if ((node = btree_leaf_node_right_neighbour(&as->as_area_btree, leaf))) {
-		a = (as_area_t *) node->value[0];
-		mutex_lock(&a->lock);
-		if (overlaps(va, size, a->base, a->pages * PAGE_SIZE)) {
+	valid = btree_lower_bound(&as->as_area_btree, va, &pos);
+
+	/* First, check the area preceding va. */
+	left = pos;
+	if (btree_pos_prev(&as->as_area_btree, &left)) {
+		a = (as_area_t *) BTREE_POS_VALUE(&left);
+		if (a != avoid_area) {
+			mutex_lock(&a->lock);
+			conflict = overlaps(va, size, a->base, a->pages * PAGE_SIZE);
 			mutex_unlock(&a->lock);
-			return false;
+			if (conflict)
+				return false;
 		}
-		mutex_unlock(&a->lock);
 	}
-	
-	/* Second, check the leaf node. */
-	for (i = 0; i < leaf->keys; i++) {
-		a = (as_area_t *) leaf->value[i];
+
+	/* Second, check the first area following va. */
+	for (; valid; valid = btree_pos_next(&as->as_area_btree, &pos)) {
+		a = (as_area_t *) BTREE_POS_VALUE(&pos);
 	
 		if (a == avoid_area)
 			continue;
 	
 		mutex_lock(&a->lock);
-		if (overlaps(va, size, a->base, a->pages * PAGE_SIZE)) {
-			mutex_unlock(&a->lock);
-			return false;
-		}
+		conflict = overlaps(va, size, a->base, a->pages * PAGE_SIZE);
 		mutex_unlock(&a->lock);
+		if (conflict)
+			return false;
+		break;
 	}
 
 	/*
@@ -1093,219 +1314,64 @@ size_t as_get_size(__address base)
  */
 int used_space_insert(as_area_t *a, __address page, count_t count)
 {
-	btree_node_t *leaf, *node;
-	count_t pages;
-	int i;
+	btree_pos_t pos, left;
+	bool right_valid, left_valid;
+	bool merge_left = false, merge_right = false;
+	__address left_pg = 0, right_pg = 0;
+	count_t left_cnt = 0, right_cnt = 0;
 
 	ASSERT(page == ALIGN_DOWN(page, PAGE_SIZE));
 	ASSERT(count);
 
-	pages = (count_t) btree_search(&a->used_space, page, &leaf);
-	if (pages) {
-		/*
-		 * We hit the beginning of some used space.
-		 */
-		return 0;
-	}
-
-	if (!leaf->keys) {
-		btree_insert(&a->used_space, page, (void *) count, leaf);
-		return 1;
+	/*
+	 * Only the last interval starting below page and the first
+	 * interval starting at or above page can overlap with the
+	 * inserted interval or be merged with it.
+	 */
+	right_valid = btree_lower_bound(&a->used_space, page, &pos);
+	left = pos;
+	left_valid = btree_pos_prev(&a->used_space, &left);
+
+	if (left_valid) {
+		left_pg = BTREE_POS_KEY(&left);
+		left_cnt = (count_t) BTREE_POS_VALUE(&left);
+		if (overlaps(left_pg, left_cnt*PAGE_SIZE, page, count*PAGE_SIZE))
+			return 0;
+		merge_left = (left_pg + left_cnt*PAGE_SIZE == page);
 	}
 
-	node = btree_leaf_node_left_neighbour(&a->used_space, leaf);
-	if (node) {
-		__address left_pg = node->key[node->keys - 1], right_pg = leaf->key[0];
-		count_t left_cnt = (count_t) node->value[node->keys - 1], right_cnt = (count_t) leaf->value[0];
-		
-		/*
-		 * Examine the possibility that the interval fits
-		 * somewhere between the rightmost interval of
-		 * the left neigbour and the first interval of the leaf.
-		 */
-		 
-		if (page >= right_pg) {
-			/* Do nothing. */
-		} else if (overlaps(page, count*PAGE_SIZE, left_pg, left_cnt*PAGE_SIZE)) {
-			/* The interval intersects with the left interval. */
-			return 0;
-		} else if (overlaps(page, count*PAGE_SIZE, right_pg, right_cnt*PAGE_SIZE)) {
-			/* The interval intersects with the right interval. */
-			return 0;			
-		} else if ((page == left_pg + left_cnt*PAGE_SIZE) && (page + count*PAGE_SIZE == right_pg)) {
-			/* The interval can be added by merging the two already present intervals. */
-			node->value[node->keys - 1] += count + right_cnt;
-			btree_remove(&a->used_space, right_pg, leaf);
-			return 1; 
-		} else if (page == left_pg + left_cnt*PAGE_SIZE) {
-			/* The interval can be added by simply growing the left interval. */
-			node->value[node->keys - 1] += count;
-			return 1;
-		} else if (page + count*PAGE_SIZE == right_pg) {
-			/*
-			 * The interval can be addded by simply moving base of the right
-			 * interval down and increasing its size accordingly.
-			 */
-			leaf->value[0] += count;
-			leaf->key[0] = page;
-			return 1;
-		} else {
-			/*
-			 * The interval is between both neigbouring intervals,
-			 * but cannot be merged with any of them.
-			 */
-			btree_insert(&a->used_space, page, (void *) count, leaf);
-			return 1;
-		}
-	} else if (page < leaf->key[0]) {
-		__address right_pg = leaf->key[0];
-		count_t right_cnt = (count_t) leaf->value[0];
-	
-		/*
-		 * Investigate the border case in which the left neighbour does not
-		 * exist but the interval fits from the left.
-		 */
-		 
-		if (overlaps(page, count*PAGE_SIZE, right_pg, right_cnt*PAGE_SIZE)) {
-			/* The interval intersects with the right interval. */
+	if (right_valid) {
+		right_pg = BTREE_POS_KEY(&pos);
+		right_cnt = (count_t) BTREE_POS_VALUE(&pos);
+		if (overlaps(page, count*PAGE_SIZE, right_pg, right_cnt*PAGE_SIZE))
 			return 0;
-		} else if (page + count*PAGE_SIZE == right_pg) {
-			/*
-			 * The interval can be added by moving the base of the right interval down
-			 * and increasing its size accordingly.
-			 */
-			leaf->key[0] = page;
-			leaf->value[0] += count;
-			return 1;
-		} else {
-			/*
-			 * The interval doesn't adjoin with the right interval.
-			 * It must be added individually.
-			 */
-			btree_insert(&a->used_space, page, (void *) count, leaf);
-			return 1;
-		}
+		merge_right = (page + count*PAGE_SIZE == right_pg);
 	}
 
-	node = btree_leaf_node_right_neighbour(&a->used_space, leaf);
-	if (node) {
-		__address left_pg = leaf->key[leaf->keys - 1], right_pg = node->key[0];
-		count_t left_cnt = (count_t) leaf->value[leaf->keys - 1], right_cnt = (count_t) node->value[0];
-		
+	if (merge_left && merge_right) {
 		/*
-		 * Examine the possibility that the interval fits
-		 * somewhere between the leftmost interval of
-		 * the right neigbour and the last interval of the leaf.
+		 * The interval fills the gap between its neighbours.
+		 * Extend the left one over it and over the right one.
 		 */
-
-		if (page < left_pg) {
-			/* Do nothing. */
-		} else if (overlaps(page, count*PAGE_SIZE, left_pg, left_cnt*PAGE_SIZE)) {
-			/* The interval intersects with the left interval. */
-			return 0;
-		} else if (overlaps(page, count*PAGE_SIZE, right_pg, right_cnt*PAGE_SIZE)) {
-			/* The interval intersects with the right interval. */
-			return 0;			
-		} else if ((page == left_pg + left_cnt*PAGE_SIZE) && (page + count*PAGE_SIZE == right_pg)) {
-			/* The interval can be added by merging the two already present intervals. */
-			leaf->value[leaf->keys - 1] += count + right_cnt;
-			btree_remove(&a->used_space, right_pg, node);
-			return 1; 
-		} else if (page == left_pg + left_cnt*PAGE_SIZE) {
-			/* The interval can be added by simply growing the left interval. */
-			leaf->value[leaf->keys - 1] +=  count;
-			return 1;
-		} else if (page + count*PAGE_SIZE == right_pg) {
-			/*
-			 * The interval can be addded by simply moving base of the right
-			 * interval down and increasing its size accordingly.
-			 */
-			node->value[0] += count;
-			node->key[0] = page;
-			return 1;
-		} else {
-			/*
-			 * The interval is between both neigbouring intervals,
-			 * but cannot be merged with any of them.
-			 */
-			btree_insert(&a->used_space, page, (void *) count, leaf);
-			return 1;
-		}
-	} else if (page >= leaf->key[leaf->keys - 1]) {
-		__address left_pg = leaf->key[leaf->keys - 1];
-		count_t left_cnt = (count_t) leaf->value[leaf->keys - 1];
-	
+		BTREE_POS_VALUE(&left) = (void *) (left_cnt + count + right_cnt);
+		btree_remove(&a->used_space, right_pg, pos.leaf);
+	} else if (merge_left) {
+		/* The interval can be simply appended to the left neighbour. */
+		BTREE_POS_VALUE(&left) = (void *) (left_cnt + count);
+	} else if (merge_right) {
 		/*
-		 * Investigate the border case in which the right neighbour does not
-		 * exist but the interval fits from the right.
+		 * The interval can be prepended to the right neighbour.
+		 * Its key is not changed in place because the old key
+		 * may be used as a separator in the index nodes.
 		 */
-		 
-		if (overlaps(page, count*PAGE_SIZE, left_pg, left_cnt*PAGE_SIZE)) {
-			/* The interval intersects with the left interval. */
-			return 0;
-		} else if (left_pg + left_cnt*PAGE_SIZE == page) {
-			/* The interval can be added by growing the left interval. */
-			leaf->value[leaf->keys - 1] += count;
-			return 1;
-		} else {
-			/*
-			 * The interval doesn't adjoin with the left interval.
-			 * It must be added individually.
-			 */
-			btree_insert(&a->used_space, page, (void *) count, leaf);
-			return 1;
-		}
-	}
-	
-	/*
-	 * Note that if the algorithm made it thus far, the interval can fit only
-	 * between two other intervals of the leaf. The two border cases were already
-	 * resolved.
-	 */
-	for (i = 1; i < leaf->keys; i++) {
-		if (page < leaf->key[i]) {
-			__address left_pg = leaf->key[i - 1], right_pg = leaf->key[i];
-			count_t left_cnt = (count_t) leaf->value[i - 1], right_cnt = (count_t) leaf->value[i];
-
-			/*
-			 * The interval fits between left_pg and right_pg.
-			 */
-
-			if (overlaps(page, count*PAGE_SIZE, left_pg, left_cnt*PAGE_SIZE)) {
-				/* The interval intersects with the left interval. */
-				return 0;
-			} else if (overlaps(page, count*PAGE_SIZE, right_pg, right_cnt*PAGE_SIZE)) {
-				/* The interval intersects with the right interval. */
-				return 0;			
-			} else if ((page == left_pg + left_cnt*PAGE_SIZE) && (page + count*PAGE_SIZE == right_pg)) {
-				/* The interval can be added by merging the two already present intervals. */
-				leaf->value[i - 1] += count + right_cnt;
-				btree_remove(&a->used_space, right_pg, leaf);
-				return 1; 
-			} else if (page == left_pg + left_cnt*PAGE_SIZE) {
-				/* The interval can be added by simply growing the left interval. */
-				leaf->value[i - 1] += count;
-				return 1;
-			} else if (page + count*PAGE_SIZE == right_pg) {
-				/*
-			         * The interval can be addded by simply moving base of the right
-			 	 * interval down and increasing its size accordingly.
-			 	 */
-				leaf->value[i] += count;
-				leaf->key[i] = page;
-				return 1;
-			} else {
-				/*
-				 * The interval is between both neigbouring intervals,
-				 * but cannot be merged with any of them.
-				 */
-				btree_insert(&a->used_space, page, (void *) count, leaf);
-				return 1;
-			}
-		}
+		btree_remove(&a->used_space, right_pg, pos.leaf);
+		btree_insert(&a->used_space, page, (void *) (count + right_cnt), NULL);
+	} else {
+		/* The interval is not adjacent to any other interval. */
+		btree_insert(&a->used_space, page, (void *) count, NULL);
 	}
 
-	panic("Inconsistency detected while adding %d pages of used space at %P.\n", count, page);
+	return 1;
 }
 
 /** Mark portion of address space area as unused.
@@ -1320,146 +1386,50 @@ int used_space_insert(as_area_t *a, __address page, count_t count)
  */
 int used_space_remove(as_area_t *a, __address page, count_t count)
 {
-	btree_node_t *leaf, *node;
-	count_t pages;
-	int i;
+	btree_pos_t pos;
+	__address pg;
+	count_t cnt, new_cnt;
 
 	ASSERT(page == ALIGN_DOWN(page, PAGE_SIZE));
 	ASSERT(count);
 
-	pages = (count_t) btree_search(&a->used_space, page, &leaf);
-	if (pages) {
+	/*
+	 * The removed interval must be contained in the last interval
+	 * starting at or below page.
+	 */
+	(void) btree_upper_bound(&a->used_space, page, &pos);
+	if (!btree_pos_prev(&a->used_space, &pos))
+		return 0;
+
+	pg = BTREE_POS_KEY(&pos);
+	cnt = (count_t) BTREE_POS_VALUE(&pos);
+	if (page + count*PAGE_SIZE > pg + cnt*PAGE_SIZE)
+		return 0;
+
+	new_cnt = ((pg + cnt*PAGE_SIZE) - (page + count*PAGE_SIZE)) >> PAGE_WIDTH;
+
+	if (pg == page) {
 		/*
-		 * We are lucky, page is the beginning of some interval.
+		 * The beginning of the interval is removed. The rest of it,
+		 * if any, is reinserted rather than relocated in place
+		 * because the old key may be used as a separator in the
+		 * index nodes.
 		 */
-		if (count > pages) {
-			return 0;
-		} else if (count == pages) {
-			btree_remove(&a->used_space, page, leaf);
-			return 1;
-		} else {
-			/*
-			 * Find the respective interval.
-			 * Decrease its size and relocate its start address.
-			 */
-			for (i = 0; i < leaf->keys; i++) {
-				if (leaf->key[i] == page) {
-					leaf->key[i] += count*PAGE_SIZE;
-					leaf->value[i] -= count;
-					return 1;
-				}
-			}
-			goto error;
-		}
+		btree_remove(&a->used_space, pg, pos.leaf);
+		if (new_cnt)
+			btree_insert(&a->used_space, page + count*PAGE_SIZE, (void *) new_cnt, NULL);
+		return 1;
 	}
 
-	node = btree_leaf_node_left_neighbour(&a->used_space, leaf);
-	if (node && page < leaf->key[0]) {
-		__address left_pg = node->key[node->keys - 1];
-		count_t left_cnt = (count_t) node->value[node->keys - 1];
-
-		if (overlaps(left_pg, left_cnt*PAGE_SIZE, page, count*PAGE_SIZE)) {
-			if (page + count*PAGE_SIZE == left_pg + left_cnt*PAGE_SIZE) {
-				/*
-				 * The interval is contained in the rightmost interval
-				 * of the left neighbour and can be removed by
-				 * updating the size of the bigger interval.
-				 */
-				node->value[node->keys - 1] -= count;
-				return 1;
-			} else if (page + count*PAGE_SIZE < left_pg + left_cnt*PAGE_SIZE) {
-				count_t new_cnt;
-				
-				/*
-				 * The interval is contained in the rightmost interval
-				 * of the left neighbour but its removal requires
-				 * both updating the size of the original interval and
-				 * also inserting a new interval.
-				 */
-				new_cnt = ((left_pg + left_cnt*PAGE_SIZE) - (page + count*PAGE_SIZE)) >> PAGE_WIDTH;
-				node->value[node->keys - 1] -= count + new_cnt;
-				btree_insert(&a->used_space, page + count*PAGE_SIZE, (void *) new_cnt, leaf);
-				return 1;
-			}
-		}
-		return 0;
-	} else if (page < leaf->key[0]) {
-		return 0;
-	}
-	
-	if (page > leaf->key[leaf->keys - 1]) {
-		__address left_pg = leaf->key[leaf->keys - 1];
-		count_t left_cnt = (count_t) leaf->value[leaf->keys - 1];
-
-		if (overlaps(left_pg, left_cnt*PAGE_SIZE, page, count*PAGE_SIZE)) {
-			if (page + count*PAGE_SIZE == left_pg + left_cnt*PAGE_SIZE) {
-				/*
-				 * The interval is contained in the rightmost interval
-				 * of the leaf and can be removed by updating the size
-				 * of the bigger interval.
-				 */
-				leaf->value[leaf->keys - 1] -= count;
-				return 1;
-			} else if (page + count*PAGE_SIZE < left_pg + left_cnt*PAGE_SIZE) {
-				count_t new_cnt;
-				
-				/*
-				 * The interval is contained in the rightmost interval
-				 * of the leaf but its removal requires both updating
-				 * the size of the original interval and
-				 * also inserting a new interval.
-				 */
-				new_cnt = ((left_pg + left_cnt*PAGE_SIZE) - (page + count*PAGE_SIZE)) >> PAGE_WIDTH;
-				leaf->value[leaf->keys - 1] -= count + new_cnt;
-				btree_insert(&a->used_space, page + count*PAGE_SIZE, (void *) new_cnt, leaf);
-				return 1;
-			}
-		}
-		return 0;
-	}	
-	
 	/*
-	 * The border cases have been already resolved.
-	 * Now the interval can be only between intervals of the leaf. 
+	 * Shorten the interval and, if the removed pages
+	 * are in its middle, insert the rest of it.
 	 */
-	for (i = 1; i < leaf->keys - 1; i++) {
-		if (page < leaf->key[i]) {
-			__address left_pg = leaf->key[i - 1];
-			count_t left_cnt = (count_t) leaf->value[i - 1];
-
-			/*
-			 * Now the interval is between intervals corresponding to (i - 1) and i.
-			 */
-			if (overlaps(left_pg, left_cnt*PAGE_SIZE, page, count*PAGE_SIZE)) {
-				if (page + count*PAGE_SIZE == left_pg + left_cnt*PAGE_SIZE) {
-					/*
-				 	* The interval is contained in the interval (i - 1)
-					 * of the leaf and can be removed by updating the size
-					 * of the bigger interval.
-					 */
-					leaf->value[i - 1] -= count;
-					return 1;
-				} else if (page + count*PAGE_SIZE < left_pg + left_cnt*PAGE_SIZE) {
-					count_t new_cnt;
-				
-					/*
-					 * The interval is contained in the interval (i - 1)
-					 * of the leaf but its removal requires both updating
-					 * the size of the original interval and
-					 * also inserting a new interval.
-					 */
-					new_cnt = ((left_pg + left_cnt*PAGE_SIZE) - (page + count*PAGE_SIZE)) >> PAGE_WIDTH;
-					leaf->value[i - 1] -= count + new_cnt;
-					btree_insert(&a->used_space, page + count*PAGE_SIZE, (void *) new_cnt, leaf);
-					return 1;
-				}
-			}
-			return 0;
-		}
-	}
+	BTREE_POS_VALUE(&pos) = (void *) ((page - pg) >> PAGE_WIDTH);
+	if (new_cnt)
+		btree_insert(&a->used_space, page + count*PAGE_SIZE, (void *) new_cnt, NULL);
 
-error:
-	panic("Inconsistency detected while removing %d pages of used space from %P.\n", count, page);
+	return 1;
 }
 
 /** Remove reference to address space area share info.
@@ -50,6 +50,7 @@
 static int anon_page_fault(as_area_t *area, __address addr, pf_access_t access);
 static void anon_frame_free(as_area_t *area, __address page, __address frame);
 static void anon_share(as_area_t *area);
+static count_t anon_fault_around(as_area_t *area, __address page);
 
 mem_backend_t anon_backend = {
 	.page_fault = anon_page_fault,
@@ -59,7 +60,8 @@ mem_backend_t anon_backend = {
 
 /** Service a page fault in the anonymous memory address space area.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked.
+ * Page tables are locked only for the time of the mapping insertion.
  *
  * @param area Pointer to the address space area.
  * @param addr Faulting virtual address.
@@ -70,6 +72,7 @@ mem_backend_t anon_backend = {
 int anon_page_fault(as_area_t *area, __address addr, pf_access_t access)
 {
 	__address frame;
+	count_t count = 1;
 
 	if (!as_area_check_access(area, access))
 		return AS_PF_FAULT;
@@ -101,7 +104,7 @@ int anon_page_fault(as_area_t *area, __address addr, pf_access_t access)
 				}
 			}
 			if (allocate) {
-				frame = PFN2ADDR(frame_alloc(ONE_FRAME, 0));
+				frame = PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_MOVABLE));
 				memsetb(PA2KA(frame), FRAME_SIZE, 0);
 				
 				/*
@@ -128,7 +131,7 @@ int anon_page_fault(as_area_t *area, __address addr, pf_access_t access)
 		 *   do not forget to distinguish between
 		 *   the different causes
 		 */
-		frame = PFN2ADDR(frame_alloc(ONE_FRAME, 0));
+		frame = PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_MOVABLE));
 		memsetb(PA2KA(frame), FRAME_SIZE, 0);
 	}
 	
@@ -137,13 +140,67 @@ int anon_page_fault(as_area_t *area, __address addr, pf_access_t access)
 	 * Note that TLB shootdown is not attempted as only new information is being
 	 * inserted into page tables.
 	 */
-	page_mapping_insert(AS, addr, frame, as_area_get_flags(area));
-	if (!used_space_insert(area, ALIGN_DOWN(addr, PAGE_SIZE), 1))
+	page_table_lock(area->as, false);
+	page_mapping_insert(area->as, addr, frame, as_area_get_flags(area));
+	if (!area->sh_info)
+		count = anon_fault_around(area, ALIGN_DOWN(addr, PAGE_SIZE));
+	page_table_unlock(area->as, false);
+	if (!used_space_insert(area, ALIGN_DOWN(addr, PAGE_SIZE), count))
 		panic("Could not insert used space.\n");
 		
 	return AS_PF_OK;
 }
 
+/** Map pages following a sequentially touched anonymous page.
+ *
+ * If the page preceding the faulting page is already mapped,
+ * the area is likely being touched sequentially. In that case,
+ * up to AS_FAULT_AROUND - 1 unmapped pages following the faulting
+ * page are mapped as well so that they do not fault one by one.
+ * Frames for these pages are allocated only if readily available.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area Pointer to the address space area. Must not be shared.
+ * @param page Faulting page, already mapped.
+ *
+ * @return Number of consecutive pages starting at page that were mapped.
+ */
+count_t anon_fault_around(as_area_t *area, __address page)
+{
+	__address end = area->base + area->pages * PAGE_SIZE;
+	count_t count;
+	pte_t *pte;
+
+	if (page == area->base)
+		return 1;
+
+	pte = page_mapping_find(area->as, page - PAGE_SIZE);
+	if (!pte || !PTE_PRESENT(pte))
+		return 1;
+
+	for (count = 1; count < AS_FAULT_AROUND; count++) {
+		__address p = page + count * PAGE_SIZE;
+		__address frame;
+		int status;
+
+		if (p >= end)
+			break;
+
+		pte = page_mapping_find(area->as, p);
+		if (pte && PTE_PRESENT(pte))
+			break;
+
+		frame = PFN2ADDR(frame_alloc_rc(ONE_FRAME, FRAME_MOVABLE | FRAME_ATOMIC | FRAME_NO_RECLAIM, &status));
+		if (status != FRAME_OK)
+			break;
+		memsetb(PA2KA(frame), FRAME_SIZE, 0);
+		page_mapping_insert(area->as, p, frame, as_area_get_flags(area));
+	}
+
+	return count;
+}
+
 /** Free a frame that is backed by the anonymous memory backend.
  *
  * The address space area and page tables must be already locked.
@@ -172,6 +229,8 @@ void anon_share(as_area_t *area)
 
 	/*
 	 * Copy used portions of the area to sh_info's page map.
+	 * The pages are visited in ascending order, so they are
+	 * appended to the page map.
 	 */
 	mutex_lock(&area->sh_info->lock);
 	for (cur = area->used_space.leaf_head.next; cur != &area->used_space.leaf_head; cur = cur->next) {
@@ -190,8 +249,8 @@ void anon_share(as_area_t *area)
 				page_table_lock(area->as, false);
 				pte = page_mapping_find(area->as, base + j*PAGE_SIZE);
 				ASSERT(pte && PTE_VALID(pte) && PTE_PRESENT(pte));
-				btree_insert(&area->sh_info->pagemap, (base + j*PAGE_SIZE) - area->base,
-					(void *) PTE_GET_FRAME(pte), NULL);
+				btree_append(&area->sh_info->pagemap, (base + j*PAGE_SIZE) - area->base,
+					(void *) PTE_GET_FRAME(pte));
 				page_table_unlock(area->as, false);
 				frame_reference_add(ADDR2PFN(PTE_GET_FRAME(pte)));
 			}
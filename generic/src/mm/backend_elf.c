@@ -49,6 +49,7 @@
 static int elf_page_fault(as_area_t *area, __address addr, pf_access_t access);
 static void elf_frame_free(as_area_t *area, __address page, __address frame);
 static void elf_share(as_area_t *area);
+static int elf_fault_around(as_area_t *area, __address page);
 
 mem_backend_t elf_backend = {
 	.page_fault = elf_page_fault,
@@ -58,7 +59,8 @@ mem_backend_t elf_backend = {
 
 /** Service a page fault in the ELF backend address space area.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked.
+ * Page tables are locked only for the time of the mapping insertion.
  *
  * @param area Pointer to the address space area.
  * @param addr Faulting virtual address.
@@ -108,7 +110,9 @@ int elf_page_fault(as_area_t *area, __address addr, pf_access_t access)
 		}
 		if (frame || found) {
 			frame_reference_add(ADDR2PFN(frame));
-			page_mapping_insert(AS, addr, frame, as_area_get_flags(area));
+			page_table_lock(area->as, false);
+			page_mapping_insert(area->as, addr, frame, as_area_get_flags(area));
+			page_table_unlock(area->as, false);
 			if (!used_space_insert(area, ALIGN_DOWN(addr, PAGE_SIZE), 1))
 				panic("Could not insert used space.\n");
 			mutex_unlock(&area->sh_info->lock);
@@ -130,7 +134,7 @@ int elf_page_fault(as_area_t *area, __address addr, pf_access_t access)
 		 * as COW.
 		 */
 		if (entry->p_flags & PF_W) {
-			frame = PFN2ADDR(frame_alloc(ONE_FRAME, 0));
+			frame = PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_MOVABLE));
 			memcpy((void *) PA2KA(frame), (void *) (base + i*FRAME_SIZE), FRAME_SIZE);
 			
 			if (area->sh_info) {
@@ -140,6 +144,8 @@ int elf_page_fault(as_area_t *area, __address addr, pf_access_t access)
 			}
 
 		} else {
+			if (!area->sh_info)
+				return elf_fault_around(area, ALIGN_DOWN(addr, PAGE_SIZE));
 			frame = KA2PA(base + i*FRAME_SIZE);
 		}	
 	} else if (ALIGN_DOWN(addr, PAGE_SIZE) >= ALIGN_UP(entry->p_vaddr + entry->p_filesz, PAGE_SIZE)) {
@@ -149,7 +155,7 @@ int elf_page_fault(as_area_t *area, __address addr, pf_access_t access)
 		 * To resolve the situation, a frame must be allocated
 		 * and cleared.
 		 */
-		frame = PFN2ADDR(frame_alloc(ONE_FRAME, 0));
+		frame = PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_MOVABLE));
 		memsetb(PA2KA(frame), FRAME_SIZE, 0);
 
 		if (area->sh_info) {
@@ -166,7 +172,7 @@ int elf_page_fault(as_area_t *area, __address addr, pf_access_t access)
 		 * the upper part is anonymous memory.
 		 */
 		size = entry->p_filesz - (i<<PAGE_WIDTH);
-		frame = PFN2ADDR(frame_alloc(ONE_FRAME, 0));
+		frame = PFN2ADDR(frame_alloc(ONE_FRAME, FRAME_MOVABLE));
 		memsetb(PA2KA(frame) + size, FRAME_SIZE - size, 0);
 		memcpy((void *) PA2KA(frame), (void *) (base + i*FRAME_SIZE), size);
 
@@ -181,13 +187,70 @@ int elf_page_fault(as_area_t *area, __address addr, pf_access_t access)
 	if (area->sh_info)
 		mutex_unlock(&area->sh_info->lock);
 	
-	page_mapping_insert(AS, addr, frame, as_area_get_flags(area));
+	page_table_lock(area->as, false);
+	page_mapping_insert(area->as, addr, frame, as_area_get_flags(area));
+	page_table_unlock(area->as, false);
 	if (!used_space_insert(area, ALIGN_DOWN(addr, PAGE_SIZE), 1))
 		panic("Could not insert used space.\n");
 
 	return AS_PF_OK;
 }
 
+/** Map read-only pages backed by the ELF image around the faulting page.
+ *
+ * Pages of the initialized read-only portion of the segment are mapped
+ * directly to the ELF image and cost nothing but the page table entry.
+ * Therefore all such unmapped pages in the naturally aligned window of
+ * AS_FAULT_AROUND pages containing the faulting page are mapped at once.
+ *
+ * The address space area must be already locked and must not be shared.
+ *
+ * @param area Pointer to the address space area.
+ * @param page Faulting page.
+ *
+ * @return AS_PF_OK.
+ */
+int elf_fault_around(as_area_t *area, __address page)
+{
+	elf_segment_header_t *entry = area->backend_data.segment;
+	__address base = (__address) (((void *) area->backend_data.elf) + entry->p_offset);
+	__address start, end, p, run = 0;
+	count_t count = 0;
+	pte_t *pte;
+
+	start = max(area->base, ALIGN_DOWN(page, AS_FAULT_AROUND * PAGE_SIZE));
+	end = min(start + AS_FAULT_AROUND * PAGE_SIZE, area->base + area->pages * PAGE_SIZE);
+
+	page_table_lock(area->as, false);
+	for (p = start; p < end; p += PAGE_SIZE) {
+		/*
+		 * Stop at the first page that is not entirely backed by the image.
+		 */
+		if (p + PAGE_SIZE >= entry->p_vaddr + entry->p_filesz)
+			break;
+
+		pte = page_mapping_find(area->as, p);
+		if (pte && PTE_PRESENT(pte)) {
+			if (count && !used_space_insert(area, run, count))
+				panic("Could not insert used space.\n");
+			count = 0;
+			continue;
+		}
+
+		if (!count)
+			run = p;
+		page_mapping_insert(area->as, p, KA2PA(base + ((p - entry->p_vaddr) >> PAGE_WIDTH) * FRAME_SIZE),
+			as_area_get_flags(area));
+		count++;
+	}
+	page_table_unlock(area->as, false);
+
+	if (count && !used_space_insert(area, run, count))
+		panic("Could not insert used space.\n");
+
+	return AS_PF_OK;
+}
+
 /** Free a frame that is backed by the ELF backend.
  *
  * The address space area and page tables must be already locked.
@@ -290,8 +353,8 @@ void elf_share(as_area_t *area)
 				page_table_lock(area->as, false);
 				pte = page_mapping_find(area->as, base + j*PAGE_SIZE);
 				ASSERT(pte && PTE_VALID(pte) && PTE_PRESENT(pte));
-				btree_insert(&area->sh_info->pagemap, (base + j*PAGE_SIZE) - area->base,
-					(void *) PTE_GET_FRAME(pte), NULL);
+				btree_append(&area->sh_info->pagemap, (base + j*PAGE_SIZE) - area->base,
+					(void *) PTE_GET_FRAME(pte));
 				page_table_unlock(area->as, false);
 				frame_reference_add(ADDR2PFN(PTE_GET_FRAME(pte)));
 			}
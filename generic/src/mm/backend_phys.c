@@ -37,6 +37,9 @@
 #include <mm/as.h>
 #include <mm/frame.h>
 #include <mm/slab.h>
+#include <mm/page.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
 #include <memstr.h>
 #include <macros.h>
 #include <arch.h>
@@ -44,6 +47,9 @@
 
 static int phys_page_fault(as_area_t *area, __address addr, pf_access_t access);
 static void phys_share(as_area_t *area);
+#ifdef LARGE_PAGE_SIZE
+static bool phys_map_large(as_area_t *area, __address addr);
+#endif
 
 mem_backend_t phys_backend = {
 	.page_fault = phys_page_fault,
@@ -53,7 +59,8 @@ mem_backend_t phys_backend = {
 
 /** Service a page fault in the address space area backed by physical memory.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked.
+ * Page tables are locked only for the time of the mapping insertion.
  *
  * @param area Pointer to the address space area.
  * @param addr Faulting virtual address.
@@ -69,13 +76,63 @@ int phys_page_fault(as_area_t *area, __address addr, pf_access_t access)
 		return AS_PF_FAULT;
 
 	ASSERT(addr - area->base < area->backend_data.frames * FRAME_SIZE);
-	page_mapping_insert(AS, addr, base + (addr - area->base), as_area_get_flags(area));
+#ifdef LARGE_PAGE_SIZE
+	if ((area->flags & AS_AREA_LARGE) && phys_map_large(area, addr))
+		return AS_PF_OK;
+#endif
+	page_table_lock(area->as, false);
+	page_mapping_insert(area->as, addr, base + (addr - area->base), as_area_get_flags(area));
+	page_table_unlock(area->as, false);
         if (!used_space_insert(area, ALIGN_DOWN(addr, PAGE_SIZE), 1))
                 panic("Could not insert used space.\n");
 
 	return AS_PF_OK;
 }
 
+#ifdef LARGE_PAGE_SIZE
+/** Map the large page containing the faulting address.
+ *
+ * The large page is used only if it lies entirely within the area,
+ * the physical memory is aligned the same way as the virtual memory
+ * and no page of the large page has been mapped yet.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area Pointer to the address space area.
+ * @param addr Faulting virtual address.
+ *
+ * @return True if the large page was mapped, false otherwise.
+ */
+bool phys_map_large(as_area_t *area, __address addr)
+{
+	__address page = ALIGN_DOWN(addr, LARGE_PAGE_SIZE);
+	__address frame = area->backend_data.base + (page - area->base);
+	__address off;
+	pte_t *pte;
+
+	if ((page < area->base) || (frame % LARGE_PAGE_SIZE))
+		return false;
+	if (page + LARGE_PAGE_SIZE > area->base + min(area->pages, area->backend_data.frames) * PAGE_SIZE)
+		return false;
+
+	page_table_lock(area->as, false);
+	for (off = 0; off < LARGE_PAGE_SIZE; off += PAGE_SIZE) {
+		pte = page_mapping_find(area->as, page + off);
+		if (pte && PTE_VALID(pte)) {
+			page_table_unlock(area->as, false);
+			return false;
+		}
+	}
+	page_mapping_insert_large(area->as, page, frame, as_area_get_flags(area), LARGE_PAGE_SIZE);
+	page_table_unlock(area->as, false);
+
+	if (!used_space_insert(area, page, LARGE_PAGE_SIZE / PAGE_SIZE))
+		panic("Could not insert used space.\n");
+
+	return true;
+}
+#endif
+
 /** Share address space area backed by physical memory.
  *
  * Do actually nothing as sharing of address space areas
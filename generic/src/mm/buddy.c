@@ -42,11 +42,12 @@
 #include <adt/list.h>
 #include <debug.h>
 #include <print.h>
+#include <macros.h>
 
 /** Return size needed for the buddy configuration data */
 size_t buddy_conf_size(int max_order)
 {
-	return sizeof(buddy_system_t) + (max_order + 1) * sizeof(link_t);
+	return sizeof(buddy_system_t) + BUDDY_SYSTEM_CLASSES * (max_order + 1) * sizeof(link_t);
 }
 
 
@@ -54,15 +55,22 @@ size_t buddy_conf_size(int max_order)
  *
  * Allocate memory for and initialize new buddy system.
  *
+ * Free blocks are kept in separate lists for each of the
+ * BUDDY_SYSTEM_CLASSES classes. The class of a block is
+ * determined by the implementation for groups of 2^class_order
+ * elements, so that blocks of different lifetime do not get
+ * mixed in the same group and do not prevent it from coalescing.
+ *
  * @param b Preallocated buddy system control data.
  * @param max_order The biggest allocable size will be 2^max_order.
+ * @param class_order Size (2^class_order) of group of elements sharing one class.
  * @param op Operations for new buddy system.
  * @param data Pointer to be used by implementation.
  *
  * @return New buddy system.
  */
 void buddy_system_create(buddy_system_t *b,
-			 __u8 max_order, 
+			 __u8 max_order, __u8 class_order,
 			 buddy_system_operations_t *op, 
 			 void *data)
 {
@@ -82,15 +90,29 @@ void buddy_system_create(buddy_system_t *b,
 	 */
 	b->order = (link_t *) (&b[1]);
 	
-	for (i = 0; i <= max_order; i++)
+	for (i = 0; i < BUDDY_SYSTEM_CLASSES * (max_order + 1); i++)
 		list_initialize(&b->order[i]);
 
 	b->max_order = max_order;
+	b->class_order = min(class_order, max_order);
+	b->fallbacks = 0;
+	b->claims = 0;
 	b->op = op;
 	b->data = data;
 }
 
+/** Return class of block. */
+static __u8 buddy_system_get_class(buddy_system_t *b, link_t *block)
+{
+	if (!b->op->get_class)
+		return 0;
+	return b->op->get_class(b, block);
+}
+
 /** Check if buddy system can allocate block
+ *
+ * Blocks of all classes are taken into account,
+ * as buddy_system_alloc() falls back to foreign classes.
  *
  * @param b Buddy system pointer
  * @param i Size of the block (2^i)
@@ -98,7 +120,7 @@ void buddy_system_create(buddy_system_t *b,
  * @return True if block can be allocated
  */
 bool buddy_system_can_alloc(buddy_system_t *b, __u8 i) {
-	__u8 k;
+	__u8 k, c;
 	
 	/*
 	 * If requested block is greater then maximal block
@@ -110,8 +132,9 @@ bool buddy_system_can_alloc(buddy_system_t *b, __u8 i) {
 	 * Check if any bigger or equal order has free elements
 	 */
 	for (k=i; k <= b->max_order; k++) {
-		if (!list_empty(&b->order[k])) {
-			return true;
+		for (c = 0; c < BUDDY_SYSTEM_CLASSES; c++) {
+			if (!list_empty(BUDDY_LIST(b, c, k)))
+				return true;
 		}
 	}
 	
@@ -119,6 +142,28 @@ bool buddy_system_can_alloc(buddy_system_t *b, __u8 i) {
 	
 }
 
+/** Return number of free blocks of given order and class.
+ *
+ * @param b Buddy system pointer.
+ * @param i Order of blocks to be counted.
+ * @param class Class of blocks to be counted.
+ *
+ * @return Number of free blocks in the respective list.
+ */
+count_t buddy_system_free_blocks(buddy_system_t *b, __u8 i, __u8 class)
+{
+	link_t *cur;
+	count_t cnt = 0;
+
+	if (i > b->max_order)
+		return 0;
+	
+	for (cur = BUDDY_LIST(b, class, i)->next; cur != BUDDY_LIST(b, class, i); cur = cur->next)
+		cnt++;
+	
+	return cnt;
+}
+
 /** Allocate PARTICULAR block from buddy system
  *
  * @ return Block of data or NULL if no such block was found
@@ -156,25 +201,26 @@ link_t *buddy_system_alloc_block(buddy_system_t *b, link_t *block)
 	}
 }
 
-/** Allocate block from buddy system.
+/** Allocate block of given class from buddy system.
+ *
+ * Only free lists of the requested class are considered.
  *
  * @param b Buddy system pointer.
  * @param i Returned block will be 2^i big.
+ * @param class Class of the block.
  *
- * @return Block of data represented by link_t.
+ * @return Block of data represented by link_t or NULL.
  */
-link_t *buddy_system_alloc(buddy_system_t *b, __u8 i)
+static link_t *buddy_system_alloc_class(buddy_system_t *b, __u8 i, __u8 class)
 {
 	link_t *res, *hlp;
 
-	ASSERT(i <= b->max_order);
-
 	/*
 	 * If the list of order i is not empty,
 	 * the request can be immediatelly satisfied.
 	 */
-	if (!list_empty(&b->order[i])) {
-		res = b->order[i].next;
+	if (!list_empty(BUDDY_LIST(b, class, i))) {
+		res = BUDDY_LIST(b, class, i)->next;
 		list_remove(res);
 		b->op->mark_busy(b, res);
 		return res;
@@ -189,7 +235,7 @@ link_t *buddy_system_alloc(buddy_system_t *b, __u8 i)
 	/*
 	 * Try to recursively satisfy the request from higher order lists.
 	 */	
-	hlp = buddy_system_alloc(b, i + 1);
+	hlp = buddy_system_alloc_class(b, i + 1, class);
 	
 	/*
 	 * The request could not be satisfied
@@ -218,6 +264,100 @@ link_t *buddy_system_alloc(buddy_system_t *b, __u8 i)
 	
 }
 
+/** Allocate block from foreign class.
+ *
+ * The biggest free block of other classes is taken so that
+ * the number of groups polluted by the requested class is minimal.
+ *
+ * @param b Buddy system pointer.
+ * @param i Returned block will be 2^i big.
+ * @param class Requested class.
+ *
+ * @return Block of data represented by link_t or NULL.
+ */
+static link_t *buddy_system_alloc_fallback(buddy_system_t *b, __u8 i, __u8 class)
+{
+	link_t *res = NULL, *hlp;
+	int k;
+	__u8 c, order;
+
+	for (k = b->max_order; k >= i && !res; k--) {
+		for (c = 0; c < BUDDY_SYSTEM_CLASSES; c++) {
+			if (c == class)
+				continue;
+			if (!list_empty(BUDDY_LIST(b, c, k))) {
+				res = BUDDY_LIST(b, c, k)->next;
+				break;
+			}
+		}
+	}
+	if (!res)
+		return NULL;
+	
+	list_remove(res);
+	b->op->mark_busy(b, res);
+	b->fallbacks++;
+
+	/*
+	 * Split the block down to a single group, returning
+	 * the other groups to their original class.
+	 */
+	order = b->op->get_order(b, res);
+	while (order > max(i, b->class_order)) {
+		hlp = b->op->bisect(b, res);
+		order--;
+		b->op->set_order(b, res, order);
+		b->op->set_order(b, hlp, order);
+		buddy_system_free(b, hlp);
+	}
+
+	/*
+	 * Claim the group for the requested class if at least
+	 * half of it was free so that subsequent allocations
+	 * of this class are satisfied from the same group.
+	 */
+	if (b->op->set_class && (order + 1 >= b->class_order) &&
+	    (buddy_system_get_class(b, res) != class)) {
+		b->op->set_class(b, res, class);
+		b->claims++;
+	}
+
+	while (order > i) {
+		hlp = b->op->bisect(b, res);
+		order--;
+		b->op->set_order(b, res, order);
+		b->op->set_order(b, hlp, order);
+		buddy_system_free(b, hlp);
+	}
+	
+	return res;
+}
+
+/** Allocate block from buddy system.
+ *
+ * The block is allocated from free lists of the requested class.
+ * If there is no such block, a block of another class is used.
+ *
+ * @param b Buddy system pointer.
+ * @param i Returned block will be 2^i big.
+ * @param class Class of the block.
+ *
+ * @return Block of data represented by link_t.
+ */
+link_t *buddy_system_alloc(buddy_system_t *b, __u8 i, __u8 class)
+{
+	link_t *res;
+
+	ASSERT(i <= b->max_order);
+	ASSERT(class < BUDDY_SYSTEM_CLASSES);
+
+	res = buddy_system_alloc_class(b, i, class);
+	if (!res)
+		res = buddy_system_alloc_fallback(b, i, class);
+
+	return res;
+}
+
 /** Return block to buddy system.
  *
  * @param b Buddy system pointer.
@@ -273,9 +413,9 @@ void buddy_system_free(buddy_system_t *b, link_t *block)
 	}
 
 	/*
-	 * Insert block into the list of order i.
+	 * Insert block into the list of order i and of its class.
 	 */
-	list_append(block, &b->order[i]);
+	list_append(block, BUDDY_LIST(b, buddy_system_get_class(b, block), i));
 
 }
 
@@ -288,6 +428,7 @@ void buddy_system_structure_print(buddy_system_t *b, size_t elem_size) {
 	index_t i;
 	count_t cnt, elem_count = 0, block_count = 0;
 	link_t * cur;
+	__u8 c;
 	
 
 	printf("Order\tBlocks\tSize    \tBlock size\tElems per block\n");
@@ -295,16 +436,14 @@ void buddy_system_structure_print(buddy_system_t *b, size_t elem_size) {
 	
 	for (i=0;i <= b->max_order; i++) {
 		cnt = 0;
-		if (!list_empty(&b->order[i])) {
-			for (cur = b->order[i].next; cur != &b->order[i]; cur = cur->next)
-				cnt++;
-		}
+		for (c = 0; c < BUDDY_SYSTEM_CLASSES; c++)
+			cnt += buddy_system_free_blocks(b, i, c);
 	
 		printf("#%zd\t%5zd\t%7zdK\t%8zdK\t%6zd\t", i, cnt, (cnt * (1 << i) * elem_size) >> 10, ((1 << i) * elem_size) >> 10, 1 << i);
-		if (!list_empty(&b->order[i])) {
-			for (cur = b->order[i].next; cur != &b->order[i]; cur = cur->next) {
+		for (c = 0; c < BUDDY_SYSTEM_CLASSES; c++) {
+			for (cur = BUDDY_LIST(b, c, i)->next; cur != BUDDY_LIST(b, c, i); cur = cur->next) {
 				b->op->print_id(b, cur);
-				printf(" ");
+				printf("%s ", c ? "*" : "");
 			}
 		}
 		printf("\n");
@@ -314,5 +453,6 @@ void buddy_system_structure_print(buddy_system_t *b, size_t elem_size) {
 	}
 	printf("-----\t------\t--------\t----------\t---------------\n");
 	printf("Buddy system contains %zd free elements (%zd blocks)\n" , elem_count, block_count);
+	printf("Class fallbacks: %zd, claimed groups: %zd\n", b->fallbacks, b->claims);
 
 }
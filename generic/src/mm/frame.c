@@ -62,6 +62,9 @@
 #include <mm/slab.h>
 #include <bitops.h>
 #include <macros.h>
+#include <func.h>
+#include <atomic.h>
+#include <sysinfo/sysinfo.h>
 
 typedef struct {
 	count_t refcount;	/**< tracking of shared frames  */
@@ -80,6 +83,7 @@ typedef struct {
 	count_t busy_count;	/**< number of busy frame_t structures */
 	
 	buddy_system_t * buddy_system; /**< buddy system for the zone */
+	__u8 *mobility;		/**< buddy class of each group of 2^FRAME_MOBILITY_ORDER frames */
 	int flags;
 } zone_t;
 
@@ -94,6 +98,9 @@ struct {
 	zone_t *info[ZONES_MAX];
 } zones;
 
+/** Number of failed allocations of each order. */
+static atomic_t frame_alloc_failures[FRAME_FRAG_ORDERS];
+
 
 /*********************************/
 /* Helper functions */
@@ -110,6 +117,19 @@ static inline int frame_index_valid(zone_t *zone, index_t index)
 	return index >= 0 && index < zone->count;
 }
 
+/** Return number of mobility groups needed by zone of given size */
+static inline count_t zone_groups(count_t count)
+{
+	/* The zone need not start at a group boundary. */
+	return (count >> FRAME_MOBILITY_ORDER) + 2;
+}
+
+/** Return index of mobility group containing frame with given index */
+static inline index_t zone_group_index(zone_t *zone, index_t index)
+{
+	return ((zone->base + index) >> FRAME_MOBILITY_ORDER) - (zone->base >> FRAME_MOBILITY_ORDER);
+}
+
 /** Compute pfn_t from frame_t pointer & zone pointer */
 static index_t make_frame_index(zone_t *zone, frame_t *frame)
 {
@@ -420,6 +440,41 @@ static void zone_buddy_mark_available(buddy_system_t *b, link_t * block) {
 	frame->refcount = 0;
 }
 
+/** Buddy system get_class implementation
+ *
+ * @param b Buddy system.
+ * @param block Buddy system block
+ *
+ * @return Mobility of the group containing the block.
+ */
+static __u8 zone_buddy_get_class(buddy_system_t *b, link_t * block) {
+	frame_t * frame;
+	zone_t * zone;
+
+	frame = list_get_instance(block, frame_t, buddy_link);
+	zone = (zone_t *) b->data;
+	return zone->mobility[zone_group_index(zone, frame_index(zone, frame))];
+}
+
+/** Buddy system set_class implementation
+ *
+ * @param b Buddy system.
+ * @param block Buddy system block
+ * @param class Mobility to be set for all groups touched by the block.
+ */
+static void zone_buddy_set_class(buddy_system_t *b, link_t * block, __u8 class) {
+	frame_t * frame;
+	zone_t * zone;
+	index_t index, i;
+
+	frame = list_get_instance(block, frame_t, buddy_link);
+	zone = (zone_t *) b->data;
+	index = frame_index(zone, frame);
+	for (i = zone_group_index(zone, index);
+	     i <= zone_group_index(zone, index + (1 << frame->buddy_order) - 1); i++)
+		zone->mobility[i] = class;
+}
+
 static struct buddy_system_operations  zone_buddy_system_operations = {
 	.find_buddy = zone_buddy_find_buddy,
 	.bisect = zone_buddy_bisect,
@@ -429,7 +484,9 @@ static struct buddy_system_operations  zone_buddy_system_operations = {
 	.mark_busy = zone_buddy_mark_busy,
 	.mark_available = zone_buddy_mark_available,
 	.find_block = zone_buddy_find_block,
-	.print_id = zone_buddy_print_id
+	.print_id = zone_buddy_print_id,
+	.get_class = zone_buddy_get_class,
+	.set_class = zone_buddy_set_class
 };
 
 /*************************************/
@@ -442,18 +499,19 @@ static struct buddy_system_operations  zone_buddy_system_operations = {
  *
  * @param zone  Zone to allocate from.
  * @param order Allocate exactly 2^order frames.
+ * @param mobility FRAME_MOBILITY_MOVABLE or FRAME_MOBILITY_UNMOVABLE.
  *
  * @return Frame index in zone
  *
  */
-static pfn_t zone_frame_alloc(zone_t *zone, __u8 order)
+static pfn_t zone_frame_alloc(zone_t *zone, __u8 order, __u8 mobility)
 {
 	pfn_t v;
 	link_t *tmp;
 	frame_t *frame;
 
 	/* Allocate frames from zone buddy system */
-	tmp = buddy_system_alloc(zone->buddy_system, order);
+	tmp = buddy_system_alloc(zone->buddy_system, order, mobility);
 	
 	ASSERT(tmp);
 	
@@ -552,7 +610,7 @@ static void _zone_merge(zone_t *z, zone_t *z1, zone_t *z2)
 	max_order = fnzb(z->count);
 
 	z->buddy_system = (buddy_system_t *)&z[1];
-	buddy_system_create(z->buddy_system, max_order, 
+	buddy_system_create(z->buddy_system, max_order, FRAME_MOBILITY_ORDER,
 			    &zone_buddy_system_operations, 
 			    (void *) z);
 
@@ -561,6 +619,17 @@ static void _zone_merge(zone_t *z, zone_t *z1, zone_t *z2)
 		/* This marks all frames busy */
 		frame_initialize(&z->frames[i]);
 	}
+
+	/* Preserve mobility of groups from both zones */
+	z->mobility = (__u8 *) &z->frames[z->count];
+	for (i = 0; i < zone_groups(z->count); i++)
+		z->mobility[i] = FRAME_MOBILITY_MOVABLE;
+	for (i = 0; i < z1->count; i += 1 << FRAME_MOBILITY_ORDER)
+		z->mobility[zone_group_index(z, i)] = z1->mobility[zone_group_index(z1, i)];
+	for (i = 0; i < z2->count; i += 1 << FRAME_MOBILITY_ORDER) {
+		z2idx = i + (z2->base - z1->base);
+		z->mobility[zone_group_index(z, z2idx)] = z2->mobility[zone_group_index(z2, i)];
+	}
 	/* Copy frames from both zones to preserve full frame orders,
 	 * parents etc. Set all free frames with refcount=0 to 1, because
 	 * we add all free frames to buddy allocator later again, clear
@@ -589,13 +658,13 @@ static void _zone_merge(zone_t *z, zone_t *z1, zone_t *z2)
 	}
 	/* Add free blocks from the 2 original zones */
 	while (zone_can_alloc(z1, 0)) {
-		frame_idx = zone_frame_alloc(z1, 0);
+		frame_idx = zone_frame_alloc(z1, 0, FRAME_MOBILITY_UNMOVABLE);
 		frame = &z->frames[frame_idx];
 		frame->refcount = 0;
 		buddy_system_free(z->buddy_system, &frame->buddy_link);
 	}
 	while (zone_can_alloc(z2, 0)) {
-		frame_idx = zone_frame_alloc(z2, 0);
+		frame_idx = zone_frame_alloc(z2, 0, FRAME_MOBILITY_UNMOVABLE);
 		frame = &z->frames[frame_idx + (z2->base-z1->base)];
 		frame->refcount = 0;
 		buddy_system_free(z->buddy_system, &frame->buddy_link);
@@ -708,9 +777,9 @@ void zone_merge(int z1, int z2)
 
 	/* Allocate zonedata inside one of the zones */
 	if (zone_can_alloc(zone1, order))
-		pfn = zone1->base + zone_frame_alloc(zone1, order);
+		pfn = zone1->base + zone_frame_alloc(zone1, order, FRAME_MOBILITY_UNMOVABLE);
 	else if (zone_can_alloc(zone2, order))
-		pfn = zone2->base + zone_frame_alloc(zone2, order);
+		pfn = zone2->base + zone_frame_alloc(zone2, order, FRAME_MOBILITY_UNMOVABLE);
 	else
 		goto errout2;
 
@@ -787,7 +856,7 @@ static void zone_construct(pfn_t start, count_t count, zone_t *z, int flags)
 	max_order = fnzb(count);
 	z->buddy_system = (buddy_system_t *)&z[1];
 	
-	buddy_system_create(z->buddy_system, max_order, 
+	buddy_system_create(z->buddy_system, max_order, FRAME_MOBILITY_ORDER,
 			    &zone_buddy_system_operations, 
 			    (void *) z);
 	
@@ -797,6 +866,14 @@ static void zone_construct(pfn_t start, count_t count, zone_t *z, int flags)
 	for (i = 0; i<count; i++) {
 		frame_initialize(&z->frames[i]);
 	}
+
+	/*
+	 * All groups start as movable. Unmovable allocations
+	 * claim whole groups from the biggest free blocks.
+	 */
+	z->mobility = (__u8 *) &z->frames[count];
+	for (i = 0; i < zone_groups(count); i++)
+		z->mobility[i] = FRAME_MOBILITY_MOVABLE;
 	
 	/* Stuffing frames */
 	for (i = 0; i < count; i++) {
@@ -812,7 +889,7 @@ static void zone_construct(pfn_t start, count_t count, zone_t *z, int flags)
  */
 __address zone_conf_size(count_t count)
 {
-	int size = sizeof(zone_t) + count*sizeof(frame_t);
+	int size = sizeof(zone_t) + count*sizeof(frame_t) + zone_groups(count);
 	int max_order;
 
 	max_order = fnzb(count);
@@ -930,6 +1007,9 @@ pfn_t frame_alloc_generic(__u8 order, int flags, int *status, int *pzone)
 	int freed;
 	pfn_t v;
 	zone_t *zone;
+	__u8 mobility;
+
+	mobility = (flags & FRAME_MOVABLE) ? FRAME_MOBILITY_MOVABLE : FRAME_MOBILITY_UNMOVABLE;
 	
 loop:
 	ipl = interrupts_disable();
@@ -952,6 +1032,8 @@ loop:
 		}
 	}
 	if (!zone) {
+		atomic_inc(&frame_alloc_failures[min(order, FRAME_FRAG_ORDERS - 1)]);
+		
 		if (flags & FRAME_PANIC)
 			panic("Can't allocate frame.\n");
 		
@@ -971,7 +1053,7 @@ loop:
 		goto loop;
 	}
 	
-	v = zone_frame_alloc(zone, order);
+	v = zone_frame_alloc(zone, order, mobility);
 	v += zone->base;
 
 	spinlock_unlock(&zone->lock);
@@ -1142,3 +1224,199 @@ out:
 	interrupts_restore(ipl);
 }
 
+
+/** Gather free block statistics of one zone
+ *
+ * The zone must be locked.
+ *
+ * @param zone Zone to be examined.
+ * @param order Order of the hypothetical allocation.
+ * @param free_frames Incremented by the number of free frames.
+ * @param free_blocks Incremented by the number of free blocks.
+ * @param suitable Incremented by the number of free blocks of at least 2^order frames.
+ */
+static void zone_frag_info(zone_t *zone, __u8 order, count_t *free_frames,
+			   count_t *free_blocks, count_t *suitable)
+{
+	count_t cnt;
+	int i;
+	__u8 c;
+
+	for (i = 0; i <= zone->buddy_system->max_order; i++) {
+		for (c = 0; c < BUDDY_SYSTEM_CLASSES; c++) {
+			cnt = buddy_system_free_blocks(zone->buddy_system, i, c);
+			*free_blocks += cnt;
+			*free_frames += cnt << i;
+			if (i >= order)
+				*suitable += cnt;
+		}
+	}
+}
+
+/** Compute fragmentation index
+ *
+ * The index tells whether a failure to allocate 2^order frames
+ * would be caused by lack of free memory (values close to 0) or
+ * by external fragmentation (values close to 1000).
+ *
+ * @param order Order of the hypothetical allocation.
+ *
+ * @return Fragmentation index in thousandths or -1 if the allocation would succeed.
+ */
+int frame_frag_index(__u8 order)
+{
+	count_t free_frames = 0, free_blocks = 0, suitable = 0;
+	ipl_t ipl;
+	int i;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&zones.lock);
+	for (i = 0; i < zones.count; i++) {
+		spinlock_lock(&zones.info[i]->lock);
+		zone_frag_info(zones.info[i], order, &free_frames, &free_blocks, &suitable);
+		spinlock_unlock(&zones.info[i]->lock);
+	}
+	spinlock_unlock(&zones.lock);
+	interrupts_restore(ipl);
+
+	if (suitable)
+		return -1;
+	if (!free_blocks)
+		return 0;
+
+	return 1000 - (1000 + (free_frames * 1000) / (1 << order)) / free_blocks;
+}
+
+/** Prints free block histogram and fragmentation index of all zones
+ *
+ */
+void zone_print_frag(void) {
+	zone_t *zone;
+	ipl_t ipl;
+	int i, order, index;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&zones.lock);
+	for (i = 0; i < zones.count; i++) {
+		zone = zones.info[i];
+		spinlock_lock(&zone->lock);
+		printf("Zone %d: class fallbacks=%zd, claimed groups=%zd\n", i,
+		       zone->buddy_system->fallbacks, zone->buddy_system->claims);
+		printf("   Order\tUnmovable\tMovable\n");
+		for (order = 0; order <= min(zone->buddy_system->max_order, FRAME_FRAG_ORDERS - 1); order++) {
+			printf("   #%d\t%9zd\t%7zd\n", order,
+			       buddy_system_free_blocks(zone->buddy_system, order, FRAME_MOBILITY_UNMOVABLE),
+			       buddy_system_free_blocks(zone->buddy_system, order, FRAME_MOBILITY_MOVABLE));
+		}
+		spinlock_unlock(&zone->lock);
+	}
+	spinlock_unlock(&zones.lock);
+	interrupts_restore(ipl);
+
+	printf("Order\tFailures\tFragmentation index\n");
+	printf("-----\t--------\t-------------------\n");
+	for (order = 0; order < FRAME_FRAG_ORDERS; order++) {
+		index = frame_frag_index(order);
+		printf("#%d\t%8zd\t", order, atomic_get(&frame_alloc_failures[order]));
+		if (index < 0)
+			printf("n/a\n");
+		else
+			printf("%d.%03d\n", index / 1000, index % 1000);
+	}
+}
+
+/** Sysinfo function returning fragmentation index of order given by item name. */
+static __native frame_frag_index_sysinfo(sysinfo_item_t *item)
+{
+	return (__native) frame_frag_index(atoi(item->name));
+}
+
+/** Sysinfo function returning number of free blocks of order given by item name. */
+static __native frame_frag_blocks_sysinfo(sysinfo_item_t *item)
+{
+	__native blocks = 0;
+	__u8 order = atoi(item->name);
+	ipl_t ipl;
+	int i;
+	__u8 c;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&zones.lock);
+	for (i = 0; i < zones.count; i++) {
+		spinlock_lock(&zones.info[i]->lock);
+		for (c = 0; c < BUDDY_SYSTEM_CLASSES; c++)
+			blocks += buddy_system_free_blocks(zones.info[i]->buddy_system, order, c);
+		spinlock_unlock(&zones.info[i]->lock);
+	}
+	spinlock_unlock(&zones.lock);
+	interrupts_restore(ipl);
+
+	return blocks;
+}
+
+/** Sysinfo function returning number of failed allocations of order given by item name. */
+static __native frame_frag_failures_sysinfo(sysinfo_item_t *item)
+{
+	return (__native) atomic_get(&frame_alloc_failures[min(atoi(item->name), FRAME_FRAG_ORDERS - 1)]);
+}
+
+/** Sysinfo function returning the total number of class fallbacks. */
+static __native frame_frag_fallbacks_sysinfo(sysinfo_item_t *item)
+{
+	__native fallbacks = 0;
+	ipl_t ipl;
+	int i;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&zones.lock);
+	for (i = 0; i < zones.count; i++) {
+		spinlock_lock(&zones.info[i]->lock);
+		fallbacks += zones.info[i]->buddy_system->fallbacks;
+		spinlock_unlock(&zones.info[i]->lock);
+	}
+	spinlock_unlock(&zones.lock);
+	interrupts_restore(ipl);
+
+	return fallbacks;
+}
+
+/** Sysinfo function returning the total number of claimed groups. */
+static __native frame_frag_claims_sysinfo(sysinfo_item_t *item)
+{
+	__native claims = 0;
+	ipl_t ipl;
+	int i;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&zones.lock);
+	for (i = 0; i < zones.count; i++) {
+		spinlock_lock(&zones.info[i]->lock);
+		claims += zones.info[i]->buddy_system->claims;
+		spinlock_unlock(&zones.info[i]->lock);
+	}
+	spinlock_unlock(&zones.lock);
+	interrupts_restore(ipl);
+
+	return claims;
+}
+
+/** Export fragmentation statistics via sysinfo
+ *
+ * Must be called after the slab allocator is initialized.
+ */
+void frame_sysinfo_init(void)
+{
+	char name[32];
+	int i;
+
+	for (i = 0; i < FRAME_FRAG_ORDERS; i++) {
+		snprintf(name, sizeof(name), "mm.frag.index.%d", i);
+		sysinfo_set_item_function(name, NULL, frame_frag_index_sysinfo);
+		snprintf(name, sizeof(name), "mm.frag.blocks.%d", i);
+		sysinfo_set_item_function(name, NULL, frame_frag_blocks_sysinfo);
+		snprintf(name, sizeof(name), "mm.frag.failures.%d", i);
+		sysinfo_set_item_function(name, NULL, frame_frag_failures_sysinfo);
+	}
+	sysinfo_set_item_function("mm.frag.fallbacks", NULL, frame_frag_fallbacks_sysinfo);
+	sysinfo_set_item_function("mm.frag.claims", NULL, frame_frag_claims_sysinfo);
+}
@@ -97,6 +97,39 @@ void page_mapping_insert(as_t *as, __address page, __address frame, int flags)
 	page_mapping_operations->mapping_insert(as, page, frame, flags);
 }
 
+/** Insert large mapping of page to frame.
+ *
+ * Map size bytes of virtual memory starting at page to physical
+ * memory starting at frame using a single large page, if the
+ * architecture supports large pages of the requested size.
+ * Otherwise, the memory is mapped by ordinary pages.
+ *
+ * Both page and frame must be aligned to size.
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as Address space to wich page belongs.
+ * @param page Virtual address of the large page to be mapped.
+ * @param frame Physical address to which the mapping is done.
+ * @param flags Flags to be used for mapping.
+ * @param size Size of the large page.
+ */
+void page_mapping_insert_large(as_t *as, __address page, __address frame, int flags, size_t size)
+{
+	__address off;
+
+	ASSERT(page_mapping_operations);
+	ASSERT(page % size == 0);
+	ASSERT(frame % size == 0);
+
+	if (page_mapping_operations->mapping_insert_large) {
+		page_mapping_operations->mapping_insert_large(as, page, frame, flags, size);
+		return;
+	}
+
+	for (off = 0; off < size; off += PAGE_SIZE)
+		page_mapping_insert(as, page + off, frame + off, flags);
+}
+
 /** Remove mapping of page.
  *
  * Remove any mapping of page within address space as.
@@ -116,6 +149,37 @@ void page_mapping_remove(as_t *as, __address page)
 	page_mapping_operations->mapping_remove(as, page);
 }
 
+/** Remove large mapping of page.
+ *
+ * Remove the mapping of size bytes of virtual memory starting
+ * at page that was created by page_mapping_insert_large(). The
+ * large mapping is removed as a whole, without being split.
+ * TLB shootdown should follow in order to make effects of
+ * this call visible.
+ *
+ * Page must be aligned to size.
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as Address space to wich page belongs.
+ * @param page Virtual address of the large page to be demapped.
+ * @param size Size of the large page.
+ */
+void page_mapping_remove_large(as_t *as, __address page, size_t size)
+{
+	__address off;
+
+	ASSERT(page_mapping_operations);
+	ASSERT(page % size == 0);
+
+	if (page_mapping_operations->mapping_remove_large) {
+		page_mapping_operations->mapping_remove_large(as, page, size);
+		return;
+	}
+
+	for (off = 0; off < size; off += PAGE_SIZE)
+		page_mapping_remove(as, page + off);
+}
+
 /** Find mapping for virtual page
  *
  * Find mapping for virtual page.
@@ -134,3 +198,28 @@ pte_t *page_mapping_find(as_t *as, __address page)
 
 	return page_mapping_operations->mapping_find(as, page);
 }
+
+/** Find mapping for virtual page and the size of the mapped page
+ *
+ * Unlike page_mapping_find(), this tells whether the returned
+ * entry maps a page larger than PAGE_SIZE.
+ *
+ * The page table must be locked and interrupts must be disabled.
+ *
+ * @param as Address space to wich page belongs.
+ * @param page Virtual page.
+ * @param size Address where to store the size of the page mapped by the returned entry.
+ *
+ * @return NULL if there is no such mapping; requested mapping otherwise.
+ */
+pte_t *page_mapping_find_size(as_t *as, __address page, size_t *size)
+{
+	ASSERT(page_mapping_operations);
+	ASSERT(page_mapping_operations->mapping_find);
+
+	if (page_mapping_operations->mapping_find_size)
+		return page_mapping_operations->mapping_find_size(as, page, size);
+
+	*size = PAGE_SIZE;
+	return page_mapping_operations->mapping_find(as, page);
+}
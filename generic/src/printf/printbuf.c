@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	printbuf.c
+ * @brief	Per-CPU buffering of printf() output.
+ *
+ * Once kprintd is running, printf() only formats the message
+ * into the buffer of the current CPU, which involves no lock.
+ * The kprintd thread periodically moves the messages from all
+ * buffers to the console in the order in which they were printed.
+ * A message that does not fit into the buffer is dropped and
+ * counted.
+ *
+ * Before kprintd starts, once the kernel panics or halts and in the thread
+ * reading the kernel console, printf() writes directly to the console.
+ * The kernel console echoes its input with putchar(), so its prompt
+ * and output must not be delayed. A direct write first prints all
+ * buffered messages so that the output stays in order.
+ */
+
+#include <printf/printbuf.h>
+#include <printf/printf_core.h>
+#include <print.h>
+#include <putchar.h>
+#include <synch/spinlock.h>
+#include <arch/barrier.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <func.h>
+#include <memstr.h>
+#include <macros.h>
+#include <mm/frame.h>
+#include <proc/thread.h>
+#include <sysinfo/sysinfo.h>
+#include <console/klog.h>
+
+#define PRINTBUF_SIZE	(FRAME_SIZE << PRINTBUF_ORDER)
+
+/** Header of a message stored in a per-CPU buffer. */
+typedef struct {
+	__u64 stamp;		/**< Cycle counter at the time of the printf() call. */
+	__native len;		/**< Length of the message text following the header. */
+} printbuf_hdr_t;
+
+/** Message being formatted into a per-CPU buffer. */
+typedef struct {
+	printbuf_t *buf;
+	__native pos;		/**< Position of the next character. */
+	__native limit;		/**< First position not available to the producer. */
+	bool overflow;		/**< The message did not fit. */
+} printbuf_msg_t;
+
+/** Set by kprintd once it is ready to drain the buffers. */
+static volatile bool printbuf_active = false;
+
+/** Set by panic_printf() before it prints the panic message. */
+volatile bool printbuf_panic = false;
+
+/** Thread reading the kernel console. Its output is not buffered. */
+static thread_t * volatile printbuf_console = NULL;
+
+static void printbuf_copy_in(printbuf_t *buf, __native pos, const void *src, size_t cnt);
+static void printbuf_copy_out(printbuf_t *buf, __native pos, void *dst, size_t cnt);
+static int printbuf_write(const char *str, size_t count, printbuf_msg_t *msg);
+static bool printbuf_drain_one(void);
+static __native printbuf_dropped_sysinfo(sysinfo_item_t *item);
+
+/** Allocate per-CPU buffers.
+ *
+ * Must be called after cpu_init() on the bootstrap CPU.
+ */
+void printbuf_init(void)
+{
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++)
+		cpus[i].printbuf.data = (__u8 *) PA2KA(PFN2ADDR(frame_alloc(PRINTBUF_ORDER, FRAME_KA | FRAME_PANIC)));
+
+	sysinfo_set_item_function("printf.dropped", NULL, printbuf_dropped_sysinfo);
+}
+
+/** Format message into the buffer of the current CPU.
+ *
+ * @param fmt Format string.
+ * @param ap Arguments. They are not touched if false is returned.
+ * @param ret Place to store the number of characters formatted
+ *	      or negative value if the message did not fit.
+ *
+ * @return False if printing is not buffered at the moment
+ *	   and the caller needs to print the message itself.
+ */
+bool printbuf_vprintf(const char *fmt, va_list ap, int *ret)
+{
+	struct printf_spec ps = {(int(*)(void *, size_t, void *)) printbuf_write, NULL};
+	printbuf_msg_t msg;
+	printbuf_hdr_t hdr;
+	__native start;
+	ipl_t ipl;
+
+	if (!printbuf_active || printbuf_panic || atomic_get(&haltstate))
+		return false;
+	if (THREAD && (THREAD == printbuf_console))
+		return false;
+
+	ipl = interrupts_disable();
+
+	msg.buf = &CPU->printbuf;
+	start = msg.buf->head;
+	msg.limit = msg.buf->tail + PRINTBUF_SIZE;
+	/* Do not overwrite data before the consumer has read the tail. */
+	memory_barrier();
+	msg.pos = start + sizeof(printbuf_hdr_t);
+	msg.overflow = msg.pos > msg.limit;
+	ps.data = &msg;
+
+	hdr.stamp = get_cycle();
+	*ret = printf_core(fmt, &ps, ap);
+
+	if (msg.overflow)
+		msg.buf->dropped++;
+	else if (msg.pos > start + sizeof(printbuf_hdr_t)) {
+		hdr.len = msg.pos - start - sizeof(printbuf_hdr_t);
+		printbuf_copy_in(msg.buf, start, &hdr, sizeof(printbuf_hdr_t));
+		/* Publish the message. */
+		write_barrier();
+		msg.buf->head = msg.pos;
+	}
+
+	interrupts_restore(ipl);
+	return true;
+}
+
+/** Print all buffered messages right away.
+ *
+ * Used when the kernel halts. Does nothing if the buffers
+ * are being drained by someone else. Nothing is lost then,
+ * because the direct printf() calls on the halt path wait
+ * for printflock and drain the buffers before printing.
+ */
+void printbuf_flush(void)
+{
+	ipl_t ipl;
+
+	if (!printbuf_active)
+		return;
+
+	ipl = interrupts_disable();
+	if (spinlock_trylock(&printflock)) {
+		printbuf_drain();
+		spinlock_unlock(&printflock);
+	}
+	interrupts_restore(ipl);
+}
+
+/** Print all buffered messages.
+ *
+ * Called before a direct write to the console.
+ * printflock must be held and interrupts disabled.
+ */
+void printbuf_drain(void)
+{
+	if (!printbuf_active)
+		return;
+
+	while (printbuf_drain_one())
+		;
+}
+
+/** Stop buffering output of the thread reading the kernel console.
+ *
+ * @param t Thread reading the kernel console.
+ */
+void printbuf_console_set(thread_t *t)
+{
+	printbuf_console = t;
+}
+
+/** Kernel thread moving buffered messages to the console.
+ *
+ * It also coalesces notifications about new klog records.
+ *
+ * @param arg Not used.
+ */
+void kprintd(void *arg)
+{
+	ipl_t ipl;
+	count_t i;
+	bool more;
+
+	printbuf_active = true;
+
+	while (1) {
+		do {
+			/*
+			 * Give direct printers a chance to get
+			 * printflock between the batches.
+			 */
+			ipl = interrupts_disable();
+			spinlock_lock(&printflock);
+			more = true;
+			for (i = 0; more && (i < PRINTBUF_BATCH); i++)
+				more = printbuf_drain_one();
+			spinlock_unlock(&printflock);
+			interrupts_restore(ipl);
+		} while (more);
+
+		klog_notify();
+		thread_usleep(PRINTBUF_PERIOD);
+	}
+}
+
+/** Print the oldest message of all per-CPU buffers.
+ *
+ * printflock must be held and interrupts disabled.
+ *
+ * @return False if there was no message to print.
+ */
+bool printbuf_drain_one(void)
+{
+	printbuf_t *buf, *oldest = NULL;
+	printbuf_hdr_t hdr, oldest_hdr;
+	__native pos, i;
+
+	for (i = 0; i < config.cpu_count; i++) {
+		buf = &cpus[i].printbuf;
+		if (buf->tail == buf->head)
+			continue;
+		/* Read the message only after it has been published. */
+		read_barrier();
+		printbuf_copy_out(buf, buf->tail, &hdr, sizeof(printbuf_hdr_t));
+		if (!oldest || (hdr.stamp < oldest_hdr.stamp)) {
+			oldest = buf;
+			oldest_hdr = hdr;
+		}
+	}
+
+	if (!oldest)
+		return false;
+
+	pos = oldest->tail + sizeof(printbuf_hdr_t);
+	for (i = 0; i < oldest_hdr.len; i++)
+		putchar(oldest->data[(pos + i) % PRINTBUF_SIZE]);
+
+	/* Release the space only after the message has been read. */
+	memory_barrier();
+	oldest->tail = pos + oldest_hdr.len;
+
+	return true;
+}
+
+/** printf_core() output method for the per-CPU buffers. */
+int printbuf_write(const char *str, size_t count, printbuf_msg_t *msg)
+{
+	if (msg->overflow || (msg->pos + count > msg->limit)) {
+		/* Stop formatting, the message is going to be dropped. */
+		msg->overflow = true;
+		return -1;
+	}
+
+	printbuf_copy_in(msg->buf, msg->pos, str, count);
+	msg->pos += count;
+
+	return count;
+}
+
+/** Copy data into a per-CPU buffer, wrapping around its end. */
+void printbuf_copy_in(printbuf_t *buf, __native pos, const void *src, size_t cnt)
+{
+	index_t offset = pos % PRINTBUF_SIZE;
+	size_t first = min(cnt, PRINTBUF_SIZE - offset);
+
+	memcpy(buf->data + offset, src, first);
+	if (cnt > first)
+		memcpy(buf->data, ((__u8 *) src) + first, cnt - first);
+}
+
+/** Copy data out of a per-CPU buffer, wrapping around its end. */
+void printbuf_copy_out(printbuf_t *buf, __native pos, void *dst, size_t cnt)
+{
+	index_t offset = pos % PRINTBUF_SIZE;
+	size_t first = min(cnt, PRINTBUF_SIZE - offset);
+
+	memcpy(dst, buf->data + offset, first);
+	if (cnt > first)
+		memcpy(((__u8 *) dst) + first, buf->data, cnt - first);
+}
+
+/** Sum dropped messages over all processors. */
+__native printbuf_dropped_sysinfo(sysinfo_item_t *item)
+{
+	__native sum = 0;
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++)
+		sum += cpus[i].printbuf.dropped;
+	return sum;
+}
@@ -41,7 +41,7 @@
 
 #include <arch.h>
 
-SPINLOCK_INITIALIZE(printflock);			/**< printf spinlock */
+SPINLOCK_INITIALIZE(printflock);			/**< Serializes output to the console, see vprintf() */
 
 #define __PRINTF_FLAG_PREFIX		0x00000001	/**< show prefixes 0x or 0*/
 #define __PRINTF_FLAG_SIGNED		0x00000002	/**< signed / unsigned number */
@@ -456,7 +456,6 @@ static int print_number(__u64 num, int width, int precision, int base , __u64 fl
  */
 int printf_core(const char *fmt, struct printf_spec *ps, va_list ap)
 {
-	int irqpri;
 	int i = 0, j = 0; /**< i is index of currently processed char from fmt, j is index to the first not printed nonformating character */
 	int end;
 	int counter; /**< counter of printed characters */
@@ -470,9 +469,6 @@ int printf_core(const char *fmt, struct printf_spec *ps, va_list ap)
 	__u64 flags;
 	
 	counter = 0;
-	
-	irqpri = interrupts_disable();
-	spinlock_lock(&printflock);
 
 	while ((c = fmt[i])) {
 		/* control character */
@@ -710,9 +706,6 @@ next_char:
 	}
 
 out:
-	spinlock_unlock(&printflock);
-	interrupts_restore(irqpri);
-	
 	return counter;
 }
 
@@ -29,6 +29,9 @@
 #include <print.h>
 #include <printf/printf_core.h>
 #include <putchar.h>
+#include <printf/printbuf.h>
+#include <synch/spinlock.h>
+#include <arch/asm.h>
 
 int vprintf_write(const char *str, size_t count, void *unused);
 
@@ -43,7 +46,20 @@ int vprintf_write(const char *str, size_t count, void *unused)
 int vprintf(const char *fmt, va_list ap)
 {
 	struct printf_spec ps = {(int(*)(void *, size_t, void *))vprintf_write, NULL};
-	return printf_core(fmt, &ps, ap);
+	ipl_t ipl;
+	int ret;
+
+	if (printbuf_vprintf(fmt, ap, &ret))
+		return ret;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&printflock);
+	printbuf_drain();
+	ret = printf_core(fmt, &ps, ap);
+	spinlock_unlock(&printflock);
+	interrupts_restore(ipl);
+
+	return ret;
 
 }
 
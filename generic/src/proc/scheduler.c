@@ -55,11 +55,19 @@
 #include <cpu.h>
 #include <print.h>
 #include <debug.h>
+#include <synch/rcu.h>
 
 static void before_task_runs(void);
 static void before_thread_runs(void);
 static void after_thread_ran(void);
 static void scheduler_separated_stack(void);
+static thread_t *try_find_thread(int limit);
+static void thread_continue(void);
+static void direct_switch(thread_t *t);
+static void switch_to_thread(void);
+#ifdef CONFIG_FPU_LAZY
+static void fpu_switch_owner(bool trap);
+#endif
 
 atomic_t nrdy;	/**< Number of ready threads in the system. */
 
@@ -109,10 +117,48 @@ void before_thread_runs(void)
 void after_thread_ran(void)
 {
 	after_thread_ran_arch();
+#ifdef CONFIG_FPU_LAZY
+	/*
+	 * Decide whether the thread's FPU context
+	 * is to be loaded eagerly next time.
+	 */
+	if (THREAD->fpu_trapped) {
+		THREAD->fpu_trapped = false;
+		if (THREAD->fpu_streak < FPU_EAGER_THRESHOLD)
+			THREAD->fpu_streak++;
+	} else if (THREAD->fpu_streak >= FPU_EAGER_THRESHOLD) {
+		/* Give lazy switching another chance from time to time. */
+		if (++THREAD->fpu_streak >= FPU_EAGER_THRESHOLD + FPU_EAGER_PERIOD)
+			THREAD->fpu_streak = 0;
+	} else {
+		THREAD->fpu_streak = 0;
+	}
+#endif
 }
 
 #ifdef CONFIG_FPU_LAZY
+/** Handle FPU trap
+ *
+ * Make THREAD the owner of the FPU
+ * of this CPU.
+ *
+ */
 void scheduler_fpu_lazy_request(void)
+{
+	fpu_switch_owner(true);
+}
+
+/** Make THREAD the owner of the FPU
+ *
+ * Save the context of the current owner
+ * and restore or initialize the context of THREAD.
+ *
+ * @param trap True if called from the FPU trap handler.
+ *             Otherwise THREAD->saved_fpu_context must
+ *             be already allocated.
+ *
+ */
+void fpu_switch_owner(bool trap)
 {
 restart:
 	fpu_enable();
@@ -147,6 +193,10 @@ restart:
 	}
 	CPU->fpu_owner=THREAD;
 	THREAD->fpu_context_engaged = 1;
+	if (trap) {
+		THREAD->fpu_traps++;
+		THREAD->fpu_trapped = true;
+	}
 	spinlock_unlock(&THREAD->lock);
 
 	spinlock_unlock(&CPU->lock);
@@ -174,8 +224,6 @@ void scheduler_init(void)
 static thread_t *find_best_thread(void)
 {
 	thread_t *t;
-	runq_t *r;
-	int i;
 
 	ASSERT(CPU != NULL);
 
@@ -187,7 +235,9 @@ loop:
 		 * For there was nothing to run, the CPU goes to sleep
 		 * until a hardware interrupt or an IPI comes.
 		 * This improves energy saving and hyperthreading.
+		 * An idle CPU must not hold up RCU grace periods.
 		 */
+		rcu_qs();
 
 		/*
 		 * An interrupt might occur right now and wake up a thread.
@@ -201,7 +251,32 @@ loop:
 
 	interrupts_disable();
 	
-	for (i = 0; i<RQ_COUNT; i++) {
+	t = try_find_thread(RQ_COUNT - 1);
+	if (!t)
+		goto loop;
+
+	return t;
+}
+
+/** Take thread from run queues of the current CPU
+ *
+ * Unlike find_best_thread(), this function never
+ * waits for a thread to become ready.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param limit Index of the lowest-priority run queue to look into.
+ *
+ * @return Thread taken from a run queue or NULL if there is none.
+ *
+ */
+static thread_t *try_find_thread(int limit)
+{
+	thread_t *t;
+	runq_t *r;
+	int i;
+
+	for (i = 0; i <= limit; i++) {
 		r = &CPU->rq[i];
 		spinlock_lock(&r->lock);
 		if (r->n == 0) {
@@ -238,8 +313,23 @@ loop:
 
 		return t;
 	}
-	goto loop;
 
+	return NULL;
+}
+
+/** Let the preempted thread continue
+ *
+ * Account THREAD as if it went through its
+ * run queue and was chosen to run again.
+ *
+ * THREAD->lock is locked on entry
+ *
+ */
+void thread_continue(void)
+{
+	if (THREAD->priority < RQ_COUNT - 1)
+		THREAD->priority++;
+	THREAD->ticks = us2ticks((THREAD->priority + 1) * 10000);
 }
 
 /** Prevent rq starvation
@@ -301,9 +391,27 @@ void scheduler(void)
 
 	if (atomic_get(&haltstate))
 		halt();
+
+	/*
+	 * No RCU reader can be running here.
+	 */
+	rcu_qs();
 	
 	if (THREAD) {
 		spinlock_lock(&THREAD->lock);
+
+		/*
+		 * If the preempted thread is the only one ready
+		 * to run on this CPU, it would be picked again.
+		 * Let it continue right away.
+		 */
+		if (THREAD->state == Running && atomic_get(&CPU->nrdy) == 0) {
+			thread_continue();
+			spinlock_unlock(&THREAD->lock);
+			interrupts_restore(ipl);
+			return;
+		}
+
 #ifndef CONFIG_FPU_LAZY
 		fpu_context_save(THREAD->saved_fpu_context);
 #endif
@@ -312,6 +420,7 @@ void scheduler(void)
 			 * This is the place where threads leave scheduler();
 			 */
 			spinlock_unlock(&THREAD->lock);
+			scheduler_finish_switch();
 			interrupts_restore(THREAD->saved_context.ipl);
 			
 			return;
@@ -323,6 +432,27 @@ void scheduler(void)
 		 * code (e.g. waitq_sleep_timeout()). 
 		 */
 		THREAD->saved_context.ipl = ipl;
+
+		if (THREAD->state == Running) {
+			thread_t *t;
+
+			/*
+			 * The preempted thread would be appended to the run
+			 * queue with index one higher than its priority.
+			 * Only threads in that or higher-priority queues
+			 * would be picked before it.
+			 */
+			t = try_find_thread(THREAD->priority < RQ_COUNT - 1 ?
+				THREAD->priority + 1 : THREAD->priority);
+			if (!t) {
+				thread_continue();
+				spinlock_unlock(&THREAD->lock);
+				interrupts_restore(ipl);
+				return;
+			}
+			direct_switch(t);
+			/* not reached */
+		}
 	}
 
 	/*
@@ -444,6 +574,75 @@ repeat:
 
 	relink_rq(priority);		
 
+	switch_to_thread();
+	/* not reached */
+}
+
+/** Switch directly to another thread
+ *
+ * Switch from the preempted THREAD to t without passing
+ * through the scheduler stack. THREAD is put back to a run
+ * queue only by scheduler_finish_switch() once t runs on
+ * its own stack, so that no other CPU can pick THREAD up
+ * while its stack is still in use.
+ *
+ * THREAD->lock is locked on entry
+ *
+ * @param t Thread taken from a run queue of this CPU.
+ *
+ */
+void direct_switch(thread_t *t)
+{
+	after_thread_ran();
+
+	ASSERT(CPU->switch_prev == NULL);
+	CPU->switch_prev = THREAD;
+	spinlock_unlock(&THREAD->lock);
+
+	THREAD = t;
+	switch_to_thread();
+	/* not reached */
+}
+
+/** Finish switch to the current thread
+ *
+ * Called by each thread when it resumes execution
+ * after being switched to. If it was switched to
+ * directly, put the previous thread back to a run queue.
+ * Load FPU context of threads in eager FPU mode.
+ *
+ * Interrupts must be disabled.
+ *
+ */
+void scheduler_finish_switch(void)
+{
+	thread_t *t = CPU->switch_prev;
+
+	if (t) {
+		CPU->switch_prev = NULL;
+		thread_ready(t);
+	}
+
+#ifdef CONFIG_FPU_LAZY
+	/*
+	 * Spare threads that use FPU heavily the FPU trap. This cannot
+	 * be done in before_thread_runs() as it needs CPU->lock.
+	 */
+	if (THREAD != CPU->fpu_owner && THREAD->saved_fpu_context &&
+	    ((THREAD->flags & X_FPU_EAGER) || THREAD->fpu_streak >= FPU_EAGER_THRESHOLD))
+		fpu_switch_owner(false);
+#endif
+}
+
+/** Pass control to THREAD
+ *
+ * Switch task and address space if needed and
+ * restore context of THREAD, which has been
+ * taken from a run queue.
+ *
+ */
+void switch_to_thread(void)
+{
 	/*
 	 * If both the old and the new task are the same, lots of work is avoided.
 	 */
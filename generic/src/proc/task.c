@@ -70,9 +70,6 @@ btree_t tasks_btree;
 
 static task_id_t task_counter = 0;
 
-static void ktaskclnp(void *arg);
-static void ktaskgc(void *arg);
-
 /** Initialize tasks
  *
  * Initialize kernel tasks support.
@@ -111,6 +108,7 @@ task_t *task_create(as_t *as, char *name)
 	ta->name = name;
 	ta->main_thread = NULL;
 	ta->refcount = 0;
+	ta->lifecount = 0;
 
 	ta->capabilities = 0;
 	ta->accept_new_threads = true;
@@ -182,7 +180,7 @@ task_t * task_run_program(void *program_addr, char *name)
 	as_t *as;
 	as_area_t *a;
 	int rc;
-	thread_t *t1, *t2;
+	thread_t *t;
 	task_t *task;
 	uspace_arg_t *kernel_uarg;
 
@@ -214,18 +212,11 @@ task_t * task_run_program(void *program_addr, char *name)
 
 	/*
 	 * Create the main thread.
+	 * The task is killed when it exits, see task_thread_exit().
 	 */
-	t1 = thread_create(uinit, kernel_uarg, task, 0, "uinit");
-	ASSERT(t1);
-	
-	/*
-	 * Create killer thread for the new task.
-	 */
-	t2 = thread_create(ktaskgc, t1, task, 0, "ktaskgc");
-	ASSERT(t2);
-	thread_ready(t2);
-
-	thread_ready(t1);
+	t = thread_create(uinit, kernel_uarg, task, 0, "uinit");
+	ASSERT(t);
+	thread_ready(t);
 
 	return task;
 }
@@ -271,7 +262,6 @@ int task_kill(task_id_t id)
 {
 	ipl_t ipl;
 	task_t *ta;
-	thread_t *t;
 	link_t *cur;
 
 	if (id == 1)
@@ -293,21 +283,20 @@ int task_kill(task_id_t id)
 	btree_remove(&tasks_btree, ta->taskid, NULL);
 	spinlock_unlock(&tasks_lock);
 	
-	t = thread_create(ktaskclnp, NULL, ta, 0, "ktaskclnp");
-	
 	spinlock_lock(&ta->lock);
 	ta->accept_new_threads = false;
 	ta->refcount--;
 
 	/*
 	 * Interrupt all threads except this one.
+	 * The last of them to exit cleans up the task.
 	 */	
 	for (cur = ta->th_head.next; cur != &ta->th_head; cur = cur->next) {
 		thread_t *thr;
 		bool  sleeping = false;
 		
 		thr = list_get_instance(cur, thread_t, th_link);
-		if (thr == t)
+		if (thr == THREAD)
 			continue;
 			
 		spinlock_lock(&thr->lock);
@@ -322,13 +311,50 @@ int task_kill(task_id_t id)
 	
 	spinlock_unlock(&ta->lock);
 	interrupts_restore(ipl);
-	
-	if (t)
-		thread_ready(t);
 
 	return 0;
 }
 
+/** Account for exiting thread of a userspace task.
+ *
+ * Called by each exiting thread of a userspace task (i.e. a task
+ * with its own address space) before it leaves for good.
+ *
+ * Nobody joins userspace threads, so the thread detaches itself
+ * and is destroyed by the scheduler as soon as it exits. When the
+ * main thread exits, the task is killed. The last thread to exit
+ * cleans up IPC and futexes of the task.
+ */
+void task_thread_exit(void)
+{
+	ipl_t ipl;
+	bool last;
+
+	if (TASK->as == AS_KERNEL)
+		return;
+
+	thread_detach(THREAD);
+
+	if (THREAD == TASK->main_thread)
+		task_kill(TASK->taskid);
+
+	ipl = interrupts_disable();
+	spinlock_lock(&TASK->lock);
+	last = (--TASK->lifecount == 0);
+	spinlock_unlock(&TASK->lock);
+	interrupts_restore(ipl);
+
+	if (last) {
+		/*
+		 * No other thread of this task will run any userspace
+		 * code again and no new threads can be created.
+		 */
+		ipc_cleanup();
+		futex_cleanup();
+		klog_printf("Cleanup of task %lld completed.", TASK->taskid);
+	}
+}
+
 /** Print task list */
 void task_print_list(void)
 {
@@ -365,127 +391,3 @@ void task_print_list(void)
 	spinlock_unlock(&tasks_lock);
 	interrupts_restore(ipl);
 }
-
-/** Kernel thread used to cleanup the task after it is killed. */
-void ktaskclnp(void *arg)
-{
-	ipl_t ipl;
-	thread_t *t = NULL, *main_thread;
-	link_t *cur;
-	bool again;
-
-	thread_detach(THREAD);
-
-loop:
-	ipl = interrupts_disable();
-	spinlock_lock(&TASK->lock);
-	
-	main_thread = TASK->main_thread;
-	
-	/*
-	 * Find a thread to join.
-	 */
-	again = false;
-	for (cur = TASK->th_head.next; cur != &TASK->th_head; cur = cur->next) {
-		t = list_get_instance(cur, thread_t, th_link);
-
-		spinlock_lock(&t->lock);
-		if (t == THREAD) {
-			spinlock_unlock(&t->lock);
-			continue;
-		} else if (t == main_thread) {
-			spinlock_unlock(&t->lock);
-			continue;
-		} else if (t->join_type != None) {
-			spinlock_unlock(&t->lock);
-			again = true;
-			continue;
-		} else {
-			t->join_type = TaskClnp;
-			spinlock_unlock(&t->lock);
-			again = false;
-			break;
-		}
-	}
-	
-	spinlock_unlock(&TASK->lock);
-	interrupts_restore(ipl);
-	
-	if (again) {
-		/*
-		 * Other cleanup (e.g. ktaskgc) is in progress.
-		 */
-		scheduler();
-		goto loop;
-	}
-	
-	if (t != THREAD) {
-		ASSERT(t != main_thread);	/* uninit is joined and detached in ktaskgc */
-		thread_join(t);
-		thread_detach(t);
-		goto loop;	/* go for another thread */
-	}
-	
-	/*
-	 * Now there are no other threads in this task
-	 * and no new threads can be created.
-	 */
-	
-	ipc_cleanup();
-	futex_cleanup();
-	klog_printf("Cleanup of task %lld completed.", TASK->taskid);
-}
-
-/** Kernel task used to kill a userspace task when its main thread exits.
- *
- * This thread waits until the main userspace thread (i.e. uninit) exits.
- * When this happens, the task is killed. In the meantime, exited threads
- * are garbage collected.
- *
- * @param arg Pointer to the thread structure of the task's main thread.
- */
-void ktaskgc(void *arg)
-{
-	thread_t *t = (thread_t *) arg;
-loop:	
-	/*
-	 * Userspace threads cannot detach themselves,
-	 * therefore the thread pointer is guaranteed to be valid.
-	 */
-	if (thread_join_timeout(t, 1000000, SYNCH_FLAGS_NONE) == ESYNCH_TIMEOUT) {	/* sleep uninterruptibly here! */
-		ipl_t ipl;
-		link_t *cur;
-		thread_t *thr = NULL;
-	
-		/*
-		 * The join timed out. Try to do some garbage collection of Undead threads.
-		 */
-more_gc:		
-		ipl = interrupts_disable();
-		spinlock_lock(&TASK->lock);
-		
-		for (cur = TASK->th_head.next; cur != &TASK->th_head; cur = cur->next) {
-			thr = list_get_instance(cur, thread_t, th_link);
-			spinlock_lock(&thr->lock);
-			if (thr->state == Undead && thr->join_type == None) {
-				thr->join_type = TaskGC;
-				spinlock_unlock(&thr->lock);
-				break;
-			}
-			spinlock_unlock(&thr->lock);
-			thr = NULL;
-		}
-		spinlock_unlock(&TASK->lock);
-		
-		if (thr) {
-			thread_join(thr);
-			thread_detach(thr);
-			scheduler();
-			goto more_gc;
-		}
-			
-		goto loop;
-	}
-	thread_detach(t);
-	task_kill(TASK->taskid);
-}
@@ -62,6 +62,7 @@
 #include <main/uinit.h>
 #include <syscall/copy.h>
 #include <errno.h>
+#include <fpu_context.h>
 
 
 /** Thread states */
@@ -109,6 +110,7 @@ static void cushion(void)
 
 	/* this is where each thread wakes up after its creation */
 	spinlock_unlock(&THREAD->lock);
+	scheduler_finish_switch();
 	interrupts_enable();
 
 	f(arg);
@@ -116,6 +118,19 @@ static void cushion(void)
 	/* not reached */
 }
 
+#ifdef ARCH_HAS_FPU
+/** Initialization of fpu_context_t structure
+ *
+ * Architectures may require parts of the context
+ * that are not written by save to be zeroed.
+ */
+static int fpu_context_constructor(void *obj, int kmflags)
+{
+	memsetb((__address) obj, FPU_CONTEXT_SIZE, 0);
+	return 0;
+}
+#endif
+
 /** Initialization and allocation for thread_t structure */
 static int thr_constructor(void *obj, int kmflags)
 {
@@ -178,9 +193,9 @@ void thread_init(void)
 					thr_constructor, thr_destructor, 0);
 #ifdef ARCH_HAS_FPU
 	fpu_context_slab = slab_cache_create("fpu_slab",
-					     sizeof(fpu_context_t),
+					     FPU_CONTEXT_SIZE,
 					     FPU_CONTEXT_ALIGN,
-					     NULL, NULL, 0);
+					     fpu_context_constructor, NULL, 0);
 #endif
 
 	btree_create(&threads_btree);
@@ -322,7 +337,7 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task, int flag
 	t->ticks = -1;
 	t->priority = -1;		/* start in rq[0] */
 	t->cpu = NULL;
-	t->flags = 0;
+	t->flags = flags;
 	t->state = Entering;
 	t->call_me = NULL;
 	t->call_me_with = NULL;
@@ -335,8 +350,11 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task, int flag
 	t->in_copy_from_uspace = false;
 	t->in_copy_to_uspace = false;
 
+	t->area_cache = NULL;
+	t->area_cache_gen = 0;
+	memsetb((__address) t->futex_cache, sizeof(t->futex_cache), 0);
+
 	t->interrupted = false;	
-	t->join_type = None;
 	t->detached = false;
 	waitq_initialize(&t->join_wq);
 	
@@ -346,6 +364,9 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task, int flag
 	
 	t->fpu_context_exists = 0;
 	t->fpu_context_engaged = 0;
+	t->fpu_traps = 0;
+	t->fpu_trapped = false;
+	t->fpu_streak = 0;
 	
 	/*
 	 * Attach to the containing task.
@@ -359,6 +380,7 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task, int flag
 	list_append(&t->th_link, &task->th_head);
 	if (task->refcount++ == 0)
 		task->main_thread = t;
+	task->lifecount++;
 	spinlock_unlock(&task->lock);
 
 	/*
@@ -384,6 +406,8 @@ void thread_exit(void)
 {
 	ipl_t ipl;
 
+	task_thread_exit();
+
 restart:
 	ipl = interrupts_disable();
 	spinlock_lock(&THREAD->lock);
@@ -32,7 +32,6 @@
  */
 
 #include <synch/futex.h>
-#include <synch/rwlock.h>
 #include <synch/spinlock.h>
 #include <synch/synch.h>
 #include <mm/frame.h>
@@ -42,45 +41,44 @@
 #include <proc/task.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
-#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <arch.h>
 #include <align.h>
+#include <macros.h>
 #include <panic.h>
 #include <errno.h>
 #include <print.h>
 
 #define FUTEX_HT_SIZE	1024	/* keep it a power of 2 */
 
+
 static void futex_initialize(futex_t *futex);
 
+static int futex_paddr(__address uaddr, __address *paddr);
 static futex_t *futex_find(__address paddr);
-static index_t futex_ht_hash(__native *key);
-static bool futex_ht_compare(__native *key, count_t keys, link_t *item);
-static void futex_ht_remove_callback(link_t *item);
+static futex_t *futex_get(__address paddr);
+static index_t futex_ht_hash(__address paddr);
+static futex_t *futex_bucket_find(futex_bucket_t *bucket, __address paddr);
 
 /**
- * Read-write lock protecting global futex hash table.
- * It is also used to serialize access to all futex_t structures.
- * Must be acquired before the task futex B+tree lock.
+ * Global futex hash table.
+ *
+ * Each bucket has its own spinlock, which protects the list of futexes
+ * in the bucket and their reference counts. The bucket lock must be
+ * acquired after the task futex B+tree lock.
  */
-static rwlock_t futex_ht_lock;
-
-/** Futex hash table. */
-static hash_table_t futex_ht;
+static futex_bucket_t futex_ht[FUTEX_HT_SIZE];
 
-/** Futex hash table operations. */
-static hash_table_operations_t futex_ht_ops = {
-	.hash = futex_ht_hash,
-	.compare = futex_ht_compare,
-	.remove_callback = futex_ht_remove_callback
-};
 
 /** Initialize futex subsystem. */
 void futex_init(void)
 {
-	rwlock_initialize(&futex_ht_lock);
-	hash_table_create(&futex_ht, FUTEX_HT_SIZE, 1, &futex_ht_ops);
+	int i;
+
+	for (i = 0; i < FUTEX_HT_SIZE; i++) {
+		spinlock_initialize(&futex_ht[i].lock, "futex_bucket_lock");
+		list_initialize(&futex_ht[i].head);
+	}
 }
 
 /** Initialize kernel futex structure.
@@ -95,44 +93,101 @@ void futex_initialize(futex_t *futex)
 	futex->refcount = 1;
 }
 
-/** Sleep in futex wait queue.
+/** Find physical address of futex counter.
  *
  * @param uaddr Userspace address of the futex counter.
- * @param usec If non-zero, number of microseconds this thread is willing to sleep.
- * @param flags Select mode of operation.
+ * @param paddr Place to store the physical address.
  *
- * @return One of ESYNCH_TIMEOUT, ESYNCH_OK_ATOMIC and ESYNCH_OK_BLOCKED. See synch.h.
- *	   If there is no physical mapping for uaddr ENOENT is returned.
+ * @return Zero on success or ENOENT if there is no physical mapping for uaddr.
  */
-__native sys_futex_sleep_timeout(__address uaddr, __u32 usec, int flags)
+int futex_paddr(__address uaddr, __address *paddr)
 {
-	futex_t *futex;
-	__address paddr;
 	pte_t *t;
+	size_t size;
 	ipl_t ipl;
 	
 	ipl = interrupts_disable();
 
-	/*
-	 * Find physical address of futex counter.
-	 */
 	page_table_lock(AS, true);
-	t = page_mapping_find(AS, ALIGN_DOWN(uaddr, PAGE_SIZE));
+	t = page_mapping_find_size(AS, ALIGN_DOWN(uaddr, PAGE_SIZE), &size);
 	if (!t || !PTE_VALID(t) || !PTE_PRESENT(t)) {
 		page_table_unlock(AS, true);
 		interrupts_restore(ipl);
-		return (__native) ENOENT;
+		return ENOENT;
 	}
-	paddr = PTE_GET_FRAME(t) + (uaddr - ALIGN_DOWN(uaddr, PAGE_SIZE));
+	*paddr = PTE_GET_FRAME(t) + (uaddr - ALIGN_DOWN(uaddr, size));
 	page_table_unlock(AS, true);
 	
-	interrupts_restore(ipl);	
+	interrupts_restore(ipl);
+
+	return 0;
+}
+
+/** Sleep in futex wait queue.
+ *
+ * @param uaddr Userspace address of the futex counter.
+ * @param usec If non-zero, number of microseconds this thread is willing to sleep.
+ * @param flags Select mode of operation.
+ *
+ * @return One of ESYNCH_TIMEOUT, ESYNCH_OK_ATOMIC and ESYNCH_OK_BLOCKED. See synch.h.
+ *	   If there is no physical mapping for uaddr ENOENT is returned.
+ */
+__native sys_futex_sleep_timeout(__address uaddr, __u32 usec, int flags)
+{
+	futex_t *futex;
+	__address paddr;
+
+	if (futex_paddr(uaddr, &paddr))
+		return (__native) ENOENT;
 
 	futex = futex_find(paddr);
 	
 	return (__native) waitq_sleep_timeout(&futex->wq, usec, flags | SYNCH_FLAGS_INTERRUPTIBLE);
 }
 
+/** Sleep in futex wait queue if the futex counter has the expected value.
+ *
+ * The counter is read with the futex wait queue locked, so a thread
+ * that changes the counter and then wakes the futex up cannot slip
+ * in between the check and the sleep.
+ *
+ * @param uaddr Userspace address of the futex counter. Must be aligned.
+ * @param expected Expected value of the futex counter.
+ * @param usec If non-zero, number of microseconds this thread is willing to sleep.
+ * @param flags Select mode of operation.
+ *
+ * @return ESYNCH_WOULD_BLOCK if the counter does not have the expected value.
+ *	   Otherwise see sys_futex_sleep_timeout(). EINVAL if uaddr is not aligned.
+ */
+__native sys_futex_sleep_compare(__address uaddr, __native expected, __u32 usec, int flags)
+{
+	futex_t *futex;
+	__address paddr;
+	ipl_t ipl;
+	int rc;
+
+	if (ALIGN_DOWN(uaddr, sizeof(__native)) != uaddr)
+		return (__native) EINVAL;
+
+	if (futex_paddr(uaddr, &paddr))
+		return (__native) ENOENT;
+
+	futex = futex_find(paddr);
+
+	ipl = waitq_sleep_prepare(&futex->wq);
+	/*
+	 * The counter is read through the kernel mapping of its frame,
+	 * which cannot fault while the wait queue is locked.
+	 */
+	if (*((volatile __native *) PA2KA(paddr)) != expected)
+		rc = ESYNCH_WOULD_BLOCK;
+	else
+		rc = waitq_sleep_timeout_unsafe(&futex->wq, usec, flags | SYNCH_FLAGS_INTERRUPTIBLE);
+	waitq_sleep_finish(&futex->wq, rc, ipl);
+
+	return (__native) rc;
+}
+
 /** Wakeup one thread waiting in futex wait queue.
  *
  * @param uaddr Userspace address of the futex counter.
@@ -143,25 +198,9 @@ __native sys_futex_wakeup(__address uaddr)
 {
 	futex_t *futex;
 	__address paddr;
-	pte_t *t;
-	ipl_t ipl;
-	
-	ipl = interrupts_disable();
-	
-	/*
-	 * Find physical address of futex counter.
-	 */
-	page_table_lock(AS, true);
-	t = page_mapping_find(AS, ALIGN_DOWN(uaddr, PAGE_SIZE));
-	if (!t || !PTE_VALID(t) || !PTE_PRESENT(t)) {
-		page_table_unlock(AS, true);
-		interrupts_restore(ipl);
+
+	if (futex_paddr(uaddr, &paddr))
 		return (__native) ENOENT;
-	}
-	paddr = PTE_GET_FRAME(t) + (uaddr - ALIGN_DOWN(uaddr, PAGE_SIZE));
-	page_table_unlock(AS, true);
-	
-	interrupts_restore(ipl);
 
 	futex = futex_find(paddr);
 		
@@ -170,146 +209,201 @@ __native sys_futex_wakeup(__address uaddr)
 	return 0;
 }
 
+/** Wakeup several threads waiting in futex wait queue.
+ *
+ * Unlike with sys_futex_wakeup(), wakeups that do not find a sleeping
+ * thread are not remembered. Threads that must not miss the wakeup
+ * are expected to sleep with sys_futex_sleep_compare().
+ *
+ * @param uaddr Userspace address of the futex counter.
+ * @param count Maximum number of threads to wake up. It is clamped to FUTEX_COUNT_MAX.
+ *
+ * @return Number of threads woken up or ENOENT if there is no physical mapping for uaddr.
+ */
+__native sys_futex_wakeup_n(__address uaddr, count_t count)
+{
+	futex_t *futex;
+	__address paddr;
+
+	if (futex_paddr(uaddr, &paddr))
+		return (__native) ENOENT;
+
+	futex = futex_find(paddr);
+
+	return (__native) waitq_wakeup_n(&futex->wq, min(count, FUTEX_COUNT_MAX));
+}
+
+/** Wakeup threads waiting in one futex and move the rest to another.
+ *
+ * The moved threads are not woken up. This is useful for broadcasting
+ * a condition variable, when only one of the waiters can get the
+ * associated mutex anyway.
+ *
+ * @param uaddr Userspace address of the futex counter to wake up.
+ * @param uaddr2 Userspace address of the futex counter to move the threads to.
+ * @param count Maximum number of threads to wake up on uaddr. It is clamped to FUTEX_COUNT_MAX.
+ * @param move Maximum number of threads to move to uaddr2. It is clamped to FUTEX_COUNT_MAX.
+ *
+ * @return Number of threads moved or ENOENT if there is no physical
+ *	   mapping for uaddr or uaddr2.
+ */
+__native sys_futex_requeue(__address uaddr, __address uaddr2, count_t count, count_t move)
+{
+	futex_t *futex, *futex2;
+	__address paddr, paddr2;
+
+	if (futex_paddr(uaddr, &paddr) || futex_paddr(uaddr2, &paddr2))
+		return (__native) ENOENT;
+
+	futex = futex_find(paddr);
+	futex2 = futex_find(paddr2);
+
+	(void) waitq_wakeup_n(&futex->wq, min(count, FUTEX_COUNT_MAX));
+
+	return (__native) waitq_requeue(&futex->wq, &futex2->wq, min(move, FUTEX_COUNT_MAX));
+}
+
 /** Find kernel address of the futex structure corresponding to paddr.
  *
  * If the structure does not exist already, a new one is created.
  *
+ * The per-thread futex cache is consulted first, then the B+tree
+ * of futexes known to the current task. Only futexes new to the
+ * task are looked up in the global hash table.
+ *
  * @param paddr Physical address of the userspace futex counter.
  *
  * @return Address of the kernel futex structure.
  */
 futex_t *futex_find(__address paddr)
 {
-	link_t *item;
+	index_t slot = futex_ht_hash(paddr) & (THREAD_FUTEX_CACHE - 1);
 	futex_t *futex;
 	btree_node_t *leaf;
-	
-	/*
-	 * Find the respective futex structure
-	 * or allocate new one if it does not exist already.
-	 */
-	rwlock_read_lock(&futex_ht_lock);
-	item = hash_table_find(&futex_ht, &paddr);
-	if (item) {
-		futex = hash_table_get_instance(item, futex_t, ht_link);
-
-		/*
-		 * See if the current task knows this futex.
-		 */
-		mutex_lock(&TASK->futexes_lock);
-		if (!btree_search(&TASK->futexes, paddr, &leaf)) {
-			/*
-			 * The futex is new to the current task.
-			 * However, we only have read access.
-			 * Gain write access and try again.
-			 */
-			mutex_unlock(&TASK->futexes_lock);
-			goto gain_write_access;
-		}
-		mutex_unlock(&TASK->futexes_lock);
 
-		rwlock_read_unlock(&futex_ht_lock);
-	} else {
-gain_write_access:
-		/*
-		 * Upgrade to writer is not currently supported,
-		 * therefore, it is necessary to release the read lock
-		 * and reacquire it as a writer.
-		 */
-		rwlock_read_unlock(&futex_ht_lock);
+	if (THREAD->futex_cache[slot].futex && THREAD->futex_cache[slot].paddr == paddr)
+		return THREAD->futex_cache[slot].futex;
 
-		rwlock_write_lock(&futex_ht_lock);
+	mutex_lock(&TASK->futexes_lock);
+	futex = (futex_t *) btree_search(&TASK->futexes, paddr, &leaf);
+	if (!futex) {
 		/*
-		 * Avoid possible race condition by searching
-		 * the hash table once again with write access.
+		 * The futex is new to the current task.
+		 * Take a reference and put it to the current
+		 * task's B+tree of known futexes.
 		 */
-		item = hash_table_find(&futex_ht, &paddr);
-		if (item) {
-			futex = hash_table_get_instance(item, futex_t, ht_link);
-			
-			/*
-			 * See if this futex is known to the current task.
-			 */
-			mutex_lock(&TASK->futexes_lock);
-			if (!btree_search(&TASK->futexes, paddr, &leaf)) {
-				/*
-				 * The futex is new to the current task.
-				 * Upgrade its reference count and put it to the
-				 * current task's B+tree of known futexes.
-				 */
-				futex->refcount++;
-				btree_insert(&TASK->futexes, paddr, futex, leaf);
-			}
-			mutex_unlock(&TASK->futexes_lock);
-	
-			rwlock_write_unlock(&futex_ht_lock);
-		} else {
-			futex = (futex_t *) malloc(sizeof(futex_t), 0);
-			futex_initialize(futex);
-			futex->paddr = paddr;
-			hash_table_insert(&futex_ht, &paddr, &futex->ht_link);
-			
-			/*
-			 * This is the first task referencing the futex.
-			 * It can be directly inserted into its
-			 * B+tree of known futexes.
-			 */
-			mutex_lock(&TASK->futexes_lock);
-			btree_insert(&TASK->futexes, paddr, futex, NULL);
-			mutex_unlock(&TASK->futexes_lock);
-			
-			rwlock_write_unlock(&futex_ht_lock);
-		}
+		futex = futex_get(paddr);
+		btree_insert(&TASK->futexes, paddr, futex, leaf);
 	}
-	
+	mutex_unlock(&TASK->futexes_lock);
+
+	THREAD->futex_cache[slot].paddr = paddr;
+	THREAD->futex_cache[slot].futex = futex;
+
 	return futex;
 }
 
-/** Compute hash index into futex hash table.
+/** Get reference to the futex corresponding to paddr from the global hash table.
  *
- * @param key Address where the key (i.e. physical address of futex counter) is stored.
+ * If the futex does not exist already, a new one is created.
  *
- * @return Index into futex hash table.
+ * @param paddr Physical address of the userspace futex counter.
+ *
+ * @return Address of the kernel futex structure with the reference count
+ *	   already incremented on behalf of the caller.
  */
-index_t futex_ht_hash(__native *key)
+futex_t *futex_get(__address paddr)
 {
-	return *key & (FUTEX_HT_SIZE-1);
+	futex_bucket_t *bucket = &futex_ht[futex_ht_hash(paddr)];
+	futex_t *futex, *new = NULL;
+	ipl_t ipl;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&bucket->lock);
+	futex = futex_bucket_find(bucket, paddr);
+	if (futex) {
+		futex->refcount++;
+		spinlock_unlock(&bucket->lock);
+		interrupts_restore(ipl);
+		return futex;
+	}
+	spinlock_unlock(&bucket->lock);
+	interrupts_restore(ipl);
+
+	/*
+	 * The allocation may block, so it cannot be done
+	 * with the bucket lock held. Search again afterwards
+	 * as someone else might have created the futex meanwhile.
+	 */
+	new = (futex_t *) malloc(sizeof(futex_t), 0);
+	futex_initialize(new);
+	new->paddr = paddr;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&bucket->lock);
+	futex = futex_bucket_find(bucket, paddr);
+	if (futex) {
+		futex->refcount++;
+	} else {
+		futex = new;
+		new = NULL;
+		list_append(&futex->ht_link, &bucket->head);
+	}
+	spinlock_unlock(&bucket->lock);
+	interrupts_restore(ipl);
+
+	if (new)
+		free(new);
+
+	return futex;
 }
 
-/** Compare futex hash table item with a key.
+/** Find futex in a bucket of the global hash table.
  *
- * @param key Address where the key (i.e. physical address of futex counter) is stored.
+ * The bucket lock must be held.
  *
- * @return True if the item matches the key. False otherwise.
+ * @param bucket Bucket of the global hash table.
+ * @param paddr Physical address of the userspace futex counter.
+ *
+ * @return Futex structure or NULL if it is not in the bucket.
  */
-bool futex_ht_compare(__native *key, count_t keys, link_t *item)
+futex_t *futex_bucket_find(futex_bucket_t *bucket, __address paddr)
 {
+	link_t *cur;
 	futex_t *futex;
 
-	ASSERT(keys == 1);
+	for (cur = bucket->head.next; cur != &bucket->head; cur = cur->next) {
+		futex = list_get_instance(cur, futex_t, ht_link);
+		if (futex->paddr == paddr)
+			return futex;
+	}
 
-	futex = hash_table_get_instance(item, futex_t, ht_link);
-	return *key == futex->paddr;
+	return NULL;
 }
 
-/** Callback for removal items from futex hash table.
+/** Compute hash index into futex hash table.
+ *
+ * @param paddr Physical address of futex counter.
  *
- * @param item Item removed from the hash table.
+ * @return Index into futex hash table.
  */
-void futex_ht_remove_callback(link_t *item)
+index_t futex_ht_hash(__address paddr)
 {
-	futex_t *futex;
-
-	futex = hash_table_get_instance(item, futex_t, ht_link);
-	free(futex);
+	/* Futex counters are word-aligned, mix in the frame number. */
+	return ((paddr / sizeof(__native)) ^ (paddr >> FRAME_WIDTH)) & (FUTEX_HT_SIZE-1);
 }
 
 /** Remove references from futexes known to the current task. */
 void futex_cleanup(void)
 {
+#ifdef CONFIG_SMP
+	futex_bucket_t *bucket;
+#endif
+	futex_t *ftx;
 	link_t *cur;
+	bool last;
+	ipl_t ipl;
 	
-	rwlock_write_lock(&futex_ht_lock);
 	mutex_lock(&TASK->futexes_lock);
 
 	for (cur = TASK->futexes.leaf_head.next; cur != &TASK->futexes.leaf_head; cur = cur->next) {
@@ -318,15 +412,103 @@ void futex_cleanup(void)
 		
 		node = list_get_instance(cur, btree_node_t, leaf_link);
 		for (i = 0; i < node->keys; i++) {
-			futex_t *ftx;
-			__address paddr = node->key[i];
-			
 			ftx = (futex_t *) node->value[i];
-			if (--ftx->refcount == 0)
-				hash_table_remove(&futex_ht, &paddr, 1);
+#ifdef CONFIG_SMP
+			bucket = &futex_ht[futex_ht_hash(ftx->paddr)];
+#endif
+
+			ipl = interrupts_disable();
+			spinlock_lock(&bucket->lock);
+			last = (--ftx->refcount == 0);
+			if (last)
+				list_remove(&ftx->ht_link);
+			spinlock_unlock(&bucket->lock);
+			interrupts_restore(ipl);
+
+			if (last)
+				free(ftx);
 		}
 	}
 	
 	mutex_unlock(&TASK->futexes_lock);
-	rwlock_write_unlock(&futex_ht_lock);
 }
+
+#ifdef CONFIG_TEST
+/** Count threads sleeping in futex wait queue.
+ *
+ * @param uaddr Address of the futex counter.
+ *
+ * @return Number of threads in the wait queue.
+ */
+count_t futex_sleepers(__address uaddr)
+{
+	futex_t *futex;
+	__address paddr;
+	link_t *cur;
+	count_t n = 0;
+	ipl_t ipl;
+
+	if (futex_paddr(uaddr, &paddr))
+		return 0;
+	futex = futex_find(paddr);
+
+	ipl = interrupts_disable();
+	spinlock_lock(&futex->wq.lock);
+	for (cur = futex->wq.head.next; cur != &futex->wq.head; cur = cur->next)
+		n++;
+	spinlock_unlock(&futex->wq.lock);
+	interrupts_restore(ipl);
+
+	return n;
+}
+
+/** Remove reference of the current task from futex.
+ *
+ * Kernel tests use futexes on kernel addresses and the kernel
+ * task never exits to release them in futex_cleanup(). No other
+ * thread of the task may use the futex anymore.
+ *
+ * @param uaddr Address of the futex counter.
+ */
+void futex_forget(__address uaddr)
+{
+#ifdef CONFIG_SMP
+	futex_bucket_t *bucket;
+#endif
+	btree_node_t *leaf;
+	futex_t *futex;
+	__address paddr;
+	index_t slot;
+	bool last;
+	ipl_t ipl;
+
+	if (futex_paddr(uaddr, &paddr))
+		return;
+
+	slot = futex_ht_hash(paddr) & (THREAD_FUTEX_CACHE - 1);
+	if (THREAD->futex_cache[slot].paddr == paddr)
+		THREAD->futex_cache[slot].futex = NULL;
+
+	mutex_lock(&TASK->futexes_lock);
+	futex = (futex_t *) btree_search(&TASK->futexes, paddr, &leaf);
+	if (futex)
+		btree_remove(&TASK->futexes, paddr, leaf);
+	mutex_unlock(&TASK->futexes_lock);
+	if (!futex)
+		return;
+
+#ifdef CONFIG_SMP
+	bucket = &futex_ht[futex_ht_hash(paddr)];
+#endif
+	ipl = interrupts_disable();
+	spinlock_lock(&bucket->lock);
+	last = (--futex->refcount == 0);
+	if (last)
+		list_remove(&futex->ht_link);
+	spinlock_unlock(&bucket->lock);
+	interrupts_restore(ipl);
+
+	if (last)
+		free(futex);
+}
+#endif /* CONFIG_TEST */
@@ -34,6 +34,10 @@
 #include <synch/mutex.h>
 #include <synch/semaphore.h>
 #include <synch/synch.h>
+#include <proc/thread.h>
+#include <arch.h>
+
+static bool mutex_spin(mutex_t *mtx);
 
 /** Initialize mutex
  *
@@ -44,6 +48,53 @@
 void mutex_initialize(mutex_t *mtx)
 {
 	semaphore_initialize(&mtx->sem, 1);
+	mtx->owner = NULL;
+	mtx->acquired = 0;
+	mtx->contended = 0;
+	mtx->spun = 0;
+	mtx->slept = 0;
+}
+
+/** Spin on mutex while its owner is running
+ *
+ * Poll the mutex for as long as its owner is running on another
+ * CPU and is therefore likely to release the mutex soon. Give up
+ * after MUTEX_SPIN_MAX polls, as soon as the owner is preempted
+ * or goes to sleep, or when there is no owner to watch.
+ *
+ * The owner is read without any lock. Even if it exits and its
+ * thread structure is freed in the meantime, the structure stays
+ * mapped in the kernel address space and reading a stale value
+ * can only shorten or prolong the bounded spin.
+ *
+ * @param mtx Mutex.
+ *
+ * @return True if the mutex was acquired, false otherwise.
+ */
+bool mutex_spin(mutex_t *mtx)
+{
+	volatile thread_t *owner;
+	volatile waitq_t *wq = &mtx->sem.wq;
+	int i;
+
+	for (i = 0; i < MUTEX_SPIN_MAX; i++) {
+		owner = mtx->owner;
+		if (!owner) {
+			/*
+			 * The mutex has just been released or its new
+			 * holder has not recorded itself yet. Try to
+			 * grab it once, but only if it looks free, so
+			 * that spinners do not hammer the wait queue
+			 * lock. There is nobody to watch afterwards.
+			 */
+			return wq->missed_wakeups &&
+			    semaphore_trydown(&mtx->sem) == ESYNCH_OK_ATOMIC;
+		}
+		if (owner->state != Running || owner->cpu == CPU)
+			break;
+	}
+
+	return false;
 }
 
 /** Acquire mutex
@@ -51,6 +102,9 @@ void mutex_initialize(mutex_t *mtx)
  * Acquire mutex.
  * Timeout mode and non-blocking mode can be requested.
  *
+ * If the mutex is held by a thread running on another CPU,
+ * spin for a short while before going to sleep.
+ *
  * @param mtx Mutex.
  * @param usec Timeout in microseconds.
  * @param flags Specify mode of operation.
@@ -62,7 +116,33 @@ void mutex_initialize(mutex_t *mtx)
  */
 int _mutex_lock_timeout(mutex_t *mtx, __u32 usec, int flags)
 {
-	return _semaphore_down_timeout(&mtx->sem, usec, flags);
+	int rc;
+
+	rc = semaphore_trydown(&mtx->sem);
+	if (rc == ESYNCH_OK_ATOMIC) {
+		mtx->owner = THREAD;
+		mtx->acquired++;
+		return rc;
+	}
+
+	if (usec == SYNCH_NO_TIMEOUT && (flags & SYNCH_FLAGS_NON_BLOCKING))
+		return rc;
+
+	if (THREAD && mutex_spin(mtx)) {
+		rc = ESYNCH_OK_ATOMIC;
+		mtx->spun++;
+	} else {
+		rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+		if (SYNCH_FAILED(rc))
+			return rc;
+		if (rc == ESYNCH_OK_BLOCKED)
+			mtx->slept++;
+	}
+
+	mtx->owner = THREAD;
+	mtx->acquired++;
+	mtx->contended++;
+	return rc;
 }
 
 /** Release mutex
@@ -73,6 +153,7 @@ int _mutex_lock_timeout(mutex_t *mtx, __u32 usec, int flags)
  */
 void mutex_unlock(mutex_t *mtx)
 {
+	mtx->owner = NULL;
 	semaphore_up(&mtx->sem);
 }
 
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	rcu.c
+ * @brief	Read-copy-update.
+ *
+ * Readers of an RCU-protected structure only disable preemption.
+ * Writers unlink an element and pass it to call_rcu(), which runs
+ * the callback once every CPU has passed through a quiescent state,
+ * i.e. a call to scheduler() or the idle loop. No reader that could
+ * still see the element is running at that point.
+ *
+ * Callbacks are queued per CPU. When a CPU has callbacks and no
+ * batch waiting, it requests a grace period that starts after the
+ * callbacks were queued and moves them to its cur list. The wired
+ * krcud thread of the CPU runs the batch once that grace period
+ * has completed.
+ */
+
+#include <synch/rcu.h>
+#include <synch/spinlock.h>
+#include <synch/waitq.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <print.h>
+#include <proc/thread.h>
+
+SPINLOCK_INITIALIZE(rcu_lock);		/**< Protects the grace period state below. */
+
+static volatile __u64 rcu_gp_cur = 0;	/**< Last started grace period. */
+static volatile __u64 rcu_gp_done = 0;	/**< Last completed grace period. */
+static __u64 rcu_gp_req = 0;		/**< Last requested grace period. */
+static count_t rcu_gp_pending = 0;	/**< CPUs the current grace period waits for. */
+static __u64 rcu_gp_started;		/**< Cycle count at the start of the current grace period. */
+
+/** Grace period latency statistics, protected by rcu_lock. */
+static __u64 rcu_gp_count = 0;
+static __u64 rcu_gp_cycles = 0;
+static __u64 rcu_gp_max = 0;
+
+/** Synchronous wait for a grace period. */
+typedef struct {
+	rcu_head_t head;
+	waitq_t wq;
+} rcu_sync_t;
+
+static void rcu_gp_begin(void);
+static void rcu_gp_end(void);
+static __u64 rcu_gp_request(void);
+static void rcu_batch(void);
+static rcu_head_t *rcu_advance(void);
+static void rcu_sync_wakeup(rcu_head_t *head);
+
+/** Initialize RCU
+ *
+ * Must be called after the cpus array is allocated.
+ */
+void rcu_init(void)
+{
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++) {
+		cpus[i].rcu.qs_needed = false;
+		cpus[i].rcu.next = NULL;
+		cpus[i].rcu.next_tail = &cpus[i].rcu.next;
+		cpus[i].rcu.cur = NULL;
+	}
+}
+
+/** Start new grace period
+ *
+ * The grace period waits for all CPUs active at this moment.
+ * CPUs activated later cannot hold references from before.
+ *
+ * rcu_lock must be held and interrupts disabled.
+ */
+void rcu_gp_begin(void)
+{
+	int i;
+
+	rcu_gp_cur++;
+	rcu_gp_started = get_cycle();
+	rcu_gp_pending = 0;
+	for (i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].active)
+			continue;
+		cpus[i].rcu.qs_needed = true;
+		rcu_gp_pending++;
+	}
+}
+
+/** Finish current grace period
+ *
+ * Start the next one if it has already been requested.
+ *
+ * rcu_lock must be held and interrupts disabled.
+ */
+void rcu_gp_end(void)
+{
+	__u64 cycles;
+
+	cycles = get_cycle() - rcu_gp_started;
+	rcu_gp_count++;
+	rcu_gp_cycles += cycles;
+	if (cycles > rcu_gp_max)
+		rcu_gp_max = cycles;
+
+	rcu_gp_done = rcu_gp_cur;
+	if (rcu_gp_req > rcu_gp_cur)
+		rcu_gp_begin();
+}
+
+/** Request grace period
+ *
+ * rcu_lock must be held and interrupts disabled.
+ *
+ * @return Number of a grace period which starts after this call.
+ */
+__u64 rcu_gp_request(void)
+{
+	__u64 gp;
+
+	if (rcu_gp_done == rcu_gp_cur) {
+		rcu_gp_begin();
+		gp = rcu_gp_cur;
+	} else {
+		/*
+		 * The current grace period may have started
+		 * before the callbacks were queued.
+		 */
+		gp = rcu_gp_cur + 1;
+	}
+
+	if (rcu_gp_req < gp)
+		rcu_gp_req = gp;
+	
+	return gp;
+}
+
+/** Report quiescent state of the current CPU
+ *
+ * Called from scheduler() and from the idle loop,
+ * where no RCU reader can be running on the CPU.
+ */
+void rcu_qs(void)
+{
+	ipl_t ipl;
+
+	if (!CPU->rcu.qs_needed)
+		return;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&rcu_lock);
+	if (CPU->rcu.qs_needed) {
+		CPU->rcu.qs_needed = false;
+		if (!--rcu_gp_pending)
+			rcu_gp_end();
+	}
+	spinlock_unlock(&rcu_lock);
+	interrupts_restore(ipl);
+}
+
+/** Make queued callbacks of the current CPU wait for a grace period
+ *
+ * Interrupts must be disabled.
+ */
+void rcu_batch(void)
+{
+	rcu_cpu_t *rc = &CPU->rcu;
+
+	if (rc->cur || !rc->next)
+		return;
+
+	rc->cur = rc->next;
+	rc->next = NULL;
+	rc->next_tail = &rc->next;
+
+	spinlock_lock(&rcu_lock);
+	rc->cur_gp = rcu_gp_request();
+	spinlock_unlock(&rcu_lock);
+}
+
+/** Advance callbacks of the current CPU
+ *
+ * Interrupts must be disabled.
+ *
+ * @return List of callbacks whose grace period has completed.
+ */
+rcu_head_t *rcu_advance(void)
+{
+	rcu_cpu_t *rc = &CPU->rcu;
+	rcu_head_t *done = NULL;
+
+	if (rc->cur && rcu_gp_done >= rc->cur_gp) {
+		done = rc->cur;
+		rc->cur = NULL;
+	}
+	rcu_batch();
+
+	return done;
+}
+
+/** Run callback after grace period
+ *
+ * The callback is run by krcud of the current CPU once all
+ * readers which could have seen the structure have finished.
+ *
+ * @param head Callback structure embedded in the reclaimed structure.
+ * @param func Callback function.
+ */
+void call_rcu(rcu_head_t *head, rcu_func_t func)
+{
+	ipl_t ipl;
+
+	head->next = NULL;
+	head->func = func;
+
+	ipl = interrupts_disable();
+	*CPU->rcu.next_tail = head;
+	CPU->rcu.next_tail = &head->next;
+	rcu_batch();
+	interrupts_restore(ipl);
+}
+
+/** Wake up rcu_synchronize() caller. */
+void rcu_sync_wakeup(rcu_head_t *head)
+{
+	rcu_sync_t *sync = (rcu_sync_t *) head;
+
+	waitq_wakeup(&sync->wq, WAKEUP_FIRST);
+}
+
+/** Wait for grace period
+ *
+ * Sleep until all readers running at the time
+ * of the call have finished.
+ */
+void rcu_synchronize(void)
+{
+	rcu_sync_t sync;
+	ipl_t ipl;
+
+	waitq_initialize(&sync.wq);
+	call_rcu(&sync.head, rcu_sync_wakeup);
+	waitq_sleep(&sync.wq);
+
+	/*
+	 * Make sure the waker has left waitq_wakeup()
+	 * before the wait queue goes out of scope.
+	 */
+	ipl = interrupts_disable();
+	spinlock_lock(&sync.wq.lock);
+	spinlock_unlock(&sync.wq.lock);
+	interrupts_restore(ipl);
+}
+
+/** Per-CPU thread running RCU callbacks
+ *
+ * The thread must be wired to its CPU.
+ *
+ * @param arg Ignored.
+ */
+void krcud(void *arg)
+{
+	rcu_head_t *done, *next;
+	ipl_t ipl;
+
+	while (1) {
+		thread_usleep(RCU_PERIOD);
+
+		ipl = interrupts_disable();
+		done = rcu_advance();
+		interrupts_restore(ipl);
+
+		for (; done; done = next) {
+			next = done->next;
+			done->func(done);
+		}
+	}
+}
+
+/** Print grace period statistics. */
+void rcu_print(void)
+{
+	ipl_t ipl;
+	__u64 cur, done, count, cycles, max;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&rcu_lock);
+	cur = rcu_gp_cur;
+	done = rcu_gp_done;
+	count = rcu_gp_count;
+	cycles = rcu_gp_cycles;
+	max = rcu_gp_max;
+	spinlock_unlock(&rcu_lock);
+	interrupts_restore(ipl);
+
+	printf("grace periods: started %lld, completed %lld\n", cur, done);
+	if (count)
+		printf("latency: average %lld cycles, max %lld cycles\n", cycles / count, max);
+}
@@ -40,6 +40,23 @@
  * If there is a writer followed by a reader waiting for the rwlock
  * and the writer times out, all leading readers are automatically woken up
  * and allowed in.
+ *
+ * Readers in the critical section are counted in per-CPU counters.
+ * As long as there is no writer, a reader only increments the counter
+ * of its CPU and enters. Once a writer announces itself in rwl->writers,
+ * new readers queue on the exclusive mutex behind it, pass the direct
+ * hand-off and only then increment their counter. The writer holding
+ * the exclusive mutex waits on rwl->drain until all counters sum up to
+ * zero.
+ *
+ * A reader may migrate while in the critical section and decrement
+ * the counter of another CPU when it leaves. The writer reads the
+ * counters one by one, so it may see such a decrement without the
+ * matching increment only if the increment happened after the writer
+ * had announced itself. Such a reader backs out on the fast path
+ * and it does so with preemption disabled, decrementing the counter
+ * it has incremented. The sum seen by the writer therefore never
+ * drops below the number of readers inside.
  */
 
 /*
@@ -51,35 +68,144 @@
  * to store the rwlock type in the thread structure, because
  * each thread can block on only one rwlock at a time.
  */
+
+/*
+ * NOTE ON the exclusive mutex
+ * Ownership of the exclusive mutex is handed off directly between
+ * readers and writers and the mutex is never released through
+ * mutex_unlock(). Its owner field would therefore not be maintained
+ * and the adaptive spinning in _mutex_lock_timeout() would spin
+ * with rwl->lock held. The underlying semaphore is used instead.
+ */
  
 #include <synch/rwlock.h>
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
+#include <synch/semaphore.h>
 #include <synch/waitq.h>
 #include <synch/synch.h>
 #include <adt/list.h>
 #include <typedefs.h>
 #include <arch/asm.h>
+#include <arch/barrier.h>
 #include <arch.h>
 #include <proc/thread.h>
 #include <panic.h>
+#include <debug.h>
+#include <config.h>
+#include <mm/slab.h>
+#include <preemption.h>
 
 #define ALLOW_ALL		0
 #define ALLOW_READERS_ONLY	1
 
 static void let_others_in(rwlock_t *rwl, int readers_only);
 static void release_spinlock(void *arg);
+static long rwlock_readers(rwlock_t *rwl);
+static int rwlock_drain(rwlock_t *rwl, __u32 usec, int flags);
+static void rwlock_write_release(rwlock_t *rwl);
+static void rwlock_read_admitted(rwlock_t *rwl);
 
 /** Initialize reader/writer lock
  *
  * Initialize reader/writer lock.
+ * The per-CPU reader counts are allocated by malloc(),
+ * so this must not be called before the slab allocator
+ * is initialized.
  *
  * @param rwl Reader/Writer lock.
  */
 void rwlock_initialize(rwlock_t *rwl) {
+	int i;
+
 	spinlock_initialize(&rwl->lock, "rwlock_t");
 	mutex_initialize(&rwl->exclusive);
 	rwl->readers_in = 0;
+	rwl->writers = 0;
+	waitq_initialize(&rwl->drain);
+
+	rwl->cpus = (rwlock_cpu_t *) malloc(config.cpu_count * sizeof(rwlock_cpu_t), 0);
+	for (i = 0; i < config.cpu_count; i++)
+		atomic_set(&rwl->cpus[i].readers, 0);
+}
+
+/** Destroy reader/writer lock
+ *
+ * Free the per-CPU reader counts. The lock
+ * must not be held or awaited by anyone.
+ *
+ * @param rwl Reader/Writer lock.
+ */
+void rwlock_destroy(rwlock_t *rwl)
+{
+	ASSERT(!rwl->writers && !rwl->readers_in);
+	ASSERT(!rwlock_readers(rwl));
+
+	free(rwl->cpus);
+	rwl->cpus = NULL;
+}
+
+/** Count readers in critical section
+ *
+ * @param rwl Reader/Writer lock.
+ *
+ * @return Sum of the per-CPU reader counts.
+ */
+long rwlock_readers(rwlock_t *rwl)
+{
+	long sum = 0;
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++)
+		sum += atomic_get(&rwl->cpus[i].readers);
+
+	return sum;
+}
+
+/** Wait for readers to leave critical section
+ *
+ * Must be called by a writer holding the exclusive mutex.
+ *
+ * @param rwl Reader/Writer lock.
+ * @param usec Timeout in microseconds.
+ * @param flags Select mode of operation.
+ *
+ * @return See comment for waitq_sleep_timeout().
+ */
+int rwlock_drain(rwlock_t *rwl, __u32 usec, int flags)
+{
+	int rc = ESYNCH_OK_ATOMIC;
+
+	/*
+	 * Readers wake us up when they find the counters sum up to zero.
+	 * More of them can do so, and the wakeups left over in the wait
+	 * queue only cause an extra iteration here.
+	 */
+	while (rwlock_readers(rwl)) {
+		rc = waitq_sleep_timeout(&rwl->drain, usec, flags);
+		if (SYNCH_FAILED(rc))
+			return rc;
+	}
+
+	return rc;
+}
+
+/** Release reader/writer lock held or awaited by writer
+ *
+ * Must be called with the exclusive mutex held by the writer.
+ *
+ * @param rwl Reader/Writer lock.
+ */
+void rwlock_write_release(rwlock_t *rwl)
+{
+	ipl_t ipl;
+	
+	ipl = interrupts_disable();
+	spinlock_lock(&rwl->lock);
+	rwl->writers--;
+	let_others_in(rwl, ALLOW_ALL);
+	spinlock_unlock(&rwl->lock);
+	interrupts_restore(ipl);
 }
 
 /** Acquire reader/writer lock for reading
@@ -99,19 +225,30 @@ void rwlock_initialize(rwlock_t *rwl) {
 int _rwlock_write_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 {
 	ipl_t ipl;
-	int rc;
+	int rc, drc;
 	
 	ipl = interrupts_disable();
 	spinlock_lock(&THREAD->lock);
 	THREAD->rwlock_holder_type = RWLOCK_WRITER;
 	spinlock_unlock(&THREAD->lock);	
+
+	/*
+	 * Announce the writer so that new readers
+	 * stop entering through their per-CPU counters.
+	 */
+	spinlock_lock(&rwl->lock);
+	rwl->writers++;
+	spinlock_unlock(&rwl->lock);
 	interrupts_restore(ipl);
+	memory_barrier();
 
 	/*
 	 * Writers take the easy part.
-	 * They just need to acquire the exclusive mutex.
+	 * They just need to acquire the exclusive mutex
+	 * and wait for the readers inside to leave.
+	 * The timeout applies to each of the two waits.
 	 */
-	rc = _mutex_lock_timeout(&rwl->exclusive, usec, flags);
+	rc = _semaphore_down_timeout(&rwl->exclusive.sem, usec, flags);
 	if (SYNCH_FAILED(rc)) {
 
 		/*
@@ -122,6 +259,7 @@ int _rwlock_write_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 		 
 		ipl = interrupts_disable();
 		spinlock_lock(&rwl->lock);
+		rwl->writers--;
 		/*
 		 * Now when rwl is locked, we can inspect it again.
 		 * If it is held by some readers already, we can let
@@ -131,7 +269,16 @@ int _rwlock_write_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 			let_others_in(rwl, ALLOW_READERS_ONLY);
 		spinlock_unlock(&rwl->lock);
 		interrupts_restore(ipl);
+		return rc;
+	}
+
+	drc = rwlock_drain(rwl, usec, flags);
+	if (SYNCH_FAILED(drc)) {
+		rwlock_write_release(rwl);
+		return drc;
 	}
+	if (drc == ESYNCH_OK_BLOCKED)
+		rc = drc;
 	
 	return rc;
 }
@@ -154,6 +301,23 @@ int _rwlock_read_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 {
 	int rc;
 	ipl_t ipl;
+
+	/*
+	 * Fast path. Enter unless a writer has announced itself.
+	 * The barrier pairs with the one in _rwlock_write_lock_timeout():
+	 * either the writer sees our count, or we see the writer.
+	 * Preemption is disabled so that backing out decrements the
+	 * same counter that has just been incremented.
+	 */
+	preemption_disable();
+	atomic_inc(&rwl->cpus[CPU->id].readers);
+	memory_barrier();
+	if (!rwl->writers) {
+		preemption_enable();
+		return ESYNCH_OK_ATOMIC;
+	}
+	rwlock_read_unlock(rwl);
+	preemption_enable();
 	
 	ipl = interrupts_disable();
 	spinlock_lock(&THREAD->lock);
@@ -165,7 +329,7 @@ int _rwlock_read_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 	/*
 	 * Find out whether we can get what we want without blocking.
 	 */
-	rc = mutex_trylock(&rwl->exclusive);
+	rc = semaphore_trydown(&rwl->exclusive.sem);
 	if (SYNCH_FAILED(rc)) {
 
 		/*
@@ -199,7 +363,7 @@ int _rwlock_read_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 		thread_register_call_me(release_spinlock, NULL);
 		#endif
 				 
-		rc = _mutex_lock_timeout(&rwl->exclusive, usec, flags);
+		rc = _semaphore_down_timeout(&rwl->exclusive.sem, usec, flags);
 		switch (rc) {
 			case ESYNCH_WOULD_BLOCK:
 				/*
@@ -225,12 +389,14 @@ int _rwlock_read_lock_timeout(rwlock_t *rwl, __u32 usec, int flags)
 				interrupts_restore(ipl);
 				break;
 			case ESYNCH_OK_ATOMIC:
-				panic("_mutex_lock_timeout()==ESYNCH_OK_ATOMIC\n");
+				panic("_semaphore_down_timeout()==ESYNCH_OK_ATOMIC\n");
 				break;
 			default:
 				panic("invalid ESYNCH\n");
 				break;
 		}
+		if (SYNCH_OK(rc))
+			rwlock_read_admitted(rwl);
 		return rc;
 	}
 
@@ -245,48 +411,67 @@ shortcut:
 	spinlock_unlock(&rwl->lock);
 	interrupts_restore(ipl);
 
+	rwlock_read_admitted(rwl);
 	return ESYNCH_OK_ATOMIC;
 }
 
-/** Release reader/writer lock held by writer
+/** Move admitted reader to per-CPU counter
  *
- * Release reader/writer lock held by writer.
- * Handoff reader/writer lock ownership directly
- * to waiting readers or a writer.
+ * A reader that went through the exclusive mutex counts
+ * itself in the per-CPU counter and gives its share of
+ * the exclusive mutex up, so that the next thread in line
+ * can be let in. A writer let in this way will wait for
+ * the reader to leave in rwlock_drain().
  *
  * @param rwl Reader/Writer lock.
  */
-void rwlock_write_unlock(rwlock_t *rwl)
+void rwlock_read_admitted(rwlock_t *rwl)
 {
 	ipl_t ipl;
-	
+
+	atomic_inc(&rwl->cpus[CPU->id].readers);
+
 	ipl = interrupts_disable();
 	spinlock_lock(&rwl->lock);
-	let_others_in(rwl, ALLOW_ALL);
+	if (!--rwl->readers_in)
+		let_others_in(rwl, ALLOW_ALL);
 	spinlock_unlock(&rwl->lock);
 	interrupts_restore(ipl);
-	
+}
+
+/** Release reader/writer lock held by writer
+ *
+ * Release reader/writer lock held by writer.
+ * Handoff reader/writer lock ownership directly
+ * to waiting readers or a writer.
+ *
+ * @param rwl Reader/Writer lock.
+ */
+void rwlock_write_unlock(rwlock_t *rwl)
+{
+	rwlock_write_release(rwl);
 }
 
 /** Release reader/writer lock held by reader
  *
  * Release reader/writer lock held by reader.
- * Handoff reader/writer lock ownership directly
- * to a waiting writer or don't do anything if more
- * readers poses the lock.
+ * Wake up the writer waiting in rwlock_drain()
+ * if this was the last reader or don't do anything
+ * if more readers poses the lock.
+ *
+ * The reader may have migrated since it entered,
+ * so a per-CPU count can drop below zero. Only
+ * the sum of all of them is meaningful, see the
+ * comment at the top of this file.
  *
  * @param rwl Reader/Writer lock.
  */
 void rwlock_read_unlock(rwlock_t *rwl)
 {
-	ipl_t ipl;
-
-	ipl = interrupts_disable();
-	spinlock_lock(&rwl->lock);
-	if (!--rwl->readers_in)
-		let_others_in(rwl, ALLOW_ALL);
-	spinlock_unlock(&rwl->lock);
-	interrupts_restore(ipl);
+	atomic_dec(&rwl->cpus[CPU->id].readers);
+	memory_barrier();
+	if (rwl->writers && !rwlock_readers(rwl))
+		waitq_wakeup(&rwl->drain, WAKEUP_FIRST);
 }
 
 
@@ -39,6 +39,8 @@
 #include <print.h>
 #include <debug.h>
 #include <symtab.h>
+#include <arch/asm.h>
+#include <func.h>
 
 #ifdef CONFIG_FB
 #include <genarch/fb/fb.h>
@@ -46,6 +48,22 @@
 
 #ifdef CONFIG_SMP
 
+/*
+ * Take a ticket and test whether the lock is still busy for it.
+ * Test-and-set locks have no tickets; the test is the acquisition.
+ */
+#ifdef CONFIG_TICKET_SPINLOCK
+#define spinlock_take(sl)	atomic_postinc(&(sl)->val)
+#define spinlock_busy(sl, t)	((sl)->serving != (t))
+#else
+#define spinlock_take(sl)	0
+#define spinlock_busy(sl, t)	((void) (t), test_and_set(&(sl)->val))
+#endif
+
+#ifdef CONFIG_LOCK_STAT
+static void lock_stat_account(spinlock_t *sl, bool contended, __u64 wait);
+#endif
+
 /** Initialize spinlock
  *
  * Initialize spinlock.
@@ -55,28 +73,51 @@
 void spinlock_initialize(spinlock_t *sl, char *name)
 {
 	atomic_set(&sl->val, 0);
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef CONFIG_TICKET_SPINLOCK
+	sl->serving = 0;
+#endif
+#ifdef SPINLOCK_NAMED
 	sl->name = name;
 #endif	
+#ifdef CONFIG_LOCK_STAT
+	sl->stat = NULL;
+#endif
 }
 
 /** Lock spinlock
  *
  * Lock spinlock.
- * This version has limitted ability to report 
- * possible occurence of deadlock.
+ * With CONFIG_DEBUG_SPINLOCK, this version has limitted
+ * ability to report possible occurence of deadlock.
+ * With CONFIG_LOCK_STAT, it accounts the acquisition
+ * and the time spent waiting for the lock.
  *
  * @param sl Pointer to spinlock_t structure.
  */
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef SPINLOCK_NAMED
 void spinlock_lock_debug(spinlock_t *sl)
 {
+	long ticket;
+#ifdef CONFIG_DEBUG_SPINLOCK
 	count_t i = 0;
 	char *symbol;
 	bool deadlock_reported = false;
+#endif
+#ifdef CONFIG_LOCK_STAT
+	bool contended = false;
+	__u64 start = 0;
+#endif
 
 	preemption_disable();
-	while (test_and_set(&sl->val)) {
+	ticket = spinlock_take(sl);
+	while (spinlock_busy(sl, ticket)) {
+#ifdef CONFIG_LOCK_STAT
+		if (!contended) {
+			contended = true;
+			start = get_cycle();
+		}
+#endif
+#ifdef CONFIG_DEBUG_SPINLOCK
 
 		/*
 		 * We need to be careful about printflock and fb_lock.
@@ -111,15 +152,22 @@ void spinlock_lock_debug(spinlock_t *sl)
 			i = 0;
 			deadlock_reported = true;
 		}
+#endif
 	}
 
+#ifdef CONFIG_DEBUG_SPINLOCK
 	if (deadlock_reported)
 		printf("cpu%d: not deadlocked\n", CPU->id);
+#endif
 
 	/*
 	 * Prevent critical section code from bleeding out this way up.
 	 */
 	CS_ENTER_BARRIER();
+
+#ifdef CONFIG_LOCK_STAT
+	lock_stat_account(sl, contended, contended ? get_cycle() - start : 0);
+#endif
 }
 #endif
 
@@ -136,9 +184,21 @@ void spinlock_lock_debug(spinlock_t *sl)
 int spinlock_trylock(spinlock_t *sl)
 {
 	int rc;
+#ifdef CONFIG_TICKET_SPINLOCK
+	long ticket;
+#endif
 	
 	preemption_disable();
+#ifdef CONFIG_TICKET_SPINLOCK
+	/*
+	 * The lock is free if the next ticket is the one being served.
+	 * Take it only in that case.
+	 */
+	ticket = sl->serving;
+	rc = atomic_cas(&sl->val, ticket, ticket + 1);
+#else
 	rc = !test_and_set(&sl->val);
+#endif
 
 	/*
 	 * Prevent critical section code from bleeding out this way up.
@@ -147,8 +207,134 @@ int spinlock_trylock(spinlock_t *sl)
 
 	if (!rc)
 		preemption_enable();
+#ifdef CONFIG_LOCK_STAT
+	else
+		lock_stat_account(sl, false, 0);
+#endif
 	
 	return rc;
 }
 
+#ifdef CONFIG_LOCK_STAT
+
+/*
+ * Statistics are kept in an open-addressing hash table keyed by
+ * the spinlock name. Each spinlock caches a pointer to its entry
+ * after the first acquisition. The table is protected by a bare
+ * test-and-set flag, because a spinlock would recurse.
+ */
+static atomic_t lock_stat_lock;
+static lock_stat_t lock_stats[LOCK_STAT_ENTRIES];
+static lock_stat_t lock_stat_other = { .name = "(other)" };
+
+/** Find or create the statistics entry for a name.
+ *
+ * Must be called with lock_stat_lock held and interrupts disabled.
+ *
+ * @param name Spinlock name.
+ *
+ * @return Statistics entry.
+ */
+static lock_stat_t *lock_stat_find(char *name)
+{
+	__u32 hash = 2166136261U;
+	char *c;
+	index_t i, j;
+
+	for (c = name; *c; c++)
+		hash = (hash ^ *c) * 16777619U;
+
+	for (i = 0; i < LOCK_STAT_ENTRIES; i++) {
+		j = (hash + i) % LOCK_STAT_ENTRIES;
+		if (!lock_stats[j].name) {
+			lock_stats[j].name = name;
+			return &lock_stats[j];
+		}
+		if (strncmp(lock_stats[j].name, name, strlen(name) + 1) == 0)
+			return &lock_stats[j];
+	}
+
+	return &lock_stat_other;
+}
+
+/** Add value to statistics counter atomically.
+ *
+ * @param val Counter.
+ * @param i Value to add.
+ */
+static void lock_stat_add(atomic_t *val, long i)
+{
+	long old;
+
+	do {
+		old = atomic_get(val);
+	} while (!atomic_cas(val, old, old + i));
+}
+
+/** Raise statistics counter atomically.
+ *
+ * @param val Counter.
+ * @param i New value, stored only if greater than the current one.
+ */
+static void lock_stat_max(atomic_t *val, long i)
+{
+	long old;
+
+	do {
+		old = atomic_get(val);
+		if (old >= i)
+			return;
+	} while (!atomic_cas(val, old, i));
+}
+
+/** Account spinlock acquisition.
+ *
+ * Must be called with the spinlock held.
+ *
+ * @param sl Acquired spinlock.
+ * @param contended True if the spinlock was found locked.
+ * @param wait Number of cycles spent waiting for the spinlock.
+ */
+void lock_stat_account(spinlock_t *sl, bool contended, __u64 wait)
+{
+	lock_stat_t *stat = sl->stat;
+	ipl_t ipl;
+
+	if (!stat) {
+		ipl = interrupts_disable();
+		while (test_and_set(&lock_stat_lock))
+			;
+		stat = lock_stat_find(sl->name ? sl->name : "(unnamed)");
+		atomic_set(&lock_stat_lock, 0);
+		interrupts_restore(ipl);
+		sl->stat = stat;
+	}
+
+	atomic_inc(&stat->acquired);
+	if (contended) {
+		atomic_inc(&stat->contended);
+		lock_stat_add(&stat->wait_total, (long) wait);
+		lock_stat_max(&stat->wait_max, (long) wait);
+	}
+}
+
+/** Print spinlock statistics. */
+void lock_stat_print(void)
+{
+	lock_stat_t *stat;
+	index_t i;
+
+	printf("name                            acquired  contended     wait total       wait max\n");
+	for (i = 0; i <= LOCK_STAT_ENTRIES; i++) {
+		stat = (i < LOCK_STAT_ENTRIES) ? &lock_stats[i] : &lock_stat_other;
+		if (!stat->name || !atomic_get(&stat->acquired))
+			continue;
+		printf("%-30s %9zd %10zd %14lld %14lld\n", stat->name,
+			atomic_get(&stat->acquired), atomic_get(&stat->contended),
+			atomic_get(&stat->wait_total), atomic_get(&stat->wait_max));
+	}
+}
+
+#endif /* CONFIG_LOCK_STAT */
+
 #endif
@@ -430,3 +430,85 @@ loop:
 	if (all)
 		goto loop;
 }
+
+/** Wake up several threads sleeping in a wait queue
+ *
+ * Unlike calling waitq_wakeup() n times, at most the threads
+ * that are currently sleeping are woken up and wakeups that
+ * do not find a sleeping thread are not remembered as missed.
+ * Thus the time spent with the wait queue locked is bounded
+ * by the number of sleepers no matter how big n is.
+ *
+ * @param wq Pointer to wait queue.
+ * @param n Maximum number of threads to wake up.
+ *
+ * @return Number of threads woken up.
+ */
+count_t waitq_wakeup_n(waitq_t *wq, count_t n)
+{
+	count_t woken = 0;
+	ipl_t ipl;
+
+	ipl = interrupts_disable();
+	spinlock_lock(&wq->lock);
+
+	while ((woken < n) && !list_empty(&wq->head)) {
+		_waitq_wakeup_unsafe(wq, WAKEUP_FIRST);
+		woken++;
+	}
+
+	spinlock_unlock(&wq->lock);
+	interrupts_restore(ipl);
+
+	return woken;
+}
+
+/** Move sleeping threads from one wait queue to another
+ *
+ * The threads are not woken up. They keep their timeouts and
+ * can still be interrupted. Missed wakeups are not moved.
+ *
+ * @param src Wait queue to take the threads from.
+ * @param dst Wait queue to put the threads to.
+ * @param n Maximum number of threads to move.
+ *
+ * @return Number of threads moved.
+ */
+count_t waitq_requeue(waitq_t *src, waitq_t *dst, count_t n)
+{
+	thread_t *t;
+	count_t moved = 0;
+	ipl_t ipl;
+
+	if (src == dst)
+		return 0;
+
+	ipl = interrupts_disable();
+
+	/* Lock the wait queues in the order of their addresses to avoid deadlock. */
+	if (src < dst) {
+		spinlock_lock(&src->lock);
+		spinlock_lock(&dst->lock);
+	} else {
+		spinlock_lock(&dst->lock);
+		spinlock_lock(&src->lock);
+	}
+
+	while ((moved < n) && !list_empty(&src->head)) {
+		t = list_get_instance(src->head.next, thread_t, wq_link);
+
+		list_remove(&t->wq_link);
+		list_append(&t->wq_link, &dst->head);
+		spinlock_lock(&t->lock);
+		t->sleep_queue = dst;
+		spinlock_unlock(&t->lock);
+
+		moved++;
+	}
+
+	spinlock_unlock(&src->lock);
+	spinlock_unlock(&dst->lock);
+	interrupts_restore(ipl);
+
+	return moved;
+}
@@ -48,6 +48,14 @@
 #include <sysinfo/sysinfo.h>
 #include <console/console.h>
 #include <console/klog.h>
+#include <arch/asm.h>
+#include <cpu.h>
+#include <config.h>
+#include <func.h>
+
+#ifdef CONFIG_SYSCALL_STATS
+static void syscall_account(__native id, __u64 cycles);
+#endif /* CONFIG_SYSCALL_STATS */
 
 /** Print using kernel facility
  *
@@ -92,6 +100,9 @@ __native syscall_handler(__native a1, __native a2, __native a3,
 			 __native a4, __native id)
 {
 	__native rc;
+#ifdef CONFIG_SYSCALL_STATS
+	__u64 start = get_cycle();
+#endif /* CONFIG_SYSCALL_STATS */
 
 	if (id < SYSCALL_END)
 		rc = syscall_table[id](a1,a2,a3,a4);
@@ -100,6 +111,10 @@ __native syscall_handler(__native a1, __native a2, __native a3,
 		task_kill(TASK->taskid);
 		thread_exit();
 	}
+
+#ifdef CONFIG_SYSCALL_STATS
+	syscall_account(id, get_cycle() - start);
+#endif /* CONFIG_SYSCALL_STATS */
 		
 	if (THREAD->interrupted)
 		thread_exit();
@@ -152,5 +167,128 @@ syshandler_t syscall_table[SYSCALL_END] = {
 	sys_sysinfo_value,
 	
 	/* Debug calls */
-	sys_debug_enable_console
+	sys_debug_enable_console,
+
+	/* Synchronization related syscalls added later. */
+	sys_futex_sleep_compare,
+	sys_futex_wakeup_n,
+	sys_futex_requeue
 };
+
+#ifdef CONFIG_SYSCALL_STATS
+
+/** Account one finished syscall to the current CPU.
+ *
+ * @param id Syscall number.
+ * @param cycles Number of cycles the syscall took.
+ */
+void syscall_account(__native id, __u64 cycles)
+{
+	syscall_stat_t *stat;
+	ipl_t ipl;
+
+	ipl = interrupts_disable();
+	stat = &CPU->syscall_stats[id];
+	if (!stat->count || cycles < stat->min)
+		stat->min = cycles;
+	if (cycles > stat->max)
+		stat->max = cycles;
+	stat->cycles += cycles;
+	stat->count++;
+	interrupts_restore(ipl);
+}
+
+static __native syscall_count_sysinfo(sysinfo_item_t *item)
+{
+	__native id = atoi(item->name);
+	__native sum = 0;
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++)
+		sum += cpus[i].syscall_stats[id].count;
+	return sum;
+}
+
+static __native syscall_cycles_sysinfo(sysinfo_item_t *item)
+{
+	__native id = atoi(item->name);
+	__native sum = 0;
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++)
+		sum += cpus[i].syscall_stats[id].cycles;
+	return sum;
+}
+
+static __native syscall_min_sysinfo(sysinfo_item_t *item)
+{
+	__native id = atoi(item->name);
+	__native min = 0;
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].syscall_stats[id].count)
+			continue;
+		if (!min || cpus[i].syscall_stats[id].min < min)
+			min = cpus[i].syscall_stats[id].min;
+	}
+	return min;
+}
+
+static __native syscall_max_sysinfo(sysinfo_item_t *item)
+{
+	__native id = atoi(item->name);
+	__native max = 0;
+	int i;
+
+	for (i = 0; i < config.cpu_count; i++) {
+		if (cpus[i].syscall_stats[id].max > max)
+			max = cpus[i].syscall_stats[id].max;
+	}
+	return max;
+}
+
+/** Export syscall statistics via sysinfo
+ *
+ * The values are summed over all processors.
+ * Must be called after the slab allocator is initialized.
+ */
+void syscall_stats_init(void)
+{
+	char name[32];
+	int i;
+
+	for (i = 0; i < SYSCALL_END; i++) {
+		snprintf(name, sizeof(name), "syscall.count.%d", i);
+		sysinfo_set_item_function(name, NULL, syscall_count_sysinfo);
+		snprintf(name, sizeof(name), "syscall.cycles.%d", i);
+		sysinfo_set_item_function(name, NULL, syscall_cycles_sysinfo);
+		snprintf(name, sizeof(name), "syscall.min.%d", i);
+		sysinfo_set_item_function(name, NULL, syscall_min_sysinfo);
+		snprintf(name, sizeof(name), "syscall.max.%d", i);
+		sysinfo_set_item_function(name, NULL, syscall_max_sysinfo);
+	}
+}
+
+/** Print per-CPU syscall statistics. */
+void syscall_stats_print(void)
+{
+	syscall_stat_t *stat;
+	int i, j;
+
+	printf("cpu syscall     count         cycles        average            min            max\n");
+	for (i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].active)
+			continue;
+		for (j = 0; j < SYSCALL_END; j++) {
+			stat = &cpus[i].syscall_stats[j];
+			if (!stat->count)
+				continue;
+			printf("%3d %7d %9zd %14lld %14lld %14lld %14lld\n", i, j,
+				stat->count, stat->cycles, stat->cycles / stat->count,
+				stat->min, stat->max);
+		}
+	}
+}
+
+#endif /* CONFIG_SYSCALL_STATS */
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	btree1.c
+ * @brief	Test of B+tree range operations.
+ */
+
+#include <test.h>
+#include <adt/btree.h>
+#include <typedefs.h>
+#include <macros.h>
+#include <print.h>
+
+/** Number of distinct keys used by the test. */
+#define KEYS		(16 * BTREE_M)
+
+static bool btree1_check(btree_t *t, bool present[], count_t n);
+static bool btree1_remove(btree_t *t, bool present[], count_t n, btree_key_t lo, btree_key_t hi);
+
+/** Compare B-tree with the set of keys it should contain.
+ *
+ * Walk the B-tree and search all keys from the range and
+ * the key past it by both bounds.
+ *
+ * @param t B-tree whose values are their keys plus one.
+ * @param present Array telling which keys are in the B-tree.
+ * @param n Number of keys in the range.
+ *
+ * @return True if the B-tree matches the set, false otherwise.
+ */
+bool btree1_check(btree_t *t, bool present[], count_t n)
+{
+	btree_pos_t pos;
+	btree_key_t k, exp;
+	bool valid;
+
+	/* Walk all keys in ascending order. */
+	exp = 0;
+	for (valid = btree_lower_bound(t, 0, &pos); valid; valid = btree_pos_next(t, &pos)) {
+		while (exp < n && !present[exp])
+			exp++;
+		if (exp == n || BTREE_POS_KEY(&pos) != exp ||
+		    BTREE_POS_VALUE(&pos) != (void *) (__native) (exp + 1)) {
+			printf("walk: unexpected key %lld\n", BTREE_POS_KEY(&pos));
+			return false;
+		}
+		exp++;
+	}
+	while (exp < n && !present[exp])
+		exp++;
+	if (exp != n) {
+		printf("walk: key %lld missing\n", exp);
+		return false;
+	}
+
+	for (k = 0; k <= n; k++) {
+		/* The first key not smaller than k. */
+		for (exp = k; exp < n && !present[exp]; exp++)
+			;
+		valid = btree_lower_bound(t, k, &pos);
+		if (valid != (exp < n) || (valid && BTREE_POS_KEY(&pos) != exp)) {
+			printf("lower bound of %lld is wrong\n", k);
+			return false;
+		}
+
+		/* The first key greater than k. */
+		for (exp = k + 1; exp < n && !present[exp]; exp++)
+			;
+		valid = btree_upper_bound(t, k, &pos);
+		if (valid != (exp < n) || (valid && BTREE_POS_KEY(&pos) != exp)) {
+			printf("upper bound of %lld is wrong\n", k);
+			return false;
+		}
+
+		/* The last key not greater than k, found from the upper bound. */
+		for (exp = min(k, n - 1) + 1; exp > 0 && !present[exp - 1]; exp--)
+			;
+		valid = btree_pos_prev(t, &pos);
+		if (valid != (exp > 0) || (valid && BTREE_POS_KEY(&pos) != exp - 1)) {
+			printf("last key not greater than %lld is wrong\n", k);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/** Remove interval from B-tree and check the result.
+ *
+ * @param t B-tree whose values are their keys plus one.
+ * @param present Array telling which keys are in the B-tree.
+ * @param n Number of keys in the range.
+ * @param lo Smallest key to be removed.
+ * @param hi Key bounding the interval from above.
+ *
+ * @return True if the right keys were removed, false otherwise.
+ */
+bool btree1_remove(btree_t *t, bool present[], count_t n, btree_key_t lo, btree_key_t hi)
+{
+	btree_key_t k;
+	count_t expected = 0, removed;
+
+	for (k = lo; k < hi; k++) {
+		if (present[k])
+			expected++;
+		present[k] = false;
+	}
+
+	removed = btree_remove_range(t, lo, hi);
+	if (removed != expected) {
+		printf("removed %zd keys from [%lld, %lld) instead of %zd\n", removed, lo, hi, expected);
+		return false;
+	}
+
+	return btree1_check(t, present, n);
+}
+
+/** Test the B-tree range operations.
+ *
+ * A B-tree of several levels is loaded by btree_append(), filled
+ * by btree_insert() and emptied by btree_remove_range() of both
+ * large and small intervals. After each step, all keys in the
+ * range are searched by both bounds and stepped over in both
+ * directions.
+ *
+ * @return True if the test passed, false otherwise.
+ */
+bool test_btree1(void)
+{
+	static bool present[KEYS];
+	btree_t t;
+	btree_key_t k;
+	count_t n = KEYS;
+	bool ok = false;
+
+	btree_create(&t);
+
+	for (k = 0; k < n; k++) {
+		present[k] = !(k % 2);
+		if (present[k])
+			btree_append(&t, k, (void *) (__native) (k + 1));
+	}
+	if (!btree1_check(&t, present, n))
+		goto out;
+
+	for (k = n / 4 + 1; k < n / 2; k += 2) {
+		present[k] = true;
+		btree_insert(&t, k, (void *) (__native) (k + 1), NULL);
+	}
+	if (!btree1_check(&t, present, n))
+		goto out;
+
+	/* Remove a large interval, then small ones, then the rest. */
+	if (!btree1_remove(&t, present, n, n / 3, 2 * n / 3))
+		goto out;
+	for (k = 0; k + 3 <= n; k += 7) {
+		if (!btree1_remove(&t, present, n, k, k + 3))
+			goto out;
+	}
+	if (!btree1_remove(&t, present, n, 0, n))
+		goto out;
+
+	ok = true;
+out:
+	btree_destroy(&t);
+	return ok;
+}
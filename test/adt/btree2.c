@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	btree2.c
+ * @brief	Benchmark of B+tree operations at various sizes.
+ */
+
+#include <test.h>
+#include <adt/btree.h>
+#include <typedefs.h>
+#include <arch/asm.h>
+#include <print.h>
+
+#define SEED		1	/**< Seed of the pseudo-random keys. */
+
+static btree_key_t btree2_next(btree_key_t seed);
+static void btree2_run(count_t keys);
+
+/** Return next pseudo-random key.
+ *
+ * The full-period generator does not repeat keys.
+ */
+btree_key_t btree2_next(btree_key_t seed)
+{
+	return seed * 6364136223846793005ULL + 1442695040888963407ULL;
+}
+
+/** Insert, search and remove the given number of random keys.
+ *
+ * @param keys Number of keys.
+ */
+void btree2_run(count_t keys)
+{
+	__u64 start, cycles[3];
+	count_t errors = 0;
+	btree_key_t key;
+	btree_node_t *leaf;
+	btree_t t;
+	index_t i;
+
+	btree_create(&t);
+
+	start = get_cycle();
+	for (i = 0, key = SEED; i < keys; i++) {
+		key = btree2_next(key);
+		btree_insert(&t, key, (void *) (key + 1), NULL);
+	}
+	cycles[0] = get_cycle() - start;
+
+	start = get_cycle();
+	for (i = 0, key = SEED; i < keys; i++) {
+		key = btree2_next(key);
+		if (btree_search(&t, key, &leaf) != (void *) (key + 1))
+			errors++;
+	}
+	cycles[1] = get_cycle() - start;
+
+	start = get_cycle();
+	for (i = 0, key = SEED; i < keys; i++) {
+		key = btree2_next(key);
+		btree_remove(&t, key, NULL);
+	}
+	cycles[2] = get_cycle() - start;
+
+	if (t.root->keys)
+		errors++;
+
+	printf("%zd keys: insert %lld, search %lld, remove %lld cycles per key, %zd errors\n",
+	    keys, cycles[0] / keys, cycles[1] / keys, cycles[2] / keys, errors);
+
+	btree_destroy(&t);
+}
+
+/** Benchmark B+tree operations at various sizes.
+ *
+ * From 10^3 to 10^6 random keys are inserted into a B+tree of
+ * fan-out BTREE_M, looked up and removed in insertion order.
+ */
+void bench_btree2(void)
+{
+	count_t keys;
+
+	printf("fan-out %d\n", BTREE_M);
+	for (keys = 1000; keys <= 1000000; keys *= 10)
+		btree2_run(keys);
+}
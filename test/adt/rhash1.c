@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	rhash1.c
+ * @brief	Test of the resizable hash table.
+ */
+
+#include <test.h>
+#include <adt/rhash_table.h>
+#include <adt/list.h>
+#include <synch/spinlock.h>
+#include <synch/synch.h>
+#include <proc/thread.h>
+#include <mm/slab.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <atomic.h>
+#include <print.h>
+#include <panic.h>
+
+/** Number of items inserted by each thread of test_rhash1(). */
+#define ITEMS		1024
+
+/** Number of times each thread of test_rhash1() fills and empties the table. */
+#define ROUNDS		8
+
+/** Item of the test_rhash1() table. */
+typedef struct {
+	link_t link;
+	__native key[2];	/**< Owner thread and item number. */
+	count_t removed;	/**< Number of remove_callback() calls. */
+	count_t visited;	/**< Number of walker calls. */
+} rhash1_item_t;
+
+/** State shared by the threads of test_rhash1(). */
+typedef struct {
+	rhash_table_t table;
+	atomic_t errors;
+} rhash1_t;
+
+/** Argument of rhash1_thread(). */
+typedef struct {
+	rhash1_t *test;
+	rhash1_item_t *item;
+	__native owner;
+} rhash1_arg_t;
+
+static __native rhash1_hash(__native key[]);
+static __native rhash1_hash_item(link_t *item);
+static bool rhash1_compare(__native key[], count_t keys, link_t *item);
+static void rhash1_remove_callback(link_t *item);
+static void rhash1_walker(link_t *item, void *arg);
+static count_t rhash1_fill(rhash_table_t *h, rhash1_item_t *item, __native owner, index_t round);
+static void rhash1_thread(void *arg);
+
+static rhash_table_operations_t rhash1_ops = {
+	.hash = rhash1_hash,
+	.hash_item = rhash1_hash_item,
+	.compare = rhash1_compare,
+	.remove_callback = rhash1_remove_callback
+};
+
+/** Hash function of the test_rhash1() table. */
+__native rhash1_hash(__native key[])
+{
+	return key[1];
+}
+
+/** Item hash function of the test_rhash1() table. */
+__native rhash1_hash_item(link_t *item)
+{
+	rhash1_item_t *ti = rhash_table_get_instance(item, rhash1_item_t, link);
+
+	return ti->key[1];
+}
+
+/** Item comparison function of the test_rhash1() table.
+ *
+ * Passing only the owner matches all its items.
+ */
+bool rhash1_compare(__native key[], count_t keys, link_t *item)
+{
+	rhash1_item_t *ti = rhash_table_get_instance(item, rhash1_item_t, link);
+
+	return ti->key[0] == key[0] && (keys < 2 || ti->key[1] == key[1]);
+}
+
+/** Item removal callback of the test_rhash1() table. */
+void rhash1_remove_callback(link_t *item)
+{
+	rhash1_item_t *ti = rhash_table_get_instance(item, rhash1_item_t, link);
+
+	ti->removed++;
+}
+
+/** Walker counting visits of the test_rhash1() items.
+ *
+ * @param item Item of the hash table.
+ * @param arg Counter of visited items.
+ */
+void rhash1_walker(link_t *item, void *arg)
+{
+	rhash1_item_t *ti = rhash_table_get_instance(item, rhash1_item_t, link);
+
+	ti->visited++;
+	(*(count_t *) arg)++;
+}
+
+/** Fill hash table with items of one owner and empty it again.
+ *
+ * Every item must be found while it is in the table and must
+ * not be found after its removal. Half of the items are removed
+ * one by one. In odd rounds, the rest is removed by the owner key
+ * alone, which searches all buckets.
+ *
+ * @param h Hash table.
+ * @param item Array of ITEMS items.
+ * @param owner Owner key of the items.
+ * @param round Number of the round.
+ *
+ * @return Number of errors.
+ */
+count_t rhash1_fill(rhash_table_t *h, rhash1_item_t *item, __native owner, index_t round)
+{
+	count_t errors = 0;
+	index_t i;
+
+	for (i = 0; i < ITEMS; i++) {
+		item[i].key[0] = owner;
+		item[i].key[1] = owner * ITEMS + i;
+		link_initialize(&item[i].link);
+		rhash_table_insert(h, item[i].key, &item[i].link);
+
+		/* Look up an older item, too, while the table is being migrated. */
+		if (rhash_table_find(h, item[i / 2].key) != &item[i / 2].link)
+			errors++;
+	}
+
+	for (i = 0; i < ITEMS; i++) {
+		if (rhash_table_find(h, item[i].key) != &item[i].link)
+			errors++;
+	}
+
+	for (i = 1; i < ITEMS; i += 2)
+		rhash_table_remove(h, item[i].key, 2);
+
+	for (i = 0; i < ITEMS; i++) {
+		if ((rhash_table_find(h, item[i].key) != NULL) != !(i % 2))
+			errors++;
+	}
+
+	if (round % 2) {
+		rhash_table_remove(h, item[0].key, 1);
+	} else {
+		for (i = 0; i < ITEMS; i += 2)
+			rhash_table_remove(h, item[i].key, 2);
+	}
+
+	for (i = 0; i < ITEMS; i++) {
+		if (rhash_table_find(h, item[i].key) || item[i].removed != round + 1)
+			errors++;
+	}
+
+	return errors;
+}
+
+/** Thread of test_rhash1() filling the table with its own items.
+ *
+ * @param arg Thread argument, rhash1_arg_t.
+ */
+void rhash1_thread(void *arg)
+{
+	rhash1_arg_t *targ = (rhash1_arg_t *) arg;
+	index_t round;
+	count_t errors = 0;
+
+	for (round = 0; round < ROUNDS; round++)
+		errors += rhash1_fill(&targ->test->table, targ->item, targ->owner, round);
+
+	while (errors--)
+		atomic_inc(&targ->test->errors);
+}
+
+/** Test the resizable hash table.
+ *
+ * A thread wired to each active CPU repeatedly fills a table,
+ * which starts with a single bucket, with its own items and
+ * empties it again, so that the table is grown and migrated
+ * while the other threads use it. Afterwards, the table must
+ * be empty and a walk over a refilled table must visit every
+ * item exactly once.
+ *
+ * @return True if the test passed, false otherwise.
+ */
+bool test_rhash1(void)
+{
+	rhash1_t test;
+	rhash1_arg_t *arg;
+	rhash1_item_t *item;
+	thread_t **t;
+	count_t n = 0, visited = 0, errors;
+	index_t i;
+
+	item = (rhash1_item_t *) malloc(config.cpu_count * ITEMS * sizeof(rhash1_item_t), 0);
+	arg = (rhash1_arg_t *) malloc(config.cpu_count * sizeof(rhash1_arg_t), 0);
+	t = (thread_t **) malloc(config.cpu_count * sizeof(thread_t *), 0);
+
+	rhash_table_create(&test.table, 1, 2, &rhash1_ops);
+	atomic_set(&test.errors, 0);
+
+	for (i = 0; i < config.cpu_count * ITEMS; i++) {
+		item[i].removed = 0;
+		item[i].visited = 0;
+	}
+
+	for (i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].active)
+			continue;
+		arg[n].test = &test;
+		arg[n].item = &item[n * ITEMS];
+		arg[n].owner = n;
+		if (!(t[n] = thread_create(rhash1_thread, &arg[n], TASK, 0, "rhash1")))
+			panic("thread_create/rhash1\n");
+		spinlock_lock(&t[n]->lock);
+		t[n]->flags |= X_WIRED;
+		t[n]->cpu = &cpus[i];
+		spinlock_unlock(&t[n]->lock);
+		thread_ready(t[n]);
+		n++;
+	}
+
+	for (i = 0; i < n; i++) {
+		thread_join_timeout(t[i], SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+		thread_detach(t[i]);
+	}
+
+	errors = atomic_get(&test.errors);
+	if (atomic_get(&test.table.items)) {
+		printf("%zd items left in the table\n", atomic_get(&test.table.items));
+		errors++;
+	}
+
+	/* Refill the grown table and walk it. */
+	for (i = 0; i < ITEMS; i++) {
+		link_initialize(&item[i].link);
+		rhash_table_insert(&test.table, item[i].key, &item[i].link);
+	}
+	rhash_table_walk(&test.table, rhash1_walker, &visited);
+	for (i = 0; i < ITEMS; i++) {
+		if (item[i].visited != 1)
+			errors++;
+	}
+	if (visited != ITEMS)
+		errors++;
+	rhash_table_remove(&test.table, item[0].key, 1);
+
+	printf("%zd threads, %zd errors\n", n, errors);
+
+	rhash_table_destroy(&test.table);
+	free(t);
+	free(arg);
+	free(item);
+
+	return !errors;
+}
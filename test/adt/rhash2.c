@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	rhash2.c
+ * @brief	Benchmark of the resizable hash table at various load factors.
+ */
+
+#include <test.h>
+#include <adt/rhash_table.h>
+#include <adt/list.h>
+#include <mm/slab.h>
+#include <arch/asm.h>
+#include <print.h>
+
+#define BUCKETS		512	/**< Initial number of buckets. */
+
+/** Item of the benchmarked table. */
+typedef struct {
+	link_t link;
+	__native key;
+} rhash2_item_t;
+
+static __native rhash2_hash(__native key[]);
+static __native rhash2_hash_item(link_t *item);
+static bool rhash2_compare(__native key[], count_t keys, link_t *item);
+static void rhash2_remove_callback(link_t *item);
+static void rhash2_run(rhash2_item_t *item, count_t quarters);
+
+static rhash_table_operations_t rhash2_ops = {
+	.hash = rhash2_hash,
+	.hash_item = rhash2_hash_item,
+	.compare = rhash2_compare,
+	.remove_callback = rhash2_remove_callback
+};
+
+/** Hash function of the benchmarked table, the keys are random. */
+__native rhash2_hash(__native key[])
+{
+	return key[0];
+}
+
+/** Item hash function of the benchmarked table. */
+__native rhash2_hash_item(link_t *item)
+{
+	rhash2_item_t *ti = rhash_table_get_instance(item, rhash2_item_t, link);
+
+	return ti->key;
+}
+
+/** Item comparison function of the benchmarked table. */
+bool rhash2_compare(__native key[], count_t keys, link_t *item)
+{
+	rhash2_item_t *ti = rhash_table_get_instance(item, rhash2_item_t, link);
+
+	return ti->key == key[0];
+}
+
+/** Item removal callback of the benchmarked table, the items are not freed. */
+void rhash2_remove_callback(link_t *item)
+{
+}
+
+/** Insert, find and remove items at the given load factor.
+ *
+ * @param item Array of items, large enough for the load factor.
+ * @param quarters Number of items per bucket in quarters.
+ */
+void rhash2_run(rhash2_item_t *item, count_t quarters)
+{
+	count_t items = BUCKETS * quarters / 4, errors = 0;
+	__u64 seed = quarters, start, cycles[4];
+	rhash_table_t h;
+	__native key;
+	index_t i;
+
+	rhash_table_create(&h, BUCKETS, 1, &rhash2_ops);
+
+	for (i = 0; i < items; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		/* Odd keys are inserted, even keys are missing. */
+		item[i].key = seed | 1;
+		link_initialize(&item[i].link);
+	}
+
+	start = get_cycle();
+	for (i = 0; i < items; i++)
+		rhash_table_insert(&h, &item[i].key, &item[i].link);
+	cycles[0] = get_cycle() - start;
+
+	start = get_cycle();
+	for (i = 0; i < items; i++) {
+		if (rhash_table_find(&h, &item[i].key) != &item[i].link)
+			errors++;
+	}
+	cycles[1] = get_cycle() - start;
+
+	start = get_cycle();
+	for (i = 0; i < items; i++) {
+		key = item[i].key - 1;
+		if (rhash_table_find(&h, &key))
+			errors++;
+	}
+	cycles[2] = get_cycle() - start;
+
+	start = get_cycle();
+	for (i = 0; i < items; i++)
+		rhash_table_remove(&h, &item[i].key, 1);
+	cycles[3] = get_cycle() - start;
+
+	printf("load %zd.%02zd: insert %lld, find %lld, miss %lld, remove %lld cycles, %zd errors\n",
+	    quarters / 4, quarters % 4 * 25, cycles[0] / items, cycles[1] / items,
+	    cycles[2] / items, cycles[3] / items, errors);
+
+	rhash_table_destroy(&h);
+}
+
+/** Benchmark the resizable hash table at various load factors.
+ *
+ * Items are inserted into a table of BUCKETS buckets, looked
+ * up, looked up with keys that are not in the table and
+ * removed. Up to the load factor of RHASH_LOAD_MAX, the table
+ * keeps its size. Beyond it, the inserts grow the table and
+ * all operations share the cost of migrating the buckets.
+ */
+void bench_rhash2(void)
+{
+	static count_t quarters[] = { 1, 2, 4, 8, 32 };
+	rhash2_item_t *item;
+	index_t i;
+
+	item = (rhash2_item_t *) malloc(BUCKETS * 8 * sizeof(rhash2_item_t), 0);
+	for (i = 0; i < sizeof(quarters) / sizeof(quarters[0]); i++)
+		rhash2_run(item, quarters[i]);
+	free(item);
+}
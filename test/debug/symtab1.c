@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	symtab1.c
+ * @brief	Benchmark of kernel symbol table lookups.
+ */
+
+#include <test.h>
+#include <symtab.h>
+#include <arch/byteorder.h>
+#include <arch/asm.h>
+#include <print.h>
+
+#define LOOKUPS		1000000	/**< Number of lookups by address. */
+
+/** Benchmark kernel symbol table lookups.
+ *
+ * Random addresses between the first and the last symbol are
+ * resolved to symbol names. Then every symbol is looked up by
+ * its name, which must yield its address unless the name is
+ * ambiguous.
+ */
+void bench_symtab1(void)
+{
+	__address first, last, addr;
+	__u64 seed = 1, start, cycles;
+	count_t count, errors = 0;
+	index_t i;
+	char *name;
+
+	for (count = 0; symbol_table[count].address_le; count++)
+		;
+	if (!count) {
+		printf("symbol table is empty\n");
+		return;
+	}
+	first = __u64_le2host(symbol_table[0].address_le);
+	last = __u64_le2host(symbol_table[count - 1].address_le);
+
+	start = get_cycle();
+	for (i = 0; i < LOOKUPS; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		if (!get_symtab_entry(first + (seed >> 16) % (last - first + 1)))
+			errors++;
+	}
+	cycles = (get_cycle() - start) / LOOKUPS;
+	printf("%zd symbols, by address: %lld cycles (%lld ns) per lookup\n",
+	    count, cycles, test_ns(cycles));
+
+	start = get_cycle();
+	for (i = 0; i < count; i++) {
+		for (name = symbol_table[i].symbol_name; *name && *name != ':'; name++)
+			;
+		if (!*name)
+			continue;
+		addr = get_symbol_addr(name + 1);
+		if (addr != (__address) -1 && addr != __u64_le2host(symbol_table[i].address_le))
+			errors++;
+	}
+	cycles = (get_cycle() - start) / count;
+	printf("by name: %lld cycles (%lld ns) per lookup, %zd errors\n",
+	    cycles, test_ns(cycles), errors);
+}
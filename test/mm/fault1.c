@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	fault1.c
+ * @brief	Benchmark of page faults of a multi-threaded task.
+ */
+
+#include <test.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <mm/slab.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <synch/mutex.h>
+#include <synch/semaphore.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <atomic.h>
+#include <print.h>
+#include <panic.h>
+
+#define PAGES		1024		/**< Number of pages faulted in by each thread. */
+#define BASE		0x10000000	/**< Address of the first area. */
+
+/** Argument of fault1_thread(). */
+typedef struct {
+	count_t threads;	/**< Number of threads of the run. */
+	__address page;		/**< First page to fault in. */
+	size_t stride;		/**< Distance between the faulted pages. */
+	as_area_t *area;	/**< Area whose mutex statistics to report or NULL. */
+	__u64 cycles;		/**< Cycles spent in the page faults. */
+} fault1_arg_t;
+
+static void fault1_thread(void *arg);
+static void fault1_run(count_t threads, bool shared);
+
+static atomic_t fault1_barrier;		/**< Start barrier of the threads. */
+static atomic_t fault1_finished;	/**< End barrier of the threads. */
+static mutex_t fault1_stats;		/**< Copy of the first area mutex, only its statistics are used. */
+static atomic_t fault1_errors;		/**< Page faults that were not resolved. */
+static semaphore_t fault1_done;		/**< Raised by each finished thread. */
+
+/** Thread of bench_fault1() faulting in its pages.
+ *
+ * The high-level page fault handler is called directly, so
+ * that the cost of the exception itself is not included.
+ *
+ * @param arg Thread argument, fault1_arg_t.
+ */
+void fault1_thread(void *arg)
+{
+	fault1_arg_t *farg = (fault1_arg_t *) arg;
+	__u64 start;
+	ipl_t ipl;
+	index_t i;
+
+	test_barrier(&fault1_barrier, farg->threads);
+
+	start = get_cycle();
+	for (i = 0; i < PAGES; i++) {
+		ipl = interrupts_disable();
+		if (as_page_fault(farg->page + i * farg->stride, PF_ACCESS_WRITE, NULL) != AS_PF_OK)
+			atomic_inc(&fault1_errors);
+		interrupts_restore(ipl);
+	}
+	farg->cycles = get_cycle() - start;
+
+	/* The area is destroyed with the task after the threads exit. */
+	test_barrier(&fault1_finished, farg->threads);
+	if (farg->area)
+		fault1_stats = farg->area->lock;
+
+	semaphore_up(&fault1_done);
+}
+
+/** Fault in pages of a new task by the given number of threads.
+ *
+ * Each thread faults in pages of its own address space area or
+ * every n-th page of an area shared by all n threads. In the
+ * latter case, the threads contend for the mutex of the area.
+ * The threads are wired to different CPUs. The task and its
+ * address space are destroyed when the threads exit.
+ *
+ * @param threads Number of threads.
+ * @param shared True if the threads share one area.
+ */
+void fault1_run(count_t threads, bool shared)
+{
+	as_area_t *area = NULL;
+	fault1_arg_t *arg;
+	thread_t **t;
+	task_t *task;
+	as_t *as;
+	__u64 sum = 0, max = 0;
+	index_t i, n;
+
+	arg = (fault1_arg_t *) malloc(threads * sizeof(fault1_arg_t), 0);
+	t = (thread_t **) malloc(threads * sizeof(thread_t *), 0);
+
+	as = as_create(0);
+	task = task_create(as, "fault1");
+
+	for (i = 0; i < threads; i++) {
+		arg[i].threads = threads;
+		if (shared) {
+			arg[i].page = BASE + i * PAGE_SIZE;
+			arg[i].stride = threads * PAGE_SIZE;
+		} else {
+			arg[i].page = BASE + i * PAGES * PAGE_SIZE;
+			arg[i].stride = PAGE_SIZE;
+		}
+		if (!shared || !area) {
+			area = as_area_create(as, AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+			    (shared ? threads : 1) * PAGES * PAGE_SIZE, arg[i].page,
+			    AS_AREA_ATTR_NONE, &anon_backend, NULL);
+			if (!area)
+				panic("as_area_create/fault1\n");
+		}
+		arg[i].area = i ? NULL : area;
+	}
+
+	atomic_set(&fault1_barrier, 0);
+	atomic_set(&fault1_finished, 0);
+	atomic_set(&fault1_errors, 0);
+	semaphore_initialize(&fault1_done, 0);
+
+	/* All threads must exist before the first one can exit and destroy the task. */
+	for (i = 0, n = 0; n < threads; i++) {
+		if (cpus[i].active) {
+			t[n] = test_thread_create(fault1_thread, &arg[n], task, &cpus[i], "fault1");
+			n++;
+		}
+	}
+	for (i = 0; i < threads; i++)
+		thread_ready(t[i]);
+	for (i = 0; i < threads; i++)
+		semaphore_down(&fault1_done);
+
+	for (i = 0; i < threads; i++) {
+		sum += arg[i].cycles;
+		if (arg[i].cycles > max)
+			max = arg[i].cycles;
+	}
+
+	printf("%zd threads, %s: %lld cycles (%lld ns) per fault, %lld faults per ms, %zd errors\n",
+	    threads, shared ? "shared area" : "own areas",
+	    sum / (threads * PAGES), test_ns(sum / (threads * PAGES)),
+	    test_ns(max) ? threads * PAGES * 1000000ULL / test_ns(max) : 0ULL,
+	    atomic_get(&fault1_errors));
+	printf("area mutex: %zd acquisitions, %zd contended, %zd spun, %zd slept\n",
+	    fault1_stats.acquired, fault1_stats.contended, fault1_stats.spun, fault1_stats.slept);
+
+	free(t);
+	free(arg);
+}
+
+/** Benchmark page faults of a multi-threaded task.
+ *
+ * The faults are resolved by one thread and by a thread on
+ * each active CPU. If the threads fault in different areas
+ * in parallel, the throughput grows with the number of CPUs.
+ * If they fault in the same area, the throughput depends on
+ * how fast the contended area mutex is passed between them.
+ */
+void bench_fault1(void)
+{
+	fault1_run(1, false);
+	if (config.cpu_active > 1) {
+		fault1_run(config.cpu_active, false);
+		fault1_run(config.cpu_active, true);
+	}
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	pingpong1.c
+ * @brief	Benchmark of switches between threads of different tasks.
+ */
+
+#include <test.h>
+#include <mm/as.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <synch/semaphore.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <print.h>
+
+#define ROUNDS		100000	/**< Number of round trips of the ball. */
+
+static void pingpong1_ping(void *arg);
+static void pingpong1_pong(void *arg);
+static __u64 pingpong1_run(bool same_task);
+
+static semaphore_t pingpong1_sem[2];	/**< Semaphores passing the ball. */
+static semaphore_t pingpong1_done;	/**< Raised by each finished thread. */
+static __u64 pingpong1_cycles;		/**< Duration of the last run. */
+
+/** Thread of pingpong1_run() serving the ball.
+ *
+ * @param arg Ignored.
+ */
+void pingpong1_ping(void *arg)
+{
+	__u64 start;
+	index_t i;
+
+	start = get_cycle();
+	for (i = 0; i < ROUNDS; i++) {
+		semaphore_up(&pingpong1_sem[1]);
+		semaphore_down(&pingpong1_sem[0]);
+	}
+	pingpong1_cycles = get_cycle() - start;
+
+	semaphore_up(&pingpong1_done);
+}
+
+/** Thread of pingpong1_run() returning the ball.
+ *
+ * @param arg Ignored.
+ */
+void pingpong1_pong(void *arg)
+{
+	index_t i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		semaphore_down(&pingpong1_sem[1]);
+		semaphore_up(&pingpong1_sem[0]);
+	}
+
+	semaphore_up(&pingpong1_done);
+}
+
+/** Pass a ball between two threads wired to the same CPU.
+ *
+ * The threads belong to a new task or to two new tasks, each
+ * with its own address space. The tasks are destroyed when the
+ * threads exit.
+ *
+ * @param same_task True if both threads belong to the same task.
+ *
+ * @return Cycles per round trip.
+ */
+__u64 pingpong1_run(bool same_task)
+{
+	task_t *task[2];
+	thread_t *t[2];
+
+	semaphore_initialize(&pingpong1_sem[0], 0);
+	semaphore_initialize(&pingpong1_sem[1], 0);
+	semaphore_initialize(&pingpong1_done, 0);
+
+	task[0] = task_create(as_create(0), "pingpong1");
+	task[1] = same_task ? task[0] : task_create(as_create(0), "pingpong1");
+
+	/* Both threads must exist before the first one can exit and destroy the task. */
+	t[0] = test_thread_create(pingpong1_ping, NULL, task[0], &cpus[0], "ping");
+	t[1] = test_thread_create(pingpong1_pong, NULL, task[1], &cpus[0], "pong");
+	thread_ready(t[0]);
+	thread_ready(t[1]);
+
+	semaphore_down(&pingpong1_done);
+	semaphore_down(&pingpong1_done);
+
+	return pingpong1_cycles / ROUNDS;
+}
+
+/** Benchmark switches between threads of different tasks.
+ *
+ * Each round trip of the ball takes two thread switches. The
+ * switches between threads of two tasks also switch the address
+ * space, which is compared with switches within one task.
+ */
+void bench_pingpong1(void)
+{
+	__u64 cycles;
+
+	cycles = pingpong1_run(true);
+	printf("same task: %lld cycles (%lld ns) per round trip\n", cycles, test_ns(cycles));
+	cycles = pingpong1_run(false);
+	printf("two tasks: %lld cycles (%lld ns) per round trip\n", cycles, test_ns(cycles));
+}
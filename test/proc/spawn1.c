@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	spawn1.c
+ * @brief	Benchmark of task creation and teardown.
+ */
+
+#include <test.h>
+#include <mm/as.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <proc/scheduler.h>
+#include <synch/semaphore.h>
+#include <synch/spinlock.h>
+#include <adt/btree.h>
+#include <adt/list.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <print.h>
+
+#define TASKS		1000	/**< Number of spawned tasks. */
+
+static void spawn1_thread(void *arg);
+static count_t spawn1_count(btree_t *tree, spinlock_t *lock);
+
+static semaphore_t spawn1_started;	/**< Raised by each started thread. */
+static semaphore_t spawn1_release;	/**< Lets the threads exit. */
+
+/** Main thread of a task spawned by bench_spawn1().
+ *
+ * @param arg Ignored.
+ */
+void spawn1_thread(void *arg)
+{
+	semaphore_up(&spawn1_started);
+	semaphore_down(&spawn1_release);
+}
+
+/** Count entries of a global B+tree.
+ *
+ * @param tree B+tree of tasks or threads.
+ * @param lock Spinlock protecting the B+tree.
+ *
+ * @return Number of keys in the B+tree.
+ */
+count_t spawn1_count(btree_t *tree, spinlock_t *lock)
+{
+	count_t count = 0;
+	link_t *cur;
+	ipl_t ipl;
+
+	ipl = interrupts_disable();
+	spinlock_lock(lock);
+	for (cur = tree->leaf_head.next; cur != &tree->leaf_head; cur = cur->next) {
+		btree_node_t *node = list_get_instance(cur, btree_node_t, leaf_link);
+
+		count += node->keys;
+	}
+	spinlock_unlock(lock);
+	interrupts_restore(ipl);
+
+	return count;
+}
+
+/** Benchmark task creation and teardown.
+ *
+ * TASKS tasks with one thread each are spawned and the number of
+ * threads they add to the system is counted. Then their threads
+ * are let exit and the time until all of them are destroyed is
+ * measured. No helper threads or timers are involved, so a task
+ * adds exactly one thread and is torn down as soon as it exits.
+ */
+void bench_spawn1(void)
+{
+	count_t threads, tasks;
+	__u64 start, spawn, teardown;
+	thread_t *t;
+	index_t i;
+
+	semaphore_initialize(&spawn1_started, 0);
+	semaphore_initialize(&spawn1_release, 0);
+
+	threads = spawn1_count(&threads_btree, &threads_lock);
+	tasks = spawn1_count(&tasks_btree, &tasks_lock);
+
+	start = get_cycle();
+	for (i = 0; i < TASKS; i++) {
+		t = test_thread_create(spawn1_thread, NULL, task_create(as_create(0), "spawn1"),
+		    NULL, "spawn1");
+		thread_ready(t);
+	}
+	for (i = 0; i < TASKS; i++)
+		semaphore_down(&spawn1_started);
+	spawn = get_cycle() - start;
+
+	printf("%zd tasks added %zd tasks and %zd threads\n", (count_t) TASKS,
+	    spawn1_count(&tasks_btree, &tasks_lock) - tasks,
+	    spawn1_count(&threads_btree, &threads_lock) - threads);
+
+	start = get_cycle();
+	for (i = 0; i < TASKS; i++)
+		semaphore_up(&spawn1_release);
+	while (spawn1_count(&threads_btree, &threads_lock) > threads)
+		scheduler();
+	teardown = get_cycle() - start;
+
+	printf("spawn: %lld cycles (%lld ns) per task\n", spawn / TASKS, test_ns(spawn / TASKS));
+	printf("teardown: %lld cycles (%lld ns) per task\n", teardown / TASKS, test_ns(teardown / TASKS));
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	yield1.c
+ * @brief	Benchmark of thread switches on one CPU.
+ */
+
+#include <test.h>
+#include <proc/scheduler.h>
+#include <proc/thread.h>
+#include <synch/synch.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <atomic.h>
+#include <print.h>
+
+#define YIELDS		100000	/**< Number of scheduler() calls of each thread. */
+
+static void yield1_thread(void *arg);
+static __u64 yield1_run(count_t threads);
+
+static count_t yield1_threads;		/**< Number of threads of the run. */
+static atomic_t yield1_started;		/**< Number of started threads. */
+
+/** Thread of yield1_run() calling the scheduler.
+ *
+ * The thread waits for the other threads of the run first,
+ * so that all of them are ready when it starts yielding.
+ *
+ * @param arg Pointer to the duration of the yields in cycles.
+ */
+void yield1_thread(void *arg)
+{
+	__u64 *cycles = (__u64 *) arg;
+	__u64 start;
+	index_t i;
+
+	atomic_inc(&yield1_started);
+	while (atomic_get(&yield1_started) < yield1_threads)
+		scheduler();
+
+	start = get_cycle();
+	for (i = 0; i < YIELDS; i++)
+		scheduler();
+	*cycles = get_cycle() - start;
+}
+
+/** Yield the CPU by threads wired to the first CPU.
+ *
+ * @param threads Number of threads.
+ *
+ * @return Cycles per scheduler() call.
+ */
+__u64 yield1_run(count_t threads)
+{
+	__u64 cycles[2];
+	thread_t *t[2];
+	__u64 max = 0;
+	index_t i;
+
+	yield1_threads = threads;
+	atomic_set(&yield1_started, 0);
+	for (i = 0; i < threads; i++)
+		t[i] = test_thread_create(yield1_thread, &cycles[i], TASK, &cpus[0], "yield1");
+	for (i = 0; i < threads; i++)
+		thread_ready(t[i]);
+
+	for (i = 0; i < threads; i++) {
+		thread_join_timeout(t[i], SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+		thread_detach(t[i]);
+		if (cycles[i] > max)
+			max = cycles[i];
+	}
+
+	return max / (threads * YIELDS);
+}
+
+/** Benchmark thread switches on one CPU.
+ *
+ * A single thread yielding the CPU continues right away. Two
+ * threads yielding the CPU switch to each other on every call.
+ */
+void bench_yield1(void)
+{
+	__u64 cycles;
+
+	cycles = yield1_run(1);
+	printf("1 thread: %lld cycles (%lld ns) per yield\n", cycles, test_ns(cycles));
+	cycles = yield1_run(2);
+	printf("2 threads: %lld cycles (%lld ns) per switch\n", cycles, test_ns(cycles));
+}
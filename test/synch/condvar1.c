@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	condvar1.c
+ * @brief	Benchmark of condition variable broadcasts built on futexes.
+ */
+
+#include <test.h>
+#include <synch/futex.h>
+#include <synch/synch.h>
+#include <proc/scheduler.h>
+#include <proc/thread.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <atomic.h>
+#include <print.h>
+#include <panic.h>
+
+#define WAITERS		8	/**< Number of threads waiting for the broadcasts. */
+#define ROUNDS		100	/**< Number of broadcasts. */
+
+/** Ways of waking up all threads waiting in the condition variable. */
+typedef enum {
+	CONDVAR1_WAKEUP_ONE,	/**< Wake up the threads one by one. */
+	CONDVAR1_WAKEUP_ALL,	/**< Wake up all threads at once. */
+	CONDVAR1_REQUEUE	/**< Wake up one thread and move the others to the mutex. */
+} condvar1_mode_t;
+
+static void condvar1_thread(void *arg);
+static void condvar1_run(condvar1_mode_t mode, char *name);
+
+static atomic_t condvar1_cond;		/**< Sequence number of the condition variable. */
+static atomic_t condvar1_mutex;		/**< Futex-based mutex. */
+static atomic_t condvar1_woken;		/**< Threads that returned from the wait. */
+static atomic_t condvar1_sleeps;	/**< Sleeps in the mutex futex. */
+
+/** Thread of condvar1_run() waiting for the broadcasts.
+ *
+ * The thread waits in the condition variable and acquires the
+ * mutex after each wakeup. Because the mutex may have received
+ * threads from the condition variable by a requeue, it is always
+ * taken as contended afterwards.
+ *
+ * @param arg Ignored.
+ */
+void condvar1_thread(void *arg)
+{
+	count_t sleeps = 0;
+	__native seq;
+	index_t i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		sleeps += futex2_lock(&condvar1_mutex, false);
+		seq = atomic_get(&condvar1_cond);
+		futex2_unlock(&condvar1_mutex);
+
+		(void) sys_futex_sleep_compare((__address) &condvar1_cond, seq, 0, SYNCH_FLAGS_NONE);
+
+		sleeps += futex2_lock(&condvar1_mutex, true);
+		atomic_inc(&condvar1_woken);
+		futex2_unlock(&condvar1_mutex);
+	}
+
+	while (sleeps--)
+		atomic_inc(&condvar1_sleeps);
+}
+
+/** Broadcast the condition variable to waiting threads.
+ *
+ * Each broadcast is made when all threads sleep in the condition
+ * variable. Its duration is measured until all of them have
+ * acquired and released the mutex.
+ *
+ * @param mode Way of waking up the threads.
+ * @param name Name of the mode.
+ */
+void condvar1_run(condvar1_mode_t mode, char *name)
+{
+	thread_t *t[WAITERS];
+	__u64 start, cycles = 0;
+	index_t i, j;
+
+	atomic_set(&condvar1_cond, 0);
+	atomic_set(&condvar1_mutex, 0);
+	atomic_set(&condvar1_woken, 0);
+	atomic_set(&condvar1_sleeps, 0);
+
+	for (i = 0; i < WAITERS; i++) {
+		t[i] = test_thread_create(condvar1_thread, NULL, TASK, NULL, "condvar1");
+		thread_ready(t[i]);
+	}
+
+	for (i = 0; i < ROUNDS; i++) {
+		while (futex_sleepers((__address) &condvar1_cond) < WAITERS)
+			scheduler();
+
+		start = get_cycle();
+		atomic_inc(&condvar1_cond);
+		switch (mode) {
+		case CONDVAR1_WAKEUP_ONE:
+			/* Threads woken up earlier queue behind those still sleeping. */
+			for (j = 0; j < WAITERS; j++)
+				(void) sys_futex_wakeup_n((__address) &condvar1_cond, 1);
+			break;
+		case CONDVAR1_WAKEUP_ALL:
+			(void) sys_futex_wakeup_n((__address) &condvar1_cond, WAITERS);
+			break;
+		case CONDVAR1_REQUEUE:
+			/* Nobody holds the mutex, so the woken thread wakes the others. */
+			(void) sys_futex_requeue((__address) &condvar1_cond,
+			    (__address) &condvar1_mutex, 1, WAITERS);
+			break;
+		}
+		while (atomic_get(&condvar1_woken) < (i + 1) * WAITERS)
+			scheduler();
+		cycles += get_cycle() - start;
+	}
+
+	for (i = 0; i < WAITERS; i++) {
+		thread_join_timeout(t[i], SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+		thread_detach(t[i]);
+	}
+	futex_forget((__address) &condvar1_cond);
+	futex_forget((__address) &condvar1_mutex);
+
+	cycles /= ROUNDS;
+	printf("%s: %lld cycles (%lld ns) per broadcast, %zd mutex sleeps\n",
+	    name, cycles, test_ns(cycles), atomic_get(&condvar1_sleeps));
+}
+
+/** Benchmark condition variable broadcasts.
+ *
+ * WAITERS threads are woken up one by one, all at once and by
+ * a requeue to the mutex. After the wakeup of all threads at
+ * once, the threads fight for the mutex. After the requeue,
+ * each thread wakes the next one up when it releases the mutex.
+ */
+void bench_condvar1(void)
+{
+	condvar1_run(CONDVAR1_WAKEUP_ONE, "wakeup one");
+	condvar1_run(CONDVAR1_WAKEUP_ALL, "wakeup all");
+	condvar1_run(CONDVAR1_REQUEUE, "requeue");
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	futex1.c
+ * @brief	Test of futex wakeup and requeue operations.
+ */
+
+#include <test.h>
+#include <synch/futex.h>
+#include <synch/synch.h>
+#include <proc/thread.h>
+#include <arch.h>
+#include <atomic.h>
+#include <print.h>
+#include <panic.h>
+
+#define THREADS		4	/**< Number of threads sleeping in the futex. */
+#define WAIT		1000	/**< Number of milliseconds to wait for the threads. */
+
+static bool futex1_wait(__address uaddr, count_t sleepers, count_t woken);
+static void futex1_thread(void *arg);
+
+/** Futex counters. */
+static __native futex1_counter[2];
+
+static atomic_t futex1_woken;	/**< Threads that were woken up. */
+static atomic_t futex1_errors;	/**< Threads that returned an error. */
+
+/** Wait until the threads of test_futex1() get to the expected state.
+ *
+ * @param uaddr Address of the futex counter.
+ * @param sleepers Expected number of threads sleeping in the futex.
+ * @param woken Expected number of threads woken up so far.
+ *
+ * @return False if the state was not reached in WAIT milliseconds.
+ */
+bool futex1_wait(__address uaddr, count_t sleepers, count_t woken)
+{
+	int i;
+
+	for (i = 0; i < WAIT; i++) {
+		if (futex_sleepers(uaddr) == sleepers && atomic_get(&futex1_woken) == woken)
+			return true;
+		thread_usleep(1000);
+	}
+
+	printf("expected %zd sleepers and %zd woken threads, got %zd and %zd\n",
+	    sleepers, woken, futex_sleepers(uaddr), atomic_get(&futex1_woken));
+	return false;
+}
+
+/** Thread of test_futex1() sleeping in the first futex.
+ *
+ * @param arg Ignored.
+ */
+void futex1_thread(void *arg)
+{
+	if (sys_futex_sleep_compare((__address) &futex1_counter[0], 0, 0, 0) == ESYNCH_OK_BLOCKED)
+		atomic_inc(&futex1_woken);
+	else
+		atomic_inc(&futex1_errors);
+}
+
+/** Test the futex operations.
+ *
+ * Threads of the kernel task sleep in a futex on a kernel address,
+ * which is translated through the kernel identity mapping. They are
+ * woken up by sys_futex_wakeup_n() and sys_futex_requeue(), which
+ * must report the right number of threads. Wakeups that find no
+ * sleeping thread must not be remembered. The references of the
+ * kernel task to the two futexes are dropped at the end.
+ *
+ * @return True if the test passed, false otherwise.
+ */
+bool test_futex1(void)
+{
+	__address f0 = (__address) &futex1_counter[0];
+	__address f1 = (__address) &futex1_counter[1];
+	thread_t *t[THREADS];
+	__native rc;
+	bool ok = false;
+	int i;
+
+	futex1_counter[0] = 0;
+	futex1_counter[1] = 0;
+	atomic_set(&futex1_woken, 0);
+	atomic_set(&futex1_errors, 0);
+
+	/* The counter is checked through its physical address. */
+	rc = sys_futex_sleep_compare(f0, 1, 1000, 0);
+	if (rc != ESYNCH_WOULD_BLOCK) {
+		printf("sleep with wrong counter value returned %zd\n", rc);
+		futex_forget(f0);
+		return false;
+	}
+	rc = sys_futex_sleep_compare(f0, 0, 1000, 0);
+	if (rc != ESYNCH_TIMEOUT) {
+		printf("sleep with right counter value returned %zd\n", rc);
+		futex_forget(f0);
+		return false;
+	}
+
+	for (i = 0; i < THREADS; i++) {
+		if (!(t[i] = thread_create(futex1_thread, NULL, TASK, 0, "futex1")))
+			panic("thread_create/futex1\n");
+		thread_ready(t[i]);
+	}
+	if (!futex1_wait(f0, THREADS, 0))
+		goto out;
+
+	rc = sys_futex_wakeup_n(f0, 2);
+	if (rc != 2) {
+		printf("wakeup of 2 threads returned %zd\n", rc);
+		goto out;
+	}
+	if (!futex1_wait(f0, THREADS - 2, 2))
+		goto out;
+
+	/* Wake one of the remaining threads up and move the other. */
+	rc = sys_futex_requeue(f0, f1, 1, (count_t) -1);
+	if (rc != THREADS - 3) {
+		printf("requeue returned %zd\n", rc);
+		goto out;
+	}
+	if (!futex1_wait(f0, 0, 3) || !futex1_wait(f1, THREADS - 3, 3))
+		goto out;
+
+	rc = sys_futex_wakeup_n(f1, (count_t) -1);
+	if (rc != THREADS - 3) {
+		printf("wakeup of all threads returned %zd\n", rc);
+		goto out;
+	}
+	if (!futex1_wait(f1, 0, THREADS))
+		goto out;
+
+	/* Nobody is sleeping, so the wakeup must be lost. */
+	rc = sys_futex_wakeup_n(f0, 1);
+	if (rc != 0) {
+		printf("wakeup with no sleepers returned %zd\n", rc);
+		goto out;
+	}
+	rc = sys_futex_sleep_compare(f0, 0, 1000, 0);
+	if (rc != ESYNCH_TIMEOUT) {
+		printf("sleep after lost wakeup returned %zd\n", rc);
+		goto out;
+	}
+
+	ok = !atomic_get(&futex1_errors);
+
+out:
+	for (i = 0; i < THREADS; i++) {
+		while (thread_join_timeout(t[i], 1000, SYNCH_FLAGS_NONE) == ESYNCH_TIMEOUT) {
+			/* Release threads left sleeping by a failed check. */
+			(void) sys_futex_wakeup_n(f0, FUTEX_COUNT_MAX);
+			(void) sys_futex_wakeup_n(f1, FUTEX_COUNT_MAX);
+		}
+		thread_detach(t[i]);
+	}
+	futex_forget(f0);
+	futex_forget(f1);
+
+	return ok;
+}
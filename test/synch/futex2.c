@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	futex2.c
+ * @brief	Benchmark of contended futexes.
+ */
+
+#include <test.h>
+#include <synch/futex.h>
+#include <synch/semaphore.h>
+#include <synch/synch.h>
+#include <mm/as.h>
+#include <mm/slab.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <atomic.h>
+#include <print.h>
+
+#define OPS		10000	/**< Number of critical sections of each thread. */
+#define THREADS_PER_CPU	2	/**< Number of threads wired to each active CPU. */
+
+/** Futex-based lock of bench_futex2(). */
+typedef struct {
+	atomic_t futex;		/**< 0 if unlocked, 1 if locked, 2 if contended. */
+	count_t counter;	/**< Counter protected by the lock. */
+} futex2_lock_t;
+
+/** Argument of futex2_thread(). */
+typedef struct {
+	futex2_lock_t *lock;	/**< Lock used by the thread. */
+	count_t threads;	/**< Number of threads of the run. */
+	__u64 cycles;		/**< Duration of the critical sections. */
+} futex2_arg_t;
+
+static void futex2_thread(void *arg);
+static void futex2_run(count_t locks);
+
+static atomic_t futex2_barrier;		/**< Start barrier of the threads. */
+static atomic_t futex2_sleeps;		/**< Number of futex sleeps. */
+static semaphore_t futex2_done;		/**< Raised by each finished thread. */
+
+/** Acquire futex-based lock.
+ *
+ * The lock is taken without entering the futex subsystem
+ * unless it is contended.
+ *
+ * @param futex Futex counter of the lock.
+ * @param contended True if threads may sleep in the futex without
+ *	  having marked the lock contended, e.g. after a requeue.
+ *
+ * @return Number of sleeps in the futex.
+ */
+count_t futex2_lock(atomic_t *futex, bool contended)
+{
+	count_t sleeps = 0;
+
+	if (!contended && atomic_cas(futex, 0, 1))
+		return 0;
+
+	while (!atomic_cas(futex, 0, 2)) {
+		if (atomic_get(futex) == 1 && !atomic_cas(futex, 1, 2))
+			continue;
+		sleeps++;
+		(void) sys_futex_sleep_compare((__address) futex, 2, 0, SYNCH_FLAGS_NONE);
+	}
+
+	return sleeps;
+}
+
+/** Release futex-based lock.
+ *
+ * @param futex Futex counter of the lock.
+ */
+void futex2_unlock(atomic_t *futex)
+{
+	if (atomic_postdec(futex) != 1) {
+		atomic_set(futex, 0);
+		(void) sys_futex_wakeup_n((__address) futex, 1);
+	}
+}
+
+/** Thread of futex2_run() entering critical sections.
+ *
+ * @param arg Thread argument, futex2_arg_t.
+ */
+void futex2_thread(void *arg)
+{
+	futex2_arg_t *farg = (futex2_arg_t *) arg;
+	count_t sleeps = 0;
+	__u64 start;
+	index_t i;
+
+	test_barrier(&futex2_barrier, farg->threads);
+
+	start = get_cycle();
+	for (i = 0; i < OPS; i++) {
+		sleeps += futex2_lock(&farg->lock->futex, false);
+		farg->lock->counter++;
+		futex2_unlock(&farg->lock->futex);
+	}
+	farg->cycles = get_cycle() - start;
+
+	while (sleeps--)
+		atomic_inc(&futex2_sleeps);
+	semaphore_up(&futex2_done);
+}
+
+/** Contend for futex-based locks from threads of many tasks.
+ *
+ * THREADS_PER_CPU threads are wired to each active CPU. Each of
+ * them belongs to its own task, which is destroyed when the thread
+ * exits. The threads are spread evenly over the locks.
+ *
+ * @param locks Number of locks.
+ */
+void futex2_run(count_t locks)
+{
+	count_t threads = THREADS_PER_CPU * config.cpu_active;
+	count_t counter = 0;
+	futex2_lock_t *lock;
+	futex2_arg_t *arg;
+	thread_t **t;
+	__u64 max = 0;
+	index_t i, n;
+
+	lock = (futex2_lock_t *) malloc(locks * sizeof(futex2_lock_t), 0);
+	arg = (futex2_arg_t *) malloc(threads * sizeof(futex2_arg_t), 0);
+	t = (thread_t **) malloc(threads * sizeof(thread_t *), 0);
+
+	for (i = 0; i < locks; i++) {
+		atomic_set(&lock[i].futex, 0);
+		lock[i].counter = 0;
+	}
+	atomic_set(&futex2_barrier, 0);
+	atomic_set(&futex2_sleeps, 0);
+	semaphore_initialize(&futex2_done, 0);
+
+	for (i = 0, n = 0; n < threads; i = (i + 1) % config.cpu_count) {
+		if (!cpus[i].active)
+			continue;
+		arg[n].lock = &lock[n % locks];
+		arg[n].threads = threads;
+		t[n] = test_thread_create(futex2_thread, &arg[n],
+		    task_create(as_create(0), "futex2"), &cpus[i], "futex2");
+		n++;
+	}
+	for (i = 0; i < threads; i++)
+		thread_ready(t[i]);
+	for (i = 0; i < threads; i++)
+		semaphore_down(&futex2_done);
+
+	for (i = 0; i < threads; i++) {
+		if (arg[i].cycles > max)
+			max = arg[i].cycles;
+	}
+	for (i = 0; i < locks; i++)
+		counter += lock[i].counter;
+
+	printf("%zd threads, %zd futexes: %lld critical sections per ms, %zd sleeps, %s\n",
+	    threads, locks, test_ns(max) ? threads * OPS * 1000000ULL / test_ns(max) : 0ULL,
+	    atomic_get(&futex2_sleeps), counter == threads * OPS ? "ok" : "counter mismatch");
+
+	free(t);
+	free(arg);
+	free(lock);
+}
+
+/** Benchmark contended futexes.
+ *
+ * Threads of many tasks on all CPUs contend for a single futex
+ * and then for a futex per CPU. With the futex table split into
+ * buckets, the independent futexes do not slow each other down.
+ */
+void bench_futex2(void)
+{
+	futex2_run(1);
+	if (config.cpu_active > 1)
+		futex2_run(config.cpu_active);
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	rcu1.c
+ * @brief	Test of RCU grace periods.
+ */
+
+#include <test.h>
+#include <synch/rcu.h>
+#include <synch/spinlock.h>
+#include <proc/thread.h>
+#include <time/delay.h>
+#include <mm/slab.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <atomic.h>
+#include <print.h>
+#include <panic.h>
+
+/** Number of pointer updates done by test_rcu1(). */
+#define UPDATES		200
+
+/** Maximal length of a test_rcu1() read section in microseconds. */
+#define SECTION		(2 * RCU_PERIOD)
+
+/** Interval between checks within a test_rcu1() read section in microseconds. */
+#define STEP		100
+
+/** Value of rcu1_obj_t.magic while the object may be read. */
+#define ALIVE		0x600dULL
+/** Value of rcu1_obj_t.magic after the object was reclaimed. */
+#define DEAD		0xdeadULL
+
+/** Object read and replaced by test_rcu1(). */
+typedef struct {
+	rcu_head_t head;
+	volatile __native magic;
+} rcu1_obj_t;
+
+/** Objects of test_rcu1(). Reclaimed objects are not reused. */
+static rcu1_obj_t rcu1_obj[UPDATES + 1];
+static rcu1_obj_t * volatile rcu1_ptr;		/**< Object read by the readers of test_rcu1(). */
+static volatile bool rcu1_stop;		/**< Tells the readers of test_rcu1() to exit. */
+static atomic_t rcu1_errors;		/**< Reclaimed objects seen by the readers. */
+static atomic_t rcu1_reclaimed;		/**< Objects reclaimed by test_rcu1(). */
+
+static void rcu1_reclaim(rcu_head_t *head);
+static void rcu1_reader(void *arg);
+
+/** Reclaim object of test_rcu1(). */
+void rcu1_reclaim(rcu_head_t *head)
+{
+	rcu1_obj_t *obj = (rcu1_obj_t *) head;
+
+	obj->magic = DEAD;
+	atomic_inc(&rcu1_reclaimed);
+}
+
+/** Reader thread of test_rcu1()
+ *
+ * Check that the object stays alive for the whole read section.
+ * The read sections are up to twice as long as the period of krcud,
+ * so that a callback run too early is likely to be noticed. Their
+ * lengths are pseudo-random, so that the readers do not finish
+ * their read sections at the same time.
+ *
+ * @param arg Seed of the section lengths.
+ */
+void rcu1_reader(void *arg)
+{
+	rcu1_obj_t *obj;
+	__native seed = (__native) arg;
+	count_t i, steps;
+
+	while (!rcu1_stop) {
+		seed = seed * 1103515245 + 12345;
+		steps = (seed >> 16) % (SECTION / STEP) + 1;
+
+		rcu_read_lock();
+		obj = rcu1_ptr;
+		for (i = 0; i < steps; i++) {
+			if (obj->magic != ALIVE) {
+				atomic_inc(&rcu1_errors);
+				break;
+			}
+			delay(STEP);
+		}
+		rcu_read_unlock();
+	}
+}
+
+/** Test that RCU waits for readers
+ *
+ * A reader thread wired to each active CPU keeps reading an
+ * object while this thread replaces it. Every other replaced
+ * object is reclaimed by call_rcu(), the rest after
+ * rcu_synchronize(). No reader may see a reclaimed object
+ * and all callbacks must eventually run.
+ *
+ * @return True if the test passed, false otherwise.
+ */
+bool test_rcu1(void)
+{
+	rcu1_obj_t *old;
+	thread_t **t;
+	count_t n = 0, errors;
+	index_t i;
+
+	t = (thread_t **) malloc(config.cpu_count * sizeof(thread_t *), 0);
+
+	for (i = 0; i <= UPDATES; i++)
+		rcu1_obj[i].magic = ALIVE;
+	rcu1_ptr = &rcu1_obj[0];
+	rcu1_stop = false;
+	atomic_set(&rcu1_errors, 0);
+	atomic_set(&rcu1_reclaimed, 0);
+
+	for (i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].active)
+			continue;
+		if (!(t[n] = thread_create(rcu1_reader, (void *) (n + 1), TASK, 0, "rcu1")))
+			panic("thread_create/rcu1\n");
+		spinlock_lock(&t[n]->lock);
+		t[n]->flags |= X_WIRED;
+		t[n]->cpu = &cpus[i];
+		spinlock_unlock(&t[n]->lock);
+		thread_ready(t[n]);
+		n++;
+	}
+
+	for (i = 0; i < UPDATES; i++) {
+		old = rcu1_ptr;
+		rcu_assign_pointer(rcu1_ptr, &rcu1_obj[i + 1]);
+		if (i % 2) {
+			call_rcu(&old->head, rcu1_reclaim);
+		} else {
+			rcu_synchronize();
+			rcu1_reclaim(&old->head);
+		}
+	}
+
+	rcu1_stop = true;
+	for (i = 0; i < n; i++) {
+		thread_join_timeout(t[i], SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+		thread_detach(t[i]);
+	}
+	free(t);
+
+	/* Callbacks run one grace period after they were queued. */
+	for (i = 0; i < UPDATES && atomic_get(&rcu1_reclaimed) < UPDATES; i++)
+		thread_usleep(RCU_PERIOD);
+
+	errors = atomic_get(&rcu1_errors);
+	printf("%zd readers, %zd reclaimed objects read, %zd of %d objects reclaimed\n",
+	    n, errors, atomic_get(&rcu1_reclaimed), UPDATES);
+
+	return !errors && atomic_get(&rcu1_reclaimed) == UPDATES;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	rwlock1.c
+ * @brief	Benchmark of read-mostly reader/writer lock use.
+ */
+
+#include <test.h>
+#include <synch/rwlock.h>
+#include <synch/synch.h>
+#include <proc/thread.h>
+#include <mm/slab.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <config.h>
+#include <atomic.h>
+#include <print.h>
+
+#define OPS		100000	/**< Number of critical sections of each thread. */
+#define WRITE_EVERY	1000	/**< Every WRITE_EVERY-th critical section is a write. */
+
+/** Argument of rwlock1_thread(). */
+typedef struct {
+	count_t threads;	/**< Number of threads of the run. */
+	__u64 cycles;		/**< Duration of the critical sections. */
+} rwlock1_arg_t;
+
+static void rwlock1_thread(void *arg);
+static void rwlock1_run(count_t threads);
+
+static rwlock_t rwlock1_lock;		/**< Lock shared by the threads. */
+static volatile __native rwlock1_value;	/**< Value changed by the writers, always even outside of the lock. */
+static atomic_t rwlock1_barrier;	/**< Start barrier of the threads. */
+static atomic_t rwlock1_errors;		/**< Readers that saw a write in progress. */
+
+/** Thread of rwlock1_run() reading and occasionally writing.
+ *
+ * @param arg Thread argument, rwlock1_arg_t.
+ */
+void rwlock1_thread(void *arg)
+{
+	rwlock1_arg_t *rarg = (rwlock1_arg_t *) arg;
+	__u64 start;
+	index_t i;
+
+	test_barrier(&rwlock1_barrier, rarg->threads);
+
+	start = get_cycle();
+	for (i = 1; i <= OPS; i++) {
+		if (i % WRITE_EVERY) {
+			rwlock_read_lock(&rwlock1_lock);
+			if (rwlock1_value % 2)
+				atomic_inc(&rwlock1_errors);
+			rwlock_read_unlock(&rwlock1_lock);
+		} else {
+			rwlock_write_lock(&rwlock1_lock);
+			rwlock1_value++;
+			rwlock1_value++;
+			rwlock_write_unlock(&rwlock1_lock);
+		}
+	}
+	rarg->cycles = get_cycle() - start;
+}
+
+/** Take the lock by the given number of threads.
+ *
+ * The threads are wired to different CPUs.
+ *
+ * @param threads Number of threads.
+ */
+void rwlock1_run(count_t threads)
+{
+	rwlock1_arg_t *arg;
+	thread_t **t;
+	__u64 max = 0;
+	index_t i, n;
+
+	arg = (rwlock1_arg_t *) malloc(threads * sizeof(rwlock1_arg_t), 0);
+	t = (thread_t **) malloc(threads * sizeof(thread_t *), 0);
+
+	rwlock_initialize(&rwlock1_lock);
+	rwlock1_value = 0;
+	atomic_set(&rwlock1_barrier, 0);
+	atomic_set(&rwlock1_errors, 0);
+
+	for (i = 0, n = 0; n < threads; i++) {
+		if (cpus[i].active) {
+			arg[n].threads = threads;
+			t[n] = test_thread_create(rwlock1_thread, &arg[n], TASK, &cpus[i], "rwlock1");
+			thread_ready(t[n]);
+			n++;
+		}
+	}
+
+	for (i = 0; i < threads; i++) {
+		thread_join_timeout(t[i], SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+		thread_detach(t[i]);
+		if (arg[i].cycles > max)
+			max = arg[i].cycles;
+	}
+
+	printf("%zd threads: %lld critical sections per ms, %zd errors\n", threads,
+	    test_ns(max) ? threads * OPS * 1000000ULL / test_ns(max) : 0ULL,
+	    atomic_get(&rwlock1_errors) + (rwlock1_value != 2 * threads * (OPS / WRITE_EVERY)));
+
+	rwlock_destroy(&rwlock1_lock);
+	free(t);
+	free(arg);
+}
+
+/** Benchmark read-mostly reader/writer lock use.
+ *
+ * An increasing number of threads, up to one on each active
+ * CPU, takes the lock mostly for reading. Because readers
+ * touch only their CPU's reader count, the throughput should
+ * grow with the number of threads.
+ */
+void bench_rwlock1(void)
+{
+	count_t threads;
+
+	for (threads = 1; threads < config.cpu_active; threads *= 2)
+		rwlock1_run(threads);
+	rwlock1_run(config.cpu_active);
+}
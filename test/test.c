@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file	test.c
+ * @brief	Kernel self-tests.
+ *
+ * The tests and benchmarks are compiled into the kernel only
+ * if it is configured with CONFIG_TEST. They can be run from
+ * the kernel console. The tests are also run by kinit()
+ * instead of starting the user space tasks.
+ */
+
+#include <test.h>
+#include <proc/thread.h>
+#include <synch/spinlock.h>
+#include <arch/asm.h>
+#include <arch.h>
+#include <cpu.h>
+#include <atomic.h>
+#include <print.h>
+#include <panic.h>
+
+/** Run all kernel self-tests. */
+void test(void)
+{
+	printf("B+tree test %s\n", test_btree1() ? "passed" : "failed");
+	printf("Futex test %s\n", test_futex1() ? "passed" : "failed");
+	printf("RCU test %s\n", test_rcu1() ? "passed" : "failed");
+	printf("Resizable hash table test %s\n", test_rhash1() ? "passed" : "failed");
+}
+
+/** Create thread for a test or benchmark.
+ *
+ * The thread is not made ready, so that all threads of
+ * a benchmark can be created before any of them runs.
+ *
+ * @param func Thread function.
+ * @param arg Argument of the thread function.
+ * @param task Task of the thread.
+ * @param cpu CPU to wire the thread to or NULL.
+ * @param name Name of the thread.
+ *
+ * @return New thread.
+ */
+thread_t *test_thread_create(void (* func)(void *), void *arg, task_t *task, cpu_t *cpu, char *name)
+{
+	thread_t *t;
+	ipl_t ipl;
+
+	if (!(t = thread_create(func, arg, task, 0, name)))
+		panic("thread_create/%s\n", name);
+
+	if (cpu) {
+		ipl = interrupts_disable();
+		spinlock_lock(&t->lock);
+		t->flags |= X_WIRED;
+		t->cpu = cpu;
+		spinlock_unlock(&t->lock);
+		interrupts_restore(ipl);
+	}
+
+	return t;
+}
+
+/** Wait until all threads of a benchmark get here.
+ *
+ * The threads are expected to be wired to different CPUs,
+ * so they busy wait for each other.
+ *
+ * @param barrier Counter of arrived threads, initially zero.
+ * @param threads Number of threads.
+ */
+void test_barrier(atomic_t *barrier, count_t threads)
+{
+	atomic_inc(barrier);
+	while (atomic_get(barrier) < threads)
+		;
+}
+
+/** Convert CPU cycles to nanoseconds.
+ *
+ * @param cycles Number of cycles.
+ *
+ * @return Number of nanoseconds or zero if the CPU frequency is unknown.
+ */
+__u64 test_ns(__u64 cycles)
+{
+	if (!CPU->frequency_mhz)
+		return 0;
+	return cycles * 1000 / CPU->frequency_mhz;
+}